@@ -0,0 +1,172 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/inflater.hpp>
+#include <binapi/flatjson.hpp>
+
+#include <boost/beast/core/buffers_to_string.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*************************************************************************************************/
+
+// as the server does it
+static std::string compress(const std::string &src, int level, bool gzip) {
+    z_stream zs{};
+    ::deflateInit2(&zs, level, Z_DEFLATED, gzip ? MAX_WBITS + 16 : MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+    std::string res(::deflateBound(&zs, src.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src.data()));
+    zs.avail_in = static_cast<uInt>(src.size());
+    zs.next_out = reinterpret_cast<Bytef *>(&res[0]);
+    zs.avail_out = static_cast<uInt>(res.size());
+    ::deflate(&zs, Z_FINISH);
+    res.resize(zs.total_out);
+    ::deflateEnd(&zs);
+
+    return res;
+}
+
+// the median time of one call, in us
+template<typename F>
+static double measure(std::size_t iterations, F &&f) {
+    std::vector<double> res;
+    res.reserve(iterations);
+    for ( std::size_t i = 0; i < iterations; ++i ) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto stop = std::chrono::steady_clock::now();
+        res.push_back(std::chrono::duration<double, std::micro>(stop - start).count());
+    }
+    std::sort(res.begin(), res.end());
+
+    return res[res.size() / 2];
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const char *fname = argc > 1 ? argv[1] : "exinfo.json";
+    const std::size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    // the size of the socket reads, the body is decoded by these parts
+    const std::size_t chunk = 16 * 1024;
+
+    std::ifstream file{fname, std::ios::binary};
+    if ( !file ) {
+        std::cerr << "can't open \"" << fname << "\"" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+    const std::string json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    volatile std::size_t sink{};
+    flatjson::fjson parser;
+    const double parse_us = measure(iterations, [&]{
+        parser.clear();
+        parser.load(json.data(), json.size());
+        sink = parser.size();
+    });
+
+    std::printf("%s: %zu bytes, parsing: %.1f us\n\n", fname, json.size(), parse_us);
+    std::printf("%-10s %10s %7s %12s %10s %10s %10s\n", "encoding", "bytes", "ratio", "inflate, us", "MB/s", "copy, us", "extra CPU");
+
+    // the identity body is copied from the socket buffer to the body buffer, as the parser does it
+    boost::beast::flat_buffer body;
+    const double copy_us = measure(iterations, [&]{
+        body.clear();
+        for ( std::size_t pos = 0; pos < json.size(); pos += chunk ) {
+            const auto n = std::min(chunk, json.size() - pos);
+            auto mb = body.prepare(n);
+            std::memcpy(mb.data(), json.data() + pos, n);
+            body.commit(n);
+        }
+        sink = body.size();
+    });
+    std::printf("%-10s %10zu %7.2f %12s %10s %10.1f %10s\n", "identity", json.size(), 1.0, "-", "-", copy_us, "-");
+
+    struct variant {
+        const char *name;
+        int level;
+        bool gzip;
+    };
+    const variant variants[] = {
+         {"gzip-1", 1, true}
+        ,{"gzip-6", 6, true}
+        ,{"gzip-9", 9, true}
+        ,{"deflate-6", 6, false}
+    };
+
+    binapi::rest::inflater decoder;
+    std::vector<std::pair<std::size_t, double>> results; // bytes, us
+    for ( const auto &it: variants ) {
+        const std::string encoded = compress(json, it.level, it.gzip);
+        const auto encoding = it.gzip
+            ? binapi::rest::inflater::e_encoding::gzip
+            : binapi::rest::inflater::e_encoding::deflate
+        ;
+
+        // the decoded data must be the same
+        body.clear();
+        decoder.reset(encoding);
+        for ( std::size_t pos = 0; pos < encoded.size(); pos += chunk ) {
+            decoder.write(encoded.data() + pos, std::min(chunk, encoded.size() - pos), body);
+        }
+        if ( !decoder.finished() || boost::beast::buffers_to_string(body.data()) != json ) {
+            std::cerr << it.name << ": the decoded data differs" << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        const double inflate_us = measure(iterations, [&]{
+            body.clear();
+            decoder.reset(encoding);
+            for ( std::size_t pos = 0; pos < encoded.size(); pos += chunk ) {
+                decoder.write(encoded.data() + pos, std::min(chunk, encoded.size() - pos), body);
+            }
+            sink = body.size();
+        });
+
+        std::printf(
+             "%-10s %10zu %7.2f %12.1f %10.1f %10s %10.1f\n"
+            ,it.name
+            ,encoded.size()
+            ,static_cast<double>(json.size()) / encoded.size()
+            ,inflate_us
+            ,json.size() / inflate_us
+            ,"-"
+            ,inflate_us - copy_us
+        );
+        results.emplace_back(encoded.size(), inflate_us - copy_us);
+    }
+
+    // the time of the transfer saved minus the extra CPU time, the positive values are the gain
+    const double rates[] = {10, 100, 1000, 10000}; // Mbit/s
+    std::printf("\nthe gain of gzip-6 by the link bandwidth, the transfer time saved minus the extra CPU time:\n");
+    for ( const auto rate: rates ) {
+        const double saved_us = (json.size() - results[1].first) * 8 / rate;
+        std::printf("%6.0f Mbit/s: %10.1f us\n", rate, saved_us - results[1].second);
+    }
+
+    (void)sink;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the submissions of the thread-safe mode by the number of the producer threads: the MPSC queue
+// against the deque under the mutex, as it was before. one consumer, as the strand of the api.
+
+#include <binapi/mpsc_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+/*************************************************************************************************/
+
+struct item: binapi::mpsc_queue_hook {
+    std::size_t value = 0;
+};
+
+struct lockfree_queue {
+    void push(item *v) { m_queue.push(v); }
+    item* pop() { return m_queue.pop(); }
+
+    binapi::mpsc_queue<item> m_queue;
+};
+
+struct locked_queue {
+    void push(item *v) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_queue.push_back(v);
+    }
+    item* pop() {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if ( m_queue.empty() ) {
+            return nullptr;
+        }
+        item *v = m_queue.front();
+        m_queue.pop_front();
+
+        return v;
+    }
+
+    std::mutex m_mutex;
+    std::deque<item *> m_queue;
+};
+
+// the pushes per second, of all the producers, till the consumer has popped all of them
+template<typename Queue>
+static double measure(std::size_t producers, std::size_t per_producer) {
+    std::vector<item> items(producers * per_producer);
+    Queue queue;
+    std::atomic<bool> go{};
+
+    std::vector<std::thread> threads;
+    for ( std::size_t p = 0; p < producers; ++p ) {
+        threads.emplace_back([&, p]() {
+            while ( !go.load(std::memory_order_acquire) )
+            {}
+            for ( std::size_t i = 0; i < per_producer; ++i ) {
+                queue.push(&items[p * per_producer + i]);
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    std::size_t popped = 0;
+    volatile std::size_t sink{};
+    while ( popped < items.size() ) {
+        if ( item *it = queue.pop() ) {
+            sink = it->value;
+            ++popped;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    for ( auto &it: threads ) {
+        it.join();
+    }
+    (void)sink;
+
+    return items.size() / std::chrono::duration<double>(stop - start).count();
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const std::size_t per_producer = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t counts[] = {1, 2, 4, 8};
+
+    std::printf("%u hardware threads, %zu pushes per producer\n\n", std::thread::hardware_concurrency(), per_producer);
+    std::printf("%-10s %16s %16s %8s\n", "producers", "mpsc, ops/s", "mutex, ops/s", "ratio");
+    for ( const auto producers: counts ) {
+        const double mpsc = measure<lockfree_queue>(producers, per_producer);
+        const double locked = measure<locked_queue>(producers, per_producer);
+        std::printf("%-10zu %16.0f %16.0f %8.2f\n", producers, mpsc, locked, mpsc / locked);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,355 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/api.hpp>
+#include <binapi/request.hpp>
+#include <binapi/signer.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/variant.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+
+/*************************************************************************************************/
+// counts the heap allocations by thread, so the ones of the server threads are not counted
+
+static thread_local std::size_t g_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++g_allocations;
+    if ( void *p = std::malloc(size ? size : 1) ) {
+        return p;
+    }
+
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+/*************************************************************************************************/
+// the way the requests were built before: variant params + snprintf + beast::http::request
+
+using val_type = boost::variant<std::size_t, const char *>;
+using kv_type = std::pair<const char *, val_type>;
+using request_type = boost::beast::http::request<boost::beast::http::string_body>;
+
+static std::unique_ptr<request_type> old_build(
+     const binapi::hmac_sha256_signer &signer
+    ,const std::string &host
+    ,const std::string &pk
+    ,const std::string &user_agent
+    ,const char *target
+    ,const std::initializer_list<kv_type> &map
+) {
+    auto to_string = [](char *buf, std::size_t bufsize, const val_type &v) -> const char* {
+        if ( const auto *p = boost::get<const char *>(&v) ) {
+            return *p;
+        }
+        std::snprintf(buf, bufsize, "%zu", boost::get<std::size_t>(v));
+
+        return buf;
+    };
+
+    std::string starget = target;
+    std::string data;
+    for ( const auto &it: map ) {
+        if ( !data.empty() ) {
+            data += "&";
+        }
+        data += it.first;
+        data += "=";
+
+        char buf[32];
+        data += to_string(buf, sizeof(buf), it.second);
+    }
+
+    data += "&timestamp=";
+    char buf[32];
+    data += to_string(buf, sizeof(buf), std::size_t{1625097600000});
+    data += "&recvWindow=";
+    data += to_string(buf, sizeof(buf), std::size_t{10000});
+
+    std::string signature;
+    signer.sign(signature, data.data(), data.size());
+    data += "&signature=";
+    data += signature;
+
+    auto req = std::make_unique<request_type>();
+    req->version(11);
+    req->method(boost::beast::http::verb::post);
+    req->body() = std::move(data);
+    req->set(boost::beast::http::field::content_length, std::to_string(req->body().length()));
+    req->target(starget);
+    req->keep_alive(true);
+    req->insert("X-MBX-APIKEY", pk);
+    req->set(boost::beast::http::field::host, host);
+    req->set(boost::beast::http::field::user_agent, user_agent);
+    req->set(boost::beast::http::field::content_type, "application/x-www-form-urlencoded");
+
+    return req;
+}
+
+/*************************************************************************************************/
+// the local TLS server which replies to each REST request with the same order
+
+static const char *const order_json =
+    "{\"symbol\":\"BTCUSDT\",\"orderId\":28,\"orderListId\":-1,\"clientOrderId\":\"6gCrw2kRUAF9CvJDGP16IP\""
+    ",\"transactTime\":1507725176595,\"price\":\"0.10000000\",\"origQty\":\"10.00000000\""
+    ",\"executedQty\":\"0.00000000\",\"cummulativeQuoteQty\":\"0.00000000\",\"status\":\"NEW\""
+    ",\"timeInForce\":\"GTC\",\"type\":\"LIMIT\",\"side\":\"SELL\"}"
+;
+
+// the self-signed certificate, the client does not verify it
+static void use_self_signed_cert(asio::ssl::context &ctx) {
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    X509_sign(x509, pkey, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), x509);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), pkey);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+}
+
+struct mock_server {
+    using ssl_stream = asio::ssl::stream<asio::ip::tcp::socket>;
+
+    mock_server()
+        :m_ioctx{}
+        ,m_ssl{asio::ssl::context::tls_server}
+        ,m_acceptor{m_ioctx, {asio::ip::address_v4::loopback(), 0}}
+    {
+        use_self_signed_cert(m_ssl);
+
+        // the connections are served by the detached threads, so the server is never destroyed
+        std::thread([this]{ accept(); }).detach();
+    }
+
+    std::string port() const { return std::to_string(m_acceptor.local_endpoint().port()); }
+
+private:
+    void accept() {
+        for ( ;; ) {
+            asio::ip::tcp::socket sock{m_ioctx};
+            m_acceptor.accept(sock);
+            sock.set_option(asio::ip::tcp::no_delay{true});
+            std::thread([this](asio::ip::tcp::socket s){ serve(std::move(s)); }, std::move(sock)).detach();
+        }
+    }
+
+    void serve(asio::ip::tcp::socket sock) {
+        ssl_stream stream{std::move(sock), m_ssl};
+        boost::system::error_code ec;
+        stream.handshake(asio::ssl::stream_base::server, ec);
+
+        beast::flat_buffer buf;
+        while ( !ec ) {
+            beast::http::request<beast::http::string_body> req;
+            beast::http::read(stream, buf, req, ec);
+            if ( ec ) {
+                break;
+            }
+
+            beast::http::response<beast::http::string_body> resp{beast::http::status::ok, 11};
+            resp.set(beast::http::field::content_type, "application/json");
+            resp.body() = req.target() == "/api/v3/ping" ? "{}" : order_json;
+            resp.keep_alive(true);
+            resp.prepare_payload();
+            beast::http::write(stream, resp, ec);
+        }
+    }
+
+    asio::io_context m_ioctx;
+    asio::ssl::context m_ssl;
+    asio::ip::tcp::acceptor m_acceptor;
+};
+
+/*************************************************************************************************/
+
+struct result_t {
+    double per_sec;
+    double allocs;
+};
+
+template<typename F>
+static result_t measure(std::size_t iterations, F &&f) {
+    const auto allocs = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for ( std::size_t i = 0; i < iterations; ++i ) {
+        f();
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    return {
+         iterations / std::chrono::duration<double>(stop - start).count()
+        ,static_cast<double>(g_allocations - allocs) / iterations
+    };
+}
+
+// the async requests are issued one after another, each one from the callback of the previous one.
+// the allocations are counted from the call until the callback, so the parsed reply is counted too
+using done_cb = std::function<void()>;
+
+static result_t measure_async(
+     asio::io_context &ioctx
+    ,std::size_t warmup
+    ,std::size_t iterations
+    ,std::function<void(const done_cb &)> issue)
+{
+    std::size_t done{};
+    std::size_t allocs{};
+    std::chrono::steady_clock::time_point start;
+    std::function<void()> next;
+    // outlives the requests, so their callbacks refer to it
+    const done_cb on_done = [&]() {
+        if ( ++done < warmup + iterations ) {
+            next();
+        }
+    };
+    next = [&]() {
+        if ( done == warmup ) {
+            allocs = g_allocations;
+            start = std::chrono::steady_clock::now();
+        }
+        issue(on_done);
+    };
+
+    next();
+    ioctx.run();
+    ioctx.restart();
+    auto stop = std::chrono::steady_clock::now();
+
+    return {
+         iterations / std::chrono::duration<double>(stop - start).count()
+        ,static_cast<double>(g_allocations - allocs) / iterations
+    };
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    const std::string host = "api.binance.com";
+    const std::string pk = "vmPUZE6mv9SD5VNHk4HlWFsOr6aKE2zvsw0MuIgwCIPy6utIco14y7Ju91duEh8A";
+    const std::string ua = "binapi-0.0.1";
+    const binapi::hmac_sha256_signer signer{"NhqPtmdSJYdKjVHjA7PZj4Mge3R5YNiP1e3UZjInClVN65XAbvqqM6A7H5fATj0j"};
+    const binapi::rest::request_builder builder{host, pk, ua, signer, 10000};
+
+    volatile std::size_t sink{};
+    result_t old = measure(iterations, [&]{
+        auto req = old_build(signer, host, pk, ua, "/api/v3/order", {
+             {"symbol", "BTCUSDT"}
+            ,{"side", "BUY"}
+            ,{"type", "LIMIT"}
+            ,{"timeInForce", "GTC"}
+            ,{"quantity", "0.00100000"}
+            ,{"price", "20000.00000000"}
+            ,{"newOrderRespType", "RESULT"}
+        });
+        sink = req->body().size();
+    });
+
+    // the per-connection buffers
+    std::string wire, query;
+    auto build = [&]{
+        builder.build(wire, query, true, 1625097600000, "/api/v3/order", boost::beast::http::verb::post, {
+             {"symbol", "BTCUSDT"}
+            ,{"side", "BUY"}
+            ,{"type", "LIMIT"}
+            ,{"timeInForce", "GTC"}
+            ,{"quantity", "0.00100000"}
+            ,{"price", "20000.00000000"}
+            ,{"newClientOrderId", static_cast<const char *>(nullptr)}
+            ,{"newOrderRespType", "RESULT"}
+        }, false);
+        sink = wire.size();
+    };
+    // the first request grows the buffers
+    build();
+    result_t cur = measure(iterations, build);
+    (void)sink;
+
+    // the whole async path: queueing, signing, the I/O over the pooled connection and the parsing
+    auto *server = new mock_server;
+    asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), pk, "sk", 5000};
+    // the orders limits of the exchange would throttle the benchmark
+    api.set_rate_limits({
+         {"REQUEST_WEIGHT", "MINUTE", 1, 100000000}
+        ,{"RAW_REQUESTS", "MINUTE", 5, 100000000}
+        ,{"ORDERS", "SECOND", 10, 100000000}
+    });
+
+    const std::size_t round_trips = iterations / 100;
+    result_t ping = measure_async(ioctx, 100, round_trips, [&api](const done_cb &done) {
+        api.ping([&done](const char *, int, std::string, binapi::rest::ping_t) {
+            done();
+            return true;
+        });
+    });
+    // the completion token overload, with the plain handler
+    result_t token = measure_async(ioctx, 100, round_trips, [&api](const done_cb &done) {
+        api.ping([&done](binapi::rest::api::result<binapi::rest::ping_t>) { done(); });
+    });
+    result_t order = measure_async(ioctx, 100, round_trips, [&api](const done_cb &done) {
+        api.new_order(
+             "BTCUSDT", binapi::e_side::sell, binapi::e_type::limit, binapi::e_time::GTC
+            ,binapi::e_trade_resp_type::RESULT, "10", "0.1", nullptr, nullptr, nullptr
+            ,[&done](const char *, int, std::string, binapi::rest::new_order_resp_type) {
+                done();
+                return true;
+             }
+        );
+    });
+
+    std::cout << "iterations     : " << iterations << std::endl;
+    std::cout << "request object : " << static_cast<std::uint64_t>(old.per_sec) << " requests/sec, "
+        << old.allocs << " allocations/request" << std::endl;
+    std::cout << "request_builder: " << static_cast<std::uint64_t>(cur.per_sec) << " requests/sec, "
+        << cur.allocs << " allocations/request" << std::endl;
+    std::cout << "async ping     : " << static_cast<std::uint64_t>(ping.per_sec) << " requests/sec, "
+        << ping.allocs << " allocations/request" << std::endl;
+    std::cout << "async ping(tok): " << static_cast<std::uint64_t>(token.per_sec) << " requests/sec, "
+        << token.allocs << " allocations/request" << std::endl;
+    std::cout << "async new_order: " << static_cast<std::uint64_t>(order.per_sec) << " requests/sec, "
+        << order.allocs << " allocations/request" << std::endl;
+
+    return cur.allocs == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
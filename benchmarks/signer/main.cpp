@@ -0,0 +1,201 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/signer.hpp>
+
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+
+/*************************************************************************************************/
+
+// the way the requests were signed before: one-shot HMAC() with the raw key + hex to a new string
+static std::string oneshot_hmac_sha256(const std::string &key, const std::string &data) {
+    static const char hex[] = "0123456789abcdef";
+    std::uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int dilen{};
+
+    ::HMAC(
+         ::EVP_sha256()
+        ,key.data()
+        ,static_cast<int>(key.size())
+        ,reinterpret_cast<const std::uint8_t *>(data.data())
+        ,data.size()
+        ,digest
+        ,&dilen
+    );
+
+    std::string res;
+    res.reserve(dilen * 2);
+    for ( unsigned int i = 0; i < dilen; ++i ) {
+        res += hex[(digest[i] >> 4) & 0x0F];
+        res += hex[digest[i] & 0x0F];
+    }
+
+    return res;
+}
+
+// the way rsa_sha256() did it: a new context initialized with the key for each signature
+static std::size_t oneshot_sign(EVP_PKEY *pkey, const EVP_MD *md, const std::string &data, std::uint8_t *sig) {
+    EVP_MD_CTX *ctx = ::EVP_MD_CTX_new();
+    std::size_t len = EVP_MAX_MD_SIZE * 16;
+    ::EVP_DigestSignInit(ctx, nullptr, md, nullptr, pkey);
+    ::EVP_DigestSign(ctx, sig, &len, reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
+    ::EVP_MD_CTX_free(ctx);
+
+    return len;
+}
+
+static EVP_PKEY* generate_key(int type) {
+    EVP_PKEY *pkey = nullptr;
+    EVP_PKEY_CTX *ctx = ::EVP_PKEY_CTX_new_id(type, nullptr);
+    ::EVP_PKEY_keygen_init(ctx);
+    if ( type == EVP_PKEY_RSA ) {
+        ::EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048);
+    }
+    ::EVP_PKEY_keygen(ctx, &pkey);
+    ::EVP_PKEY_CTX_free(ctx);
+
+    return pkey;
+}
+
+static std::string to_pem(EVP_PKEY *pkey) {
+    BIO *bio = ::BIO_new(::BIO_s_mem());
+    ::PEM_write_bio_PrivateKey(bio, pkey, nullptr, nullptr, 0, nullptr, nullptr);
+    char *ptr = nullptr;
+    const long len = ::BIO_get_mem_data(bio, &ptr);
+    std::string res(ptr, static_cast<std::size_t>(len));
+    ::BIO_free(bio);
+
+    return res;
+}
+
+static bool verify(EVP_PKEY *pkey, const EVP_MD *md, const std::string &data, const std::string &signature) {
+    std::uint8_t sig[EVP_MAX_MD_SIZE * 16];
+    const int len = ::EVP_DecodeBlock(sig, reinterpret_cast<const std::uint8_t *>(signature.data()), static_cast<int>(signature.size()));
+    if ( len < ::EVP_PKEY_size(pkey) ) {
+        return false;
+    }
+
+    EVP_MD_CTX *ctx = ::EVP_MD_CTX_new();
+    const bool ok = ::EVP_DigestVerifyInit(ctx, nullptr, md, nullptr, pkey) == 1
+        && ::EVP_DigestVerify(ctx, sig, static_cast<std::size_t>(::EVP_PKEY_size(pkey)), reinterpret_cast<const std::uint8_t *>(data.data()), data.size()) == 1
+    ;
+    ::EVP_MD_CTX_free(ctx);
+
+    return ok;
+}
+
+template<typename F>
+static double measure(std::size_t iterations, F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    for ( std::size_t i = 0; i < iterations; ++i ) {
+        f();
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    return iterations / std::chrono::duration<double>(stop - start).count();
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    const std::string key = "NhqPtmdSJYdKjVHjA7PZj4Mge3R5YNiP1e3UZjInClVN65XAbvqqM6A7H5fATj0j";
+    const std::string data =
+        "symbol=BTCUSDT&side=BUY&type=LIMIT&timeInForce=GTC&quantity=0.00100000&price=20000.00000000"
+        "&newOrderRespType=RESULT&timestamp=1625097600000&recvWindow=10000"
+    ;
+
+    binapi::hmac_sha256_signer signer{key};
+
+    std::string expected = oneshot_hmac_sha256(key, data);
+    std::string signature;
+    signer.sign(signature, data.data(), data.size());
+    if ( signature != expected ) {
+        std::cerr << "signatures mismatch: " << signature << " != " << expected << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    volatile char sink{};
+    double oneshot = measure(iterations, [&]{
+        sink = oneshot_hmac_sha256(key, data)[0];
+    });
+
+    char buf[binapi::hmac_sha256_signer::hex_size];
+    double precomputed = measure(iterations, [&]{
+        signer.sign(buf, data.data(), data.size());
+        sink = buf[0];
+    });
+
+    std::cout << "iterations : " << iterations << std::endl;
+    std::cout << "HMAC()     : " << static_cast<std::uint64_t>(oneshot) << " signatures/sec" << std::endl;
+    std::cout << "signer     : " << static_cast<std::uint64_t>(precomputed) << " signatures/sec" << std::endl;
+
+    // the asymmetric schemes are much slower, so fewer iterations
+    struct scheme {
+        const char *name;
+        int type;
+        const EVP_MD *md;
+        std::size_t iterations;
+    };
+    const scheme schemes[] = {
+         {"RSA-2048", EVP_PKEY_RSA, ::EVP_sha256(), iterations / 1000 + 1}
+        ,{"Ed25519", EVP_PKEY_ED25519, nullptr, iterations / 20 + 1}
+    };
+    for ( const auto &it: schemes ) {
+        EVP_PKEY *pkey = generate_key(it.type);
+        const std::string pem = to_pem(pkey);
+        std::unique_ptr<binapi::signer> asigner;
+        if ( it.type == EVP_PKEY_RSA ) {
+            asigner = std::make_unique<binapi::rsa_sha256_signer>(pem);
+        } else {
+            asigner = std::make_unique<binapi::ed25519_signer>(pem);
+        }
+
+        std::string asignature;
+        asigner->sign(asignature, data.data(), data.size());
+        if ( !verify(pkey, it.md, data, asignature) ) {
+            std::cerr << it.name << ": the signature is not valid" << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        std::uint8_t sig[EVP_MAX_MD_SIZE * 16];
+        double percall = measure(it.iterations, [&]{
+            oneshot_sign(pkey, it.md, data, sig);
+            sink = static_cast<char>(sig[0]);
+        });
+
+        std::string abuf(asigner->max_size(), '\0');
+        double cached = measure(it.iterations, [&]{
+            asigner->sign(&abuf[0], data.data(), data.size());
+            sink = abuf[0];
+        });
+
+        std::cout << it.name << ", per-call context : " << static_cast<std::uint64_t>(percall) << " signatures/sec" << std::endl;
+        std::cout << it.name << ", signer           : " << static_cast<std::uint64_t>(cached) << " signatures/sec" << std::endl;
+
+        ::EVP_PKEY_free(pkey);
+    }
+
+    (void)sink;
+
+    return EXIT_SUCCESS;
+}
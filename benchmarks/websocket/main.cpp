@@ -0,0 +1,341 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/websocket.hpp>
+#include <binapi/types.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+
+/*************************************************************************************************/
+// the heap allocations are counted by thread, so the ones of the server threads are not counted
+
+static thread_local std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if ( void *p = std::malloc(size ? size : 1) ) {
+        return p;
+    }
+
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+/*************************************************************************************************/
+// the local TLS server which streams the same trade to each connection until it's closed.
+// to the '/stream?streams=...' target it's sent in the envelope of the combined stream
+
+static const char *const trade_json =
+    "{\"e\":\"trade\",\"E\":1672515782136,\"s\":\"BTCUSDT\",\"t\":12345,\"p\":\"16500.01000000\""
+    ",\"q\":\"0.00100000\",\"b\":88,\"a\":50,\"T\":1672515782136,\"m\":true,\"M\":true}"
+;
+
+// the self-signed certificate, the client does not verify it
+static void use_self_signed_cert(asio::ssl::context &ctx) {
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    X509_sign(x509, pkey, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), x509);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), pkey);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+}
+
+struct mock_server {
+    using ssl_stream = asio::ssl::stream<asio::ip::tcp::socket>;
+
+    mock_server()
+        :m_ioctx{}
+        ,m_ssl{asio::ssl::context::tls_server}
+        ,m_acceptor{m_ioctx, {asio::ip::address_v4::loopback(), 0}}
+    {
+        use_self_signed_cert(m_ssl);
+
+        // the connections are served by the detached threads, so the server is never destroyed
+        std::thread([this]{ accept(); }).detach();
+    }
+
+    std::string port() const { return std::to_string(m_acceptor.local_endpoint().port()); }
+
+private:
+    void accept() {
+        for ( ;; ) {
+            asio::ip::tcp::socket sock{m_ioctx};
+            m_acceptor.accept(sock);
+            sock.set_option(asio::ip::tcp::no_delay{true});
+            std::thread([this](asio::ip::tcp::socket s){ serve(std::move(s)); }, std::move(sock)).detach();
+        }
+    }
+
+    void serve(asio::ip::tcp::socket sock) {
+        // the connection has its own io_context: the messages are written while the close frame of
+        // the client is read and answered, as the real server does. otherwise the close blocks
+        asio::io_context ioctx;
+        asio::ip::tcp::socket s{ioctx};
+        s.assign(asio::ip::tcp::v4(), sock.release());
+
+        beast::websocket::stream<ssl_stream> ws{std::move(s), m_ssl};
+        boost::system::error_code ec;
+        ws.next_layer().handshake(asio::ssl::stream_base::server, ec);
+
+        beast::flat_buffer buf;
+        beast::http::request<beast::http::empty_body> req;
+        if ( !ec ) {
+            beast::http::read(ws.next_layer(), buf, req, ec);
+        }
+        if ( !ec ) {
+            ws.accept(req, ec);
+        }
+        if ( ec ) {
+            return;
+        }
+
+        std::string msg;
+        if ( req.target().starts_with("/stream") ) {
+            msg = "{\"stream\":\"btcusdt@trade\",\"data\":";
+            msg += trade_json;
+            msg += '}';
+        } else {
+            msg = trade_json;
+        }
+
+        ws.text(true);
+        std::function<void()> read = [&]() {
+            ws.async_read(buf, [&](const boost::system::error_code &ec, std::size_t) {
+                if ( !ec ) {
+                    buf.consume(buf.size());
+                    read();
+                }
+            });
+        };
+        std::function<void()> write = [&]() {
+            ws.async_write(asio::buffer(msg), [&](const boost::system::error_code &ec, std::size_t) {
+                if ( !ec ) {
+                    write();
+                }
+            });
+        };
+
+        buf.consume(buf.size());
+        read();
+        write();
+        ioctx.run();
+    }
+
+    asio::io_context m_ioctx;
+    asio::ssl::context m_ssl;
+    asio::ip::tcp::acceptor m_acceptor;
+};
+
+/*************************************************************************************************/
+
+struct counters {
+    std::size_t messages;
+    std::size_t bytes;
+    std::size_t copied; // the bytes copied out of the read buffer
+    std::size_t allocations;
+    std::chrono::steady_clock::duration elapsed;
+};
+
+// the messages after the warmup are counted, so the ones of the connection are not
+struct meter {
+    meter(std::size_t warmup, std::size_t num)
+        :m_warmup{warmup}
+        ,m_num{num}
+        ,m_seen{}
+        ,m_start_allocations{}
+        ,m_start{}
+        ,m_res{}
+    {}
+
+    // returns false when the measurement is completed
+    bool on_message(std::size_t size, std::size_t copied) {
+        if ( ++m_seen == m_warmup ) {
+            m_start = std::chrono::steady_clock::now();
+            m_start_allocations = allocations;
+
+            return true;
+        }
+        if ( m_seen < m_warmup ) {
+            return true;
+        }
+
+        m_res.messages += 1;
+        m_res.bytes += size;
+        m_res.copied += copied;
+        if ( m_res.messages < m_num ) {
+            return true;
+        }
+
+        m_res.elapsed = std::chrono::steady_clock::now() - m_start;
+        m_res.allocations = allocations - m_start_allocations;
+
+        return false;
+    }
+    bool done() const { return m_res.messages == m_num; }
+    const counters& result() const { return m_res; }
+
+private:
+    const std::size_t m_warmup;
+    const std::size_t m_num;
+    std::size_t m_seen;
+    std::size_t m_start_allocations;
+    std::chrono::steady_clock::time_point m_start;
+    counters m_res;
+};
+
+static void report(const char *name, const counters &c) {
+    const double secs = std::chrono::duration<double>(c.elapsed).count();
+    std::printf(
+         "%-32s: rate=%10.0f msg/s, size=%5.1f B/msg, copied=%6.1f B/msg, allocs=%5.2f/msg\n"
+        ,name
+        ,c.messages / secs
+        ,static_cast<double>(c.bytes) / c.messages
+        ,static_cast<double>(c.copied) / c.messages
+        ,static_cast<double>(c.allocations) / c.messages
+    );
+}
+
+/*************************************************************************************************/
+// the read path of the websocket alone, over the plain beast stream
+
+template<typename F>
+static counters read_loop(const std::string &port, std::size_t warmup, std::size_t num, F read) {
+    asio::io_context ioctx;
+    asio::ssl::context ssl{asio::ssl::context::tls_client};
+    beast::websocket::stream<asio::ssl::stream<asio::ip::tcp::socket>> ws{ioctx, ssl};
+
+    asio::ip::tcp::resolver resolver{ioctx};
+    asio::connect(ws.next_layer().next_layer(), resolver.resolve("127.0.0.1", port));
+    ws.next_layer().handshake(asio::ssl::stream_base::client);
+    ws.handshake("127.0.0.1", "/ws/btcusdt@trade");
+
+    meter m{warmup, num};
+    while ( read(ws, m) )
+    {}
+
+    boost::system::error_code ec;
+    ws.next_layer().next_layer().close(ec);
+
+    return m.result();
+}
+
+// as websocket::on_read() did before: the message is assembled from the multi_buffer into the string
+static counters bench_multi_buffer(const std::string &port, std::size_t warmup, std::size_t num) {
+    beast::multi_buffer buf;
+    return read_loop(port, warmup, num, [&buf](auto &ws, meter &m) {
+        ws.read(buf);
+
+        std::string strbuf;
+        strbuf.reserve(buf.size());
+        for ( const auto &it: buf.data() ) {
+            strbuf.append(static_cast<const char *>(it.data()), it.size());
+        }
+        buf.consume(buf.size());
+
+        return m.on_message(strbuf.size(), strbuf.size());
+    });
+}
+
+// as websocket::on_read() does now: the message is passed right from the storage of the flat_buffer
+static counters bench_flat_buffer(const std::string &port, std::size_t warmup, std::size_t num) {
+    beast::flat_buffer buf;
+    return read_loop(port, warmup, num, [&buf](auto &ws, meter &m) {
+        ws.read(buf);
+
+        const auto size = buf.size();
+        const bool ok = m.on_message(size, 0);
+        buf.consume(size);
+
+        return ok;
+    });
+}
+
+/*************************************************************************************************/
+// the whole path of ws::websockets, up to the typed callback
+
+static counters bench_websockets(const std::string &port, std::size_t warmup, std::size_t num, std::size_t combined) {
+    asio::io_context ioctx;
+    // the raw message is seen before the typed callback is called
+    std::size_t size{};
+    binapi::ws::websockets ws{
+         ioctx
+        ,"127.0.0.1"
+        ,port
+        ,[&size](const char *, const char *, std::size_t n) { size = n; }
+    };
+    ws.set_combined_streams(combined);
+
+    meter m{warmup, num};
+    ws.trade("BTCUSDT", [&m, &size](const char *, int ec, std::string, binapi::ws::trade_t) {
+        if ( ec ) {
+            std::cerr << "trade error: ec=" << ec << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+
+        return m.on_message(size, 0);
+    });
+
+    while ( !m.done() ) {
+        ioctx.run_one();
+    }
+
+    return m.result();
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const std::size_t warmup = 1000;
+    const std::size_t num = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    auto *server = new mock_server;
+    const auto port = server->port();
+
+    report("read: multi_buffer + string", bench_multi_buffer(port, warmup, num));
+    report("read: flat_buffer in place", bench_flat_buffer(port, warmup, num));
+    report("ws::websockets::trade", bench_websockets(port, warmup, num, 0));
+    report("ws::websockets::trade combined", bench_websockets(port, warmup, num, 1024));
+
+    return EXIT_SUCCESS;
+}
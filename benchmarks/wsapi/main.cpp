@@ -0,0 +1,286 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/api.hpp>
+#include <binapi/wsapi.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+
+/*************************************************************************************************/
+// the heap allocations are counted by thread, so the ones of the server threads are not counted
+
+static thread_local std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if ( void *p = std::malloc(size ? size : 1) ) {
+        return p;
+    }
+
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+/*************************************************************************************************/
+// the local TLS server which accepts the REST requests and the ws-api frames,
+// and replies to each of them with the same order
+
+static const char *const order_json =
+    "{\"symbol\":\"BTCUSDT\",\"orderId\":28,\"orderListId\":-1,\"clientOrderId\":\"6gCrw2kRUAF9CvJDGP16IP\""
+    ",\"transactTime\":1507725176595,\"price\":\"0.10000000\",\"origQty\":\"10.00000000\""
+    ",\"executedQty\":\"0.00000000\",\"cummulativeQuoteQty\":\"0.00000000\",\"status\":\"NEW\""
+    ",\"timeInForce\":\"GTC\",\"type\":\"LIMIT\",\"side\":\"SELL\"}"
+;
+
+// the self-signed certificate, the client does not verify it
+static void use_self_signed_cert(asio::ssl::context &ctx) {
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    X509_sign(x509, pkey, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), x509);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), pkey);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+}
+
+struct mock_server {
+    using ssl_stream = asio::ssl::stream<asio::ip::tcp::socket>;
+
+    mock_server()
+        :m_ioctx{}
+        ,m_ssl{asio::ssl::context::tls_server}
+        ,m_http{m_ioctx, {asio::ip::address_v4::loopback(), 0}}
+        ,m_ws{m_ioctx, {asio::ip::address_v4::loopback(), 0}}
+    {
+        use_self_signed_cert(m_ssl);
+
+        // the connections are served by the detached threads, so the server is never destroyed
+        std::thread([this]{ accept(m_http, [this](asio::ip::tcp::socket s){ serve_http(std::move(s)); }); }).detach();
+        std::thread([this]{ accept(m_ws, [this](asio::ip::tcp::socket s){ serve_ws(std::move(s)); }); }).detach();
+    }
+
+    std::string http_port() const { return std::to_string(m_http.local_endpoint().port()); }
+    std::string ws_port() const { return std::to_string(m_ws.local_endpoint().port()); }
+
+private:
+    template<typename F>
+    void accept(asio::ip::tcp::acceptor &acceptor, F serve) {
+        for ( ;; ) {
+            asio::ip::tcp::socket sock{m_ioctx};
+            acceptor.accept(sock);
+            sock.set_option(asio::ip::tcp::no_delay{true});
+            std::thread(serve, std::move(sock)).detach();
+        }
+    }
+
+    void serve_http(asio::ip::tcp::socket sock) {
+        ssl_stream stream{std::move(sock), m_ssl};
+        boost::system::error_code ec;
+        stream.handshake(asio::ssl::stream_base::server, ec);
+
+        beast::flat_buffer buf;
+        while ( !ec ) {
+            beast::http::request<beast::http::string_body> req;
+            beast::http::read(stream, buf, req, ec);
+            if ( ec ) {
+                break;
+            }
+
+            beast::http::response<beast::http::string_body> resp{beast::http::status::ok, 11};
+            resp.set(beast::http::field::content_type, "application/json");
+            resp.body() = order_json;
+            resp.keep_alive(true);
+            resp.prepare_payload();
+            beast::http::write(stream, resp, ec);
+        }
+    }
+
+    void serve_ws(asio::ip::tcp::socket sock) {
+        beast::websocket::stream<ssl_stream> ws{std::move(sock), m_ssl};
+        boost::system::error_code ec;
+        ws.next_layer().handshake(asio::ssl::stream_base::server, ec);
+        if ( !ec ) {
+            ws.accept(ec);
+        }
+
+        beast::flat_buffer buf;
+        while ( !ec ) {
+            buf.consume(buf.size());
+            ws.read(buf, ec);
+            if ( ec ) {
+                break;
+            }
+
+            // {"id":N,...
+            const std::string req = beast::buffers_to_string(buf.data());
+            const auto beg = req.find("\"id\":") + 5;
+            const auto end = req.find(',', beg);
+
+            std::string resp = "{\"id\":";
+            resp.append(req, beg, end - beg);
+            resp += ",\"status\":200,\"result\":";
+            resp += order_json;
+            resp += '}';
+
+            ws.text(true);
+            ws.write(asio::buffer(resp), ec);
+        }
+    }
+
+    asio::io_context m_ioctx;
+    asio::ssl::context m_ssl;
+    asio::ip::tcp::acceptor m_http;
+    asio::ip::tcp::acceptor m_ws;
+};
+
+/*************************************************************************************************/
+// the orders are placed one after another, each one as soon as the previous one is completed
+
+using done_cb = std::function<void(bool ok)>;
+
+struct sample {
+    double latency; // us
+    std::size_t allocations; // from the call until the callback, the response is parsed by then
+};
+
+static std::vector<sample> measure(asio::io_context &ioctx, std::size_t num, std::function<void(done_cb)> issue) {
+    std::vector<sample> res;
+    res.reserve(num);
+
+    std::size_t errors{};
+    std::chrono::steady_clock::time_point start;
+    std::size_t start_allocations{};
+    std::function<void()> next = [&]() {
+        start = std::chrono::steady_clock::now();
+        start_allocations = allocations;
+        issue([&](bool ok) {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            res.push_back({
+                 std::chrono::duration<double, std::micro>(elapsed).count()
+                ,allocations - start_allocations
+            });
+            errors += !ok;
+            if ( res.size() < num ) {
+                next();
+            }
+        });
+    };
+
+    next();
+    // the ws-api session keeps the io_context busy, so it can't be just run()
+    while ( res.size() < num ) {
+        ioctx.run_one();
+    }
+    if ( errors ) {
+        std::cerr << "errors: " << errors << std::endl;
+    }
+
+    return res;
+}
+
+static void report(const char *name, std::vector<sample> samples, std::size_t warmup) {
+    samples.erase(samples.begin(), samples.begin() + warmup);
+
+    std::vector<double> lat;
+    lat.reserve(samples.size());
+    double sum{};
+    std::size_t allocs{};
+    for ( const auto &it: samples ) {
+        lat.push_back(it.latency);
+        sum += it.latency;
+        allocs += it.allocations;
+    }
+    std::sort(lat.begin(), lat.end());
+
+    std::printf(
+         "%-26s: mean=%8.1f us, p50=%8.1f us, p99=%8.1f us, max=%8.1f us, allocs=%6.1f/op\n"
+        ,name
+        ,sum / lat.size()
+        ,lat[lat.size() / 2]
+        ,lat[lat.size() * 99 / 100]
+        ,lat.back()
+        ,static_cast<double>(allocs) / samples.size()
+    );
+}
+
+/*************************************************************************************************/
+
+int main(int argc, char **argv) {
+    const std::size_t warmup = 100;
+    const std::size_t num = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+
+    auto *server = new mock_server;
+    asio::io_context ioctx;
+
+    binapi::rest::api rest{ioctx, "127.0.0.1", server->http_port(), "pk", "sk", 5000};
+    // the orders limits of the exchange would throttle the benchmark
+    rest.set_rate_limits({
+         {"REQUEST_WEIGHT", "MINUTE", 1, 100000000}
+        ,{"RAW_REQUESTS", "MINUTE", 5, 100000000}
+        ,{"ORDERS", "SECOND", 10, 100000000}
+    });
+    binapi::wsapi::client wsapi{ioctx, "127.0.0.1", server->ws_port(), "pk", "sk", 5000};
+
+    auto rest_lat = measure(ioctx, warmup + num, [&rest](done_cb done) {
+        rest.new_order(
+             "BTCUSDT", binapi::e_side::sell, binapi::e_type::limit, binapi::e_time::GTC
+            ,binapi::e_trade_resp_type::RESULT, "10", "0.1", nullptr, nullptr, nullptr
+            ,[done](const char *, int ec, std::string, binapi::rest::new_order_resp_type)
+             { done(!ec); return true; }
+        );
+    });
+    auto wsapi_lat = measure(ioctx, warmup + num, [&wsapi](done_cb done) {
+        wsapi.new_order(
+             "BTCUSDT", binapi::e_side::sell, binapi::e_type::limit, binapi::e_time::GTC
+            ,binapi::e_trade_resp_type::RESULT, "10", "0.1", nullptr, nullptr, nullptr
+            ,[done](const char *, int ec, std::string, binapi::rest::new_order_resp_type)
+             { done(!ec); return true; }
+        );
+    });
+
+    report("rest::api::new_order", std::move(rest_lat), warmup);
+    report("wsapi::client::new_order", std::move(wsapi_lat), warmup);
+
+    return EXIT_SUCCESS;
+}
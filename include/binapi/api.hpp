@@ -14,31 +14,68 @@
 
 #include "types.hpp"
 #include "enums.hpp"
-
+#include "rate_limiter.hpp"
+#include "clock_sync.hpp"
+#include "signer.hpp"
+#include "latency_stats.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+
+#include <atomic>
 #include <memory>
 #include <functional>
+#include <type_traits>
 
-namespace boost {
-namespace asio {
-
-class io_context;
+namespace binapi {
+namespace detail {
+
+// anything that can't be the callback of the endpoint returning 'R' is the asio completion token
+template<typename Token, typename R>
+using enable_if_completion_token = typename std::enable_if<
+    !std::is_constructible<
+         std::function<bool(const char *fl, int ec, std::string errmsg, R res)>
+        ,Token
+    >::value
+>::type;
+
+// the copy of the string argument of the completion token overloads, for the lazy tokens which
+// issue the request after the call. keeps the null pointer of the optional arguments.
+struct owned_cstr {
+    explicit owned_cstr(const char *s)
+        :str{s ? s : ""}
+        ,null{s == nullptr}
+    {}
+
+    const char* get() const { return null ? nullptr : str.c_str(); }
+
+    std::string str;
+    bool null;
+};
 
-} // ns asio
-} // ns boost
+} // ns detail
 
-namespace binapi {
 namespace rest {
 
 /*************************************************************************************************/
 
 struct api {
+    // identifies the async request. zero for the sync requests.
+    using request_handle = std::uint64_t;
+
     template<typename T>
     struct result {
         result()
             :ec{0}
+            ,handle{0}
         {}
 
         int ec;
+        request_handle handle;
         std::string errmsg;
         std::string reply;
         T v;
@@ -56,11 +93,110 @@ struct api {
         ,std::size_t timeout
         ,std::string client_api_string = "binapi-0.0.1"
     );
+    // the requests are signed by the 'signer' instead of the HMAC-SHA256 of the secret key,
+    // for the RSA and Ed25519 API keys: std::make_shared<ed25519_signer>(read_key_file("key.pem"))
+    // NOTE: throws std::invalid_argument if the 'signer' is null.
+    api(
+         boost::asio::io_context &ioctx
+        ,std::string host
+        ,std::string port
+        ,std::string pk
+        ,std::shared_ptr<const signer> signer
+        ,std::size_t timeout
+        ,std::string client_api_string = "binapi-0.0.1"
+    );
     virtual ~api();
 
     api(const api &) = delete;
     api(api &&) = default;
 
+    boost::asio::io_context& get_io_context();
+
+    // the requests are sent over the HTTP/1.1 keep-alive connections, which are kept in the pool
+    // for reusing by the subsequent requests. by default up to 4 idle connections are kept, for 30 seconds.
+    void set_max_idle_connections(std::size_t num);
+    void set_idle_timeout(std::size_t seconds);
+    // how many async requests can be on the wire at the same time, each of them uses its own connection.
+    // the rest are queued and sent as soon as any of the in-flight requests is completed. default is 8.
+    void set_max_inflight_requests(std::size_t num);
+    // the requests are passed through the client side governor of the REQUEST_WEIGHT/ORDERS limits.
+    // the limits are taken from the exchange_info() replies, the usage - from the response headers.
+    // by default the request that would breach a limit is delayed. the sync request made on the
+    // io_context thread is rejected instead, the delay would block the thread.
+    void set_rate_limit_policy(rate_limiter::e_policy policy);
+    void set_rate_limits(const std::vector<exchange_info_t::rate_limit_t> &limits);
+    std::vector<rate_limiter::headroom_t> rate_limits_headroom() const;
+    // the deadline of the async requests, counted from the call, including the time in the queue.
+    // when it expires the callback is called with TIMEOUT error. default is 10000 ms, zero means no deadline.
+    void set_default_deadline(std::size_t ms);
+    // the deadline for the next async request only:
+    //     api.with_deadline(50).new_order(..., cb);
+    api& with_deadline(std::size_t ms);
+    // the callback of the cancelled request is called with 'operation_aborted' error.
+    // returns false if the request is already completed. must be called from the io_context thread,
+    // or from any thread in the thread-safe mode, see set_thread_safe().
+    bool cancel(request_handle handle);
+
+    // the queued async requests are sent in the order of priority, FIFO within the same priority.
+    // by default the priority is chosen by the endpoint: new/cancel order - order_entry, other signed
+    // requests and user data stream - account, the rest - market_data.
+    enum class e_priority {
+         order_entry
+        ,account
+        ,market_data
+    };
+    // how many of the in-flight requests can be the market_data ones, so they can't take all
+    // the connections. default is 4.
+    void set_max_inflight_bulk_requests(std::size_t num);
+    // the priority for the next async request only:
+    //     api.with_priority(api::e_priority::order_entry).order_info(..., cb);
+    api& with_priority(e_priority priority);
+
+    // for the case when the io_context is run by the dedicated thread, and the sync requests are
+    // made from the other threads: such a request is passed to the io_context thread as the async
+    // one, and the caller waits for its completion. so the sync requests share the connections, the
+    // queues and the rate limiter with the async ones, and never block the io_context thread.
+    // the sync requests made from the io_context thread itself are executed in place as usual, and
+    // so is the request which the io_context doesn't pick up in 100 ms, e.g. when it's not run.
+    // NOTE: in this mode only the endpoints may be called from the other threads, and the 'reply'
+    //       member of the result of the request passed to the io_context thread is empty.
+    void set_dedicated_io_thread(bool enable);
+
+    // for the io_context which is run by several threads, and the requests made from any thread.
+    // the async requests are passed by the lock-free queue to the strand which owns the queues of
+    // the requests, the connections and the limits. each connection has its own strand for the I/O,
+    // the parsing and the callbacks, so the requests are completed in parallel, and the callbacks
+    // are called concurrently. the one-shot with_deadline() and with_priority() are per thread.
+    // the settings can be changed from any thread, and are applied to the async requests on the
+    // strand. cancel() called off the strand is completed on it, so it returns true for any handle
+    // that was issued. the sync requests are executed in place as usual.
+    // NOTE: must be called before any request is made.
+    void set_thread_safe(bool enable);
+
+    // the timestamps of the signed requests are taken from the estimate of the server clock, so
+    // the offset and the drift of the local clock don't get them rejected, and the recvWindow can
+    // be small. the server time is sampled in the background, by the burst of the requests every
+    // 'seconds'. zero (default) stops it, the last estimate is still used.
+    // NOTE: while the sampling is running, the io_context is never out of work.
+    void set_clock_sync_interval(std::size_t seconds);
+    // takes the samples by the sync requests, e.g. before the io_context is run
+    void sync_clock(std::size_t samples = 4);
+    // the estimate, also for the latency of the server timestamps, e.g. of the websocket messages
+    const clock_sync& get_clock_sync() const;
+
+    // the requests are timed by the stages, both sync and async ones, and the durations are kept
+    // in the histograms per endpoint. it's cheap, a few clock reads per request. enabled by default.
+    void enable_latency_stats(bool enable);
+    // can be called from any thread
+    std::vector<latency_stats::endpoint_snapshot_t> latency_stats_snapshot() const;
+    void reset_latency_stats();
+
+    // the responses of the endpoint are requested compressed, and decompressed while they are read.
+    // it saves the bandwidth and the transfer time of the big responses, but costs the CPU time,
+    // so it's not worth it for the small ones. enabled by default for "/api/v3/exchangeInfo",
+    // "/api/v3/ticker/24hr", "/api/v3/ticker/price" and "/api/v3/depth".
+    void set_compression(const char *target, bool enable);
+
     // https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md#test-connectivity
     using ping_cb = std::function<bool(const char *fl, int ec, std::string errmsg, ping_t res)>;
     result<ping_t>
@@ -310,6 +446,120 @@ struct api {
     result<cancel_order_info_t>
     cancel_order(const char *symbol, std::size_t order_id, const char *client_order_id, const char *new_client_order_id, cancel_order_cb cb = {});
 
+    // https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md#cancel-an-existing-order-and-send-a-new-order-trade
+    // the order is cancelled and the new one is placed atomically, by one request.
+    // the order to cancel is identified by 'cancel_order_id' or 'cancel_client_order_id'.
+    // when one of them failed the 'ec' is not zero, but the 'res' is still valid: its 'cancelResult'
+    // and 'newOrderResult' tell which one.
+    using cancel_replace_order_cb = std::function<bool(const char *fl, int ec, std::string errmsg, cancel_replace_order_info_t res)>;
+    result<cancel_replace_order_info_t>
+    cancel_replace_order(
+         const std::string &symbol
+        ,const e_cancel_replace_mode mode
+        ,std::size_t cancel_order_id
+        ,const std::string &cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const std::string &amount
+        ,const std::string &price
+        ,const std::string &client_order_id
+        ,const std::string &stop_price
+        ,const std::string &iceberg_amount
+        ,cancel_replace_order_cb cb = {}
+    ) {
+        return cancel_replace_order(
+             symbol.c_str()
+            ,mode
+            ,cancel_order_id
+            ,(cancel_client_order_id.empty() ? nullptr : cancel_client_order_id.c_str())
+            ,side
+            ,type
+            ,time
+            ,resp
+            ,(amount.empty() ? nullptr : amount.c_str())
+            ,(price.empty() ? nullptr : price.c_str())
+            ,(client_order_id.empty() ? nullptr : client_order_id.c_str())
+            ,(stop_price.empty() ? nullptr : stop_price.c_str())
+            ,(iceberg_amount.empty() ? nullptr : iceberg_amount.c_str())
+            ,std::move(cb)
+        );
+    }
+    result<cancel_replace_order_info_t>
+    cancel_replace_order(
+         const char *symbol
+        ,const e_cancel_replace_mode mode
+        ,std::size_t cancel_order_id
+        ,const char *cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,cancel_replace_order_cb cb = {}
+    );
+
+    // the client side requote: the cancel_order() and the new_order() are sent at once, each over
+    // its own connection, so they take one round trip instead of two sequential ones.
+    // unlike cancel_replace_order() it's not atomic: the new order is placed even if the cancel
+    // fails, and the exchange may execute it first. the result is combined in the same way,
+    // 'cancelResult' and 'newOrderResult' are SUCCESS or FAILURE, and the error is the one of the
+    // cancel if it failed, otherwise the one of the new order.
+    // the handle of the result is the one of the new order. the sync call sends the requests one after another.
+    result<cancel_replace_order_info_t>
+    requote(
+         const std::string &symbol
+        ,std::size_t cancel_order_id
+        ,const std::string &cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const std::string &amount
+        ,const std::string &price
+        ,const std::string &client_order_id
+        ,const std::string &stop_price
+        ,const std::string &iceberg_amount
+        ,cancel_replace_order_cb cb = {}
+    ) {
+        return requote(
+             symbol.c_str()
+            ,cancel_order_id
+            ,(cancel_client_order_id.empty() ? nullptr : cancel_client_order_id.c_str())
+            ,side
+            ,type
+            ,time
+            ,resp
+            ,(amount.empty() ? nullptr : amount.c_str())
+            ,(price.empty() ? nullptr : price.c_str())
+            ,(client_order_id.empty() ? nullptr : client_order_id.c_str())
+            ,(stop_price.empty() ? nullptr : stop_price.c_str())
+            ,(iceberg_amount.empty() ? nullptr : iceberg_amount.c_str())
+            ,std::move(cb)
+        );
+    }
+    result<cancel_replace_order_info_t>
+    requote(
+         const char *symbol
+        ,std::size_t cancel_order_id
+        ,const char *cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,cancel_replace_order_cb cb = {}
+    );
+
     // https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md#cancel-all-open-orders-on-a-symbol-trade
     using cancel_all_open_orders_cb = std::function<bool(const char *fl, int ec, std::string errmsg, cancel_all_open_orders_info_t res)>;
     result<cancel_all_open_orders_info_t>
@@ -356,7 +606,404 @@ struct api {
     result<close_user_data_stream_t>
     close_user_data_stream(const char *listen_key, close_user_data_stream_cb cb = {});
 
+    // the async versions of the endpoints above, which take the asio completion token instead of
+    // the callback. the completion signature is 'void(api::result<R>)', so in a coroutine:
+    //     auto res = co_await api.new_order("BTCUSDT", ..., boost::asio::use_awaitable);
+    //     if ( !res ) { std::cout << res.errmsg << std::endl; }
+    // the dependent requests are chained without blocking the io_context thread.
+    // any asio completion token can be used: the handler 'void(api::result<R>)', 'use_future',
+    // 'use_awaitable', or 'deferred' where the boost in use provides it.
+    // NOTE: with the lazy tokens(like 'use_awaitable') the request is issued when the operation is
+    //       awaited, so the string arguments are copied by the operation.
+    template<typename Token, typename = detail::enable_if_completion_token<Token, ping_t>>
+    auto ping(Token &&token)
+    { return async_call<ping_t>(std::forward<Token>(token), [this](ping_cb cb){ return ping(std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, server_time_t>>
+    auto server_time(Token &&token)
+    { return async_call<server_time_t>(std::forward<Token>(token), [this](server_time_cb cb){ return server_time(std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, exchange_info_t>>
+    auto exchange_info(Token &&token)
+    { return async_call<exchange_info_t>(std::forward<Token>(token), [this](exchange_info_cb cb){ return exchange_info(std::move(cb)); }); }
+    template<typename Token, typename = detail::enable_if_completion_token<Token, exchange_info_t>>
+    auto exchange_info(const char *symbol, Token &&token)
+    { return async_call<exchange_info_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](exchange_info_cb cb){ return exchange_info(symbol.get(), std::move(cb)); }); }
+    template<typename Token, typename = detail::enable_if_completion_token<Token, exchange_info_t>>
+    auto exchange_info(const std::vector<std::string> &symbols, Token &&token)
+    { return async_call<exchange_info_t>(std::forward<Token>(token), [this, symbols](exchange_info_cb cb){ return exchange_info(symbols, std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, depths_t>>
+    auto depths(const char *symbol, std::size_t limit, Token &&token)
+    { return async_call<depths_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}, limit](depths_cb cb){ return depths(symbol.get(), limit, std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, trades_t::trade_t>>
+    auto trade(const char *symbol, Token &&token)
+    { return async_call<trades_t::trade_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](trade_cb cb){ return trade(symbol.get(), std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, trades_t>>
+    auto trades(const char *symbol, std::size_t limit, Token &&token)
+    { return async_call<trades_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}, limit](trades_cb cb){ return trades(symbol.get(), limit, std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, prices_t::price_t>>
+    auto price(const char *symbol, Token &&token)
+    { return async_call<prices_t::price_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](price_cb cb){ return price(symbol.get(), std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, prices_t>>
+    auto prices(Token &&token)
+    { return async_call<prices_t>(std::forward<Token>(token), [this](prices_cb cb){ return prices(std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, avg_price_t>>
+    auto avg_price(const char *symbol, Token &&token)
+    { return async_call<avg_price_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](avg_price_cb cb){ return avg_price(symbol.get(), std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, _24hrs_tickers_t::_24hrs_ticker_t>>
+    auto _24hrs_ticker(const char *symbol, Token &&token)
+    { return async_call<_24hrs_tickers_t::_24hrs_ticker_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](_24hrs_ticker_cb cb){ return _24hrs_ticker(symbol.get(), std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, _24hrs_tickers_t>>
+    auto _24hrs_tickers(Token &&token)
+    { return async_call<_24hrs_tickers_t>(std::forward<Token>(token), [this](_24hrs_tickers_cb cb){ return _24hrs_tickers(std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, agg_trades_t::agg_trade_t>>
+    auto agg_trade(const char *symbol, Token &&token)
+    { return async_call<agg_trades_t::agg_trade_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](agg_trade_cb cb){ return agg_trade(symbol.get(), std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, agg_trades_t>>
+    auto agg_trades(const char *symbol, std::size_t limit, Token &&token)
+    { return async_call<agg_trades_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}, limit](agg_trades_cb cb){ return agg_trades(symbol.get(), limit, std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, klines_t>>
+    auto klines(const char *symbol, const char *interval, std::size_t limit, Token &&token)
+    { return async_call<klines_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}, interval=detail::owned_cstr{interval}, limit](klines_cb cb){ return klines(symbol.get(), interval.get(), limit, std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, account_info_t>>
+    auto account_info(Token &&token)
+    { return async_call<account_info_t>(std::forward<Token>(token), [this](account_info_cb cb){ return account_info(std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, order_info_t>>
+    auto order_info(const char *symbol, std::size_t orderid, const char *client_orderid, Token &&token) {
+        return async_call<order_info_t>(
+             std::forward<Token>(token)
+            ,[this, symbol=detail::owned_cstr{symbol}, orderid, client_orderid=detail::owned_cstr{client_orderid}](order_info_cb cb)
+             { return order_info(symbol.get(), orderid, client_orderid.get(), std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, orders_info_t>>
+    auto open_orders(const char *symbol, Token &&token)
+    { return async_call<orders_info_t>(std::forward<Token>(token), [this, symbol=detail::owned_cstr{symbol}](open_orders_cb cb){ return open_orders(symbol.get(), std::move(cb)); }); }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, orders_info_t>>
+    auto all_orders(
+         const char *symbol
+        ,std::size_t orderid
+        ,std::size_t start_time
+        ,std::size_t end_time
+        ,std::size_t limit
+        ,Token &&token
+    ) {
+        return async_call<orders_info_t>(
+             std::forward<Token>(token)
+            ,[this, symbol=detail::owned_cstr{symbol}, orderid, start_time, end_time, limit](all_orders_cb cb)
+             { return all_orders(symbol.get(), orderid, start_time, end_time, limit, std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, new_order_resp_type>>
+    auto new_order(
+         const char *symbol
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,Token &&token
+    ) {
+        return async_call<new_order_resp_type>(
+             std::forward<Token>(token)
+            ,[
+                 this
+                ,symbol=detail::owned_cstr{symbol}
+                ,side
+                ,type
+                ,time
+                ,resp
+                ,amount=detail::owned_cstr{amount}
+                ,price=detail::owned_cstr{price}
+                ,client_order_id=detail::owned_cstr{client_order_id}
+                ,stop_price=detail::owned_cstr{stop_price}
+                ,iceberg_amount=detail::owned_cstr{iceberg_amount}
+             ]
+             (new_order_cb cb) {
+                return new_order(
+                     symbol.get(), side, type, time, resp, amount.get(), price.get()
+                    ,client_order_id.get(), stop_price.get(), iceberg_amount.get(), std::move(cb)
+                );
+             }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, new_order_resp_type>>
+    auto new_test_order(
+         const char *symbol
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,Token &&token
+    ) {
+        return async_call<new_order_resp_type>(
+             std::forward<Token>(token)
+            ,[
+                 this
+                ,symbol=detail::owned_cstr{symbol}
+                ,side
+                ,type
+                ,time
+                ,resp
+                ,amount=detail::owned_cstr{amount}
+                ,price=detail::owned_cstr{price}
+                ,client_order_id=detail::owned_cstr{client_order_id}
+                ,stop_price=detail::owned_cstr{stop_price}
+                ,iceberg_amount=detail::owned_cstr{iceberg_amount}
+             ]
+             (new_order_cb cb) {
+                return new_test_order(
+                     symbol.get(), side, type, time, resp, amount.get(), price.get()
+                    ,client_order_id.get(), stop_price.get(), iceberg_amount.get(), std::move(cb)
+                );
+             }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, cancel_order_info_t>>
+    auto cancel_order(const char *symbol, std::size_t order_id, const char *client_order_id, const char *new_client_order_id, Token &&token) {
+        return async_call<cancel_order_info_t>(
+             std::forward<Token>(token)
+            ,[this, symbol=detail::owned_cstr{symbol}, order_id, client_order_id=detail::owned_cstr{client_order_id}, new_client_order_id=detail::owned_cstr{new_client_order_id}](cancel_order_cb cb)
+             { return cancel_order(symbol.get(), order_id, client_order_id.get(), new_client_order_id.get(), std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, cancel_replace_order_info_t>>
+    auto cancel_replace_order(
+         const char *symbol
+        ,const e_cancel_replace_mode mode
+        ,std::size_t cancel_order_id
+        ,const char *cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,Token &&token
+    ) {
+        return async_call<cancel_replace_order_info_t>(
+             std::forward<Token>(token)
+            ,[
+                 this
+                ,symbol=detail::owned_cstr{symbol}
+                ,mode
+                ,cancel_order_id
+                ,cancel_client_order_id=detail::owned_cstr{cancel_client_order_id}
+                ,side
+                ,type
+                ,time
+                ,resp
+                ,amount=detail::owned_cstr{amount}
+                ,price=detail::owned_cstr{price}
+                ,client_order_id=detail::owned_cstr{client_order_id}
+                ,stop_price=detail::owned_cstr{stop_price}
+                ,iceberg_amount=detail::owned_cstr{iceberg_amount}
+             ]
+             (cancel_replace_order_cb cb) {
+                return cancel_replace_order(
+                     symbol.get(), mode, cancel_order_id, cancel_client_order_id.get(), side, type, time, resp, amount.get(), price.get()
+                    ,client_order_id.get(), stop_price.get(), iceberg_amount.get(), std::move(cb)
+                );
+             }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, cancel_replace_order_info_t>>
+    auto requote(
+         const char *symbol
+        ,std::size_t cancel_order_id
+        ,const char *cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,Token &&token
+    ) {
+        return async_call<cancel_replace_order_info_t>(
+             std::forward<Token>(token)
+            ,[
+                 this
+                ,symbol=detail::owned_cstr{symbol}
+                ,cancel_order_id
+                ,cancel_client_order_id=detail::owned_cstr{cancel_client_order_id}
+                ,side
+                ,type
+                ,time
+                ,resp
+                ,amount=detail::owned_cstr{amount}
+                ,price=detail::owned_cstr{price}
+                ,client_order_id=detail::owned_cstr{client_order_id}
+                ,stop_price=detail::owned_cstr{stop_price}
+                ,iceberg_amount=detail::owned_cstr{iceberg_amount}
+             ]
+             (cancel_replace_order_cb cb) {
+                return requote(
+                     symbol.get(), cancel_order_id, cancel_client_order_id.get(), side, type, time, resp, amount.get(), price.get()
+                    ,client_order_id.get(), stop_price.get(), iceberg_amount.get(), std::move(cb)
+                );
+             }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, cancel_all_open_orders_info_t>>
+    auto cancel_all_open_orders(const char *symbol, Token &&token) {
+        return async_call<cancel_all_open_orders_info_t>(
+             std::forward<Token>(token)
+            ,[this, symbol=detail::owned_cstr{symbol}](cancel_all_open_orders_cb cb)
+             { return cancel_all_open_orders(symbol.get(), std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, my_trades_info_t>>
+    auto my_trades(
+         const char *symbol
+        ,std::size_t start_time
+        ,std::size_t end_time
+        ,std::size_t from_id
+        ,std::size_t limit
+        ,Token &&token
+    ) {
+        return async_call<my_trades_info_t>(
+             std::forward<Token>(token)
+            ,[this, symbol=detail::owned_cstr{symbol}, start_time, end_time, from_id, limit](my_trades_cb cb)
+             { return my_trades(symbol.get(), start_time, end_time, from_id, limit, std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, start_user_data_stream_t>>
+    auto start_user_data_stream(Token &&token) {
+        return async_call<start_user_data_stream_t>(
+             std::forward<Token>(token)
+            ,[this](start_user_data_stream_cb cb)
+             { return start_user_data_stream(std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, ping_user_data_stream_t>>
+    auto ping_user_data_stream(const char *listen_key, Token &&token) {
+        return async_call<ping_user_data_stream_t>(
+             std::forward<Token>(token)
+            ,[this, listen_key=detail::owned_cstr{listen_key}](ping_user_data_stream_cb cb)
+             { return ping_user_data_stream(listen_key.get(), std::move(cb)); }
+        );
+    }
+
+    template<typename Token, typename = detail::enable_if_completion_token<Token, close_user_data_stream_t>>
+    auto close_user_data_stream(const char *listen_key, Token &&token) {
+        return async_call<close_user_data_stream_t>(
+             std::forward<Token>(token)
+            ,[this, listen_key=detail::owned_cstr{listen_key}](close_user_data_stream_cb cb)
+             { return close_user_data_stream(listen_key.get(), std::move(cb)); }
+        );
+    }
+
 private:
+    // 'issue' is called with the callback for the endpoint when the operation is initiated
+    template<typename R, typename Token, typename Issue>
+    auto async_call(Token &&token, Issue issue) {
+        return boost::asio::async_initiate<Token, void(result<R>)>(
+             [this](auto handler, Issue issue) {
+                using handler_type = decltype(handler);
+                using executor_type = boost::asio::associated_executor_t<handler_type, boost::asio::io_context::executor_type>;
+                struct state {
+                    state(handler_type h, executor_type e)
+                        :handler{std::move(h)}
+                        ,ex{std::move(e)}
+                        ,handle{0}
+                    {}
+
+                    handler_type handler;
+                    executor_type ex;
+                    std::atomic<request_handle> handle; // the callback can be called on the other thread
+                    result<R> res;
+                };
+
+                auto ex = boost::asio::get_associated_executor(handler, get_io_context().get_executor());
+                // the callback is the std::function, so the handler(which can be move-only) is shared.
+                // the state and its counter are one allocation, by the allocator of the handler
+                auto sp = std::allocate_shared<state>(
+                     boost::asio::get_associated_allocator(handler)
+                    ,std::move(handler)
+                    ,std::move(ex)
+                );
+                auto cb = [sp](const char *fl, int ec, std::string errmsg, R v) mutable {
+                    auto &res = sp->res;
+                    res.ec = ec;
+                    res.handle = sp->handle;
+                    if ( ec || !errmsg.empty() ) {
+                        if ( fl ) {
+                            res.errmsg = fl;
+                            res.errmsg += ": ";
+                        }
+                        res.errmsg += errmsg;
+                    }
+                    res.v = std::move(v);
+
+                    auto ex = sp->ex;
+                    boost::asio::dispatch(
+                         ex
+                        ,[sp=std::move(sp)]() mutable
+                         { sp->handler(std::move(sp->res)); }
+                    );
+
+                    return true;
+                };
+
+                result<R> res = issue(std::move(cb));
+                if ( !res ) {
+                    // was not queued, so the callback will not be called
+                    sp->res = std::move(res);
+                    auto ex = sp->ex;
+                    boost::asio::post(
+                         ex
+                        ,[sp=std::move(sp)]() mutable
+                         { sp->handler(std::move(sp->res)); }
+                    );
+                } else {
+                    sp->handle = res.handle;
+                }
+             }
+            ,token
+            ,std::move(issue)
+        );
+    }
+
     struct impl;
     std::unique_ptr<impl> pimpl;
 };
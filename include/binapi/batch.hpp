@@ -0,0 +1,165 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__batch_hpp
+#define __binapi__batch_hpp
+
+#include "api.hpp"
+
+#include <boost/asio/io_context.hpp>
+
+#include <cassert>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+// issues many async requests of the same type, and waits for all of them.
+// the requests go through the api's queues, so they are sent concurrently within the in-flight
+// and the rate limits, without the default deadline: the request may wait for the limits longer.
+// the waiting is done by running the api's io_context on the caller's thread, so join(), stream()
+// and the destructor of the unfinished batch must not be called from the io_context's handlers:
+//     rest::batch<rest::orders_info_t> batch{api};
+//     for ( const auto &it: symbols ) {
+//         batch.add([&it](rest::api &api, auto cb){ return api.open_orders(it, std::move(cb)); });
+//     }
+//     for ( auto &it: batch.join() ) { ... } // in the order of add()
+// or, to process the results as soon as they arrive:
+//     batch.stream([](std::size_t idx, rest::api::result<rest::orders_info_t> &res){ ... });
+template<typename R>
+struct batch {
+    using result_type = api::result<R>;
+    using stream_cb = std::function<void(std::size_t idx, result_type &res)>;
+
+    explicit batch(api &api)
+        :m_api{api}
+        ,m_results{}
+        ,m_done{}
+        ,m_pending{}
+        ,m_cb{}
+    {}
+
+    // the requests which are still in progress are cancelled
+    ~batch() {
+        if ( m_pending ) {
+            cancel();
+            run();
+        }
+    }
+
+    batch(const batch &) = delete;
+    batch& operator= (const batch &) = delete;
+
+    // 'issue' is called immediately with the api and the callback to be passed to the api's method.
+    // returns the index of the request.
+    template<typename F>
+    std::size_t add(F &&issue) {
+        const std::size_t idx = m_results.size();
+        m_results.emplace_back();
+        m_done.push_back(false);
+        ++m_pending;
+
+        auto cb = [this, idx](const char *fl, int ec, std::string errmsg, R res) {
+            on_result(idx, fl, ec, std::move(errmsg), std::move(res));
+            return true;
+        };
+        result_type res = issue(m_api.with_deadline(0), std::move(cb));
+        if ( !res ) {
+            // was not queued
+            on_result(idx, nullptr, res.ec, std::move(res.errmsg), R{});
+        } else if ( !m_done[idx] ) {
+            m_results[idx].handle = res.handle;
+        }
+
+        return idx;
+    }
+
+    std::size_t size() const { return m_results.size(); }
+
+    // waits for all the requests, and returns the results in the order of add()
+    std::vector<result_type> join() {
+        run();
+
+        return std::move(m_results);
+    }
+
+    // waits for all the requests, 'cb' is called for each of them in the order of completion
+    void stream(stream_cb cb) {
+        m_cb = std::move(cb);
+        for ( std::size_t idx = 0; idx < m_results.size(); ++idx ) {
+            if ( m_done[idx] ) {
+                m_cb(idx, m_results[idx]);
+            }
+        }
+
+        run();
+        m_cb = nullptr;
+    }
+
+    // cancels all the requests which are not completed yet
+    void cancel() {
+        for ( std::size_t idx = 0; idx < m_results.size(); ++idx ) {
+            if ( !m_done[idx] ) {
+                m_api.cancel(m_results[idx].handle);
+            }
+        }
+    }
+
+private:
+    void on_result(std::size_t idx, const char *fl, int ec, std::string errmsg, R res) {
+        auto &it = m_results[idx];
+        it.ec = ec;
+        if ( ec || !errmsg.empty() ) {
+            if ( fl ) {
+                it.errmsg = fl;
+                it.errmsg += ": ";
+            }
+            it.errmsg += errmsg;
+        }
+        it.v = std::move(res);
+
+        m_done[idx] = true;
+        --m_pending;
+
+        if ( m_cb ) {
+            m_cb(idx, it);
+        }
+    }
+
+    void run() {
+        auto &ioctx = m_api.get_io_context();
+        // the handler that runs the io_context again would be re-entered by its own completions
+        assert(!ioctx.get_executor().running_in_this_thread());
+        while ( m_pending ) {
+            if ( ioctx.stopped() ) {
+                ioctx.restart();
+            }
+            ioctx.run_one();
+        }
+    }
+
+    api &m_api;
+    std::vector<result_type> m_results;
+    std::vector<bool> m_done;
+    std::size_t m_pending;
+    stream_cb m_cb;
+};
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
+
+#endif // __binapi__batch_hpp
@@ -0,0 +1,65 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__clock_sync_hpp
+#define __binapi__clock_sync_hpp
+
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+// the estimator of the server clock, from the samples of the server time requests.
+// as NTP does, each sample assumes the server time was taken in the middle of the round trip,
+// so its error is at most the half of the RTT. of the last 'window' samples the one with the
+// smallest RTT is used, so the samples delayed by the queue or the network are ignored, and the
+// offset and the drift are smoothed across them.
+// the server clock is tracked against the steady_clock, so the steps of the local system_clock
+// don't break the estimate. until the first sample the local system_clock is used as is.
+// can be used from any thread.
+struct clock_sync {
+    explicit clock_sync(std::size_t window = 8);
+    ~clock_sync();
+
+    // 'sent' and 'received' are the local times when the request is written and when the first
+    // byte of the response is read, 'server_time' is the time from the response, in ms since epoch.
+    void add_sample(
+         std::chrono::steady_clock::time_point sent
+        ,std::chrono::steady_clock::time_point received
+        ,std::uint64_t server_time
+    );
+
+    // at least one sample was taken
+    bool synced() const;
+    // the current server time, in ms since epoch
+    std::uint64_t now_ms() const;
+    // the server time minus the local system_clock, in ms
+    std::int64_t offset_ms() const;
+    // how many microseconds per second the local clock runs slower than the server one
+    double drift_ppm() const;
+    // the half of the best RTT, the bound of the estimate error
+    std::chrono::microseconds uncertainty() const;
+    // how old the event stamped by the server is, e.g. the 'E' of the websocket messages, in ms
+    std::int64_t latency_ms(std::uint64_t event_time) const;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+} // ns binapi
+
+#endif // __binapi__clock_sync_hpp
@@ -0,0 +1,72 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__dns_cache_hpp
+#define __binapi__dns_cache_hpp
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <memory>
+#include <functional>
+#include <string>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+// the cache of the resolved endpoints keyed by host:port.
+// one instance per io_context is shared by all the rest::api and ws::websockets working on it:
+//     auto &cache = boost::asio::use_service<binapi::dns_cache>(ioctx);
+//     cache.set_ttl(60);
+// the entry used after its TTL expired is re-resolved in background while the previous endpoints
+// are still used, and if the resolving fails the last successfully resolved endpoints are used.
+// the sync lookups are refreshed on the cache's own thread, so they block only on the first lookup
+// of the host. no timers are involved, so the cache does not keep the io_context running.
+struct dns_cache: boost::asio::io_context::service {
+    static boost::asio::io_context::id id;
+
+    using results_type = boost::asio::ip::tcp::resolver::results_type;
+    using resolve_cb = std::function<void(const boost::system::error_code &ec, results_type res)>;
+
+    explicit dns_cache(boost::asio::io_context &ioctx);
+    ~dns_cache();
+
+    // in seconds. default is 60.
+    void set_ttl(std::size_t seconds);
+
+    results_type resolve(const std::string &host, const std::string &port, boost::system::error_code &ec);
+    // NOTE: if the endpoints are cached - the 'cb' is called before returning.
+    template<typename CB>
+    void async_resolve(const std::string &host, const std::string &port, CB cb) {
+        // 'cb' can be move-only
+        auto holder = std::make_shared<CB>(std::move(cb));
+        async_resolve_impl(
+             host
+            ,port
+            ,[holder](const boost::system::error_code &ec, results_type res)
+             { (*holder)(ec, std::move(res)); }
+        );
+    }
+
+private:
+    void async_resolve_impl(const std::string &host, const std::string &port, resolve_cb cb);
+    void shutdown() override;
+
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+} // ns binapi
+
+#endif // __binapi__dns_cache_hpp
@@ -104,6 +104,16 @@ const char* e_permissions_to_string(e_permissions resp);
 
 /*************************************************************************************************/
 
+enum class e_cancel_replace_mode: std::size_t {
+     STOP_ON_FAILURE
+    ,ALLOW_FAILURE
+};
+
+e_cancel_replace_mode e_cancel_replace_mode_from_string(const char *str);
+const char* e_cancel_replace_mode_to_string(e_cancel_replace_mode mode);
+
+/*************************************************************************************************/
+
 } // ns binapi
 
 #endif // __binapi__enums_hpp
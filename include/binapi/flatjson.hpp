@@ -991,7 +991,8 @@ inline parse_result fj_num_tokens(Iterator beg, Iterator end) {
     parser.js_cur = beg;
     parser.js_end = end;
 
-    static fj_token<Iterator> fake;
+    // not static: the responses are counted by the io threads concurrently
+    fj_token<Iterator> fake;
     parser.jstok_beg = &fake;
     parser.jstok_cur = &fake;
     parser.jstok_end = nullptr;
@@ -0,0 +1,156 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__inflater_hpp
+#define __binapi__inflater_hpp
+
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/buffers_range.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+// the streaming decoder of the 'gzip' and 'deflate' content encodings, on top of zlib.
+// the zlib state is allocated on the first use and then only reset for the next streams.
+struct inflater {
+    enum class e_encoding { identity, gzip, deflate, unsupported };
+    // by the value of the 'Content-Encoding' header field
+    static e_encoding encoding_of(boost::beast::string_view content_encoding);
+
+    inflater();
+    ~inflater();
+
+    inflater(const inflater &) = delete;
+    inflater& operator= (const inflater &) = delete;
+
+    // starts the new stream
+    void reset(e_encoding encoding);
+    e_encoding encoding() const;
+
+    // decodes the next part of the stream and appends the output to 'dst'.
+    // the data after the end of the stream is ignored. when 'dst' would grow over 'limit'
+    // the 'body_limit' error is returned.
+    boost::system::error_code write(
+         const void *ptr
+        ,std::size_t size
+        ,boost::beast::flat_buffer &dst
+        ,std::size_t limit = std::numeric_limits<std::size_t>::max()
+    );
+    // the end of the stream was decoded
+    bool finished() const;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+// the body of the response which is decoded while it's read, according to its 'Content-Encoding'.
+// the decoded data is in the contiguous 'buffer'.
+// the body limit of the parser is of the encoded size, so the decoded one is limited by 'limit'.
+struct inflating_body {
+    // the same as the default body limit of the response parser
+    static constexpr std::size_t default_limit = 8 * 1024 * 1024;
+
+    struct value_type {
+        boost::beast::flat_buffer buffer;
+        inflater *decoder = nullptr; // if not set, the encoded bodies are rejected
+        std::size_t encoded_size = 0; // as received
+        std::size_t limit = default_limit; // of the decoded size
+    };
+
+    class reader {
+    public:
+        // the reader is constructed with the parser, before the header is read
+        template<bool isRequest, typename Fields>
+        reader(boost::beast::http::header<isRequest, Fields> &h, value_type &body)
+            :m_header{&h}
+            ,m_encoding_of{[](const void *h) {
+                const auto &header = *static_cast<const boost::beast::http::header<isRequest, Fields> *>(h);
+                return inflater::encoding_of(header[boost::beast::http::field::content_encoding]);
+             }}
+            ,m_body{body}
+            ,m_encoding{inflater::e_encoding::identity}
+        {}
+
+        void init(const boost::optional<std::uint64_t> &, boost::system::error_code &ec) {
+            ec = {};
+            m_encoding = m_encoding_of(m_header);
+            m_body.encoded_size = 0;
+            if ( m_encoding == inflater::e_encoding::identity ) {
+                return;
+            }
+            if ( m_encoding == inflater::e_encoding::unsupported || !m_body.decoder ) {
+                ec = boost::beast::http::error::bad_field;
+                return;
+            }
+
+            m_body.decoder->reset(m_encoding);
+        }
+
+        template<typename ConstBufferSequence>
+        std::size_t put(const ConstBufferSequence &buffers, boost::system::error_code &ec) {
+            ec = {};
+            std::size_t size = 0;
+            for ( const auto it: boost::beast::buffers_range_ref(buffers) ) {
+                if ( m_encoding == inflater::e_encoding::identity ) {
+                    if ( m_body.buffer.size() + it.size() > m_body.limit ) {
+                        ec = boost::beast::http::error::body_limit;
+                        return size;
+                    }
+                    auto mb = m_body.buffer.prepare(it.size());
+                    std::memcpy(mb.data(), it.data(), it.size());
+                    m_body.buffer.commit(it.size());
+                } else {
+                    ec = m_body.decoder->write(it.data(), it.size(), m_body.buffer, m_body.limit);
+                    if ( ec ) {
+                        return size;
+                    }
+                }
+                size += it.size();
+            }
+            m_body.encoded_size += size;
+
+            return size;
+        }
+
+        void finish(boost::system::error_code &ec) {
+            ec = {};
+            if ( m_encoding != inflater::e_encoding::identity && !m_body.decoder->finished() ) {
+                ec = boost::beast::http::error::partial_message;
+            }
+        }
+
+    private:
+        const void *m_header;
+        inflater::e_encoding (*m_encoding_of)(const void *header);
+        value_type &m_body;
+        inflater::e_encoding m_encoding;
+    };
+};
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
+
+#endif // __binapi__inflater_hpp
@@ -13,6 +13,7 @@
 #define __binapi__invoker_hpp
 
 #include <memory>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <cstdio>
@@ -27,11 +28,21 @@ namespace detail {
 /*************************************************************************************************/
 
 struct invoker_base {
-    virtual bool invoke(const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size) = 0;
+    virtual ~invoker_base() = default;
+    // 'json' is the parser whose tokens storage is reused, so its capacity persists across the responses.
+    // 'ptr' is not required to be null-terminated.
+    // 'parse_time' is set to the time of the parsing and the construction of the result
+    virtual bool invoke(
+         const char *fl
+        ,int ec
+        ,std::string errmsg
+        ,flatjson::fjson &json
+        ,const char *ptr
+        ,std::size_t size
+        ,std::chrono::nanoseconds &parse_time
+    ) = 0;
 };
 
-using invoker_ptr = std::shared_ptr<invoker_base>;
-
 /*************************************************************************************************/
 
 template<typename R, typename T, typename F>
@@ -41,30 +52,59 @@ struct invoker: invoker_base {
     {}
     virtual ~invoker() = default;
 
-    bool invoke(const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size) override {
+    bool invoke(
+         const char *fl
+        ,int ec
+        ,std::string errmsg
+        ,flatjson::fjson &json
+        ,const char *ptr
+        ,std::size_t size
+        ,std::chrono::nanoseconds &parse_time) override
+    {
         try {
             if ( !size || ec ) {
                 T arg{};
                 return m_cb(fl, ec, std::move(errmsg), std::move(arg));
             } else {
-                const flatjson::fjson json{ptr, size};
-                if ( json.error() != flatjson::FJ_EC_OK ) {
+                const auto start = std::chrono::steady_clock::now();
+                json.clear();
+                if ( !json.load(ptr, size) ) {
+                    const auto error = json.error();
+                    // the error state is sticky
+                    json = flatjson::fjson{};
                     T arg{};
-                    return m_cb(__MAKE_FILELINE, json.error(), json.error_string(), std::move(arg));
+                    return m_cb(__MAKE_FILELINE, error, flatjson::fj_error_string(error), std::move(arg));
                 }
 
                 if ( json.is_object() && binapi::rest::is_api_error(json) ) {
                     auto error = binapi::rest::construct_error(json);
                     T arg{};
+                    // the partial result, e.g. of the failed cancel-replace, is in the 'data'
+                    if ( json.contains("data") ) {
+                        try {
+                            arg = T::construct(json.at("data"));
+                        } catch (const std::exception &) {
+                            arg = T{};
+                        }
+                    }
+                    parse_time = std::chrono::steady_clock::now() - start;
                     return m_cb(__MAKE_FILELINE, error.first, std::move(error.second), std::move(arg));
                 } else {
-                    T arg = T::construct(json);
+                    T arg{};
+                    try {
+                        arg = T::construct(json);
+                    } catch (const std::exception &ex) {
+                        // the callback must be called anyway, someone may be waiting for it
+                        return m_cb(__MAKE_FILELINE, static_cast<int>(binapi::rest::e_error::UNEXPECTED_RESP), ex.what(), T{});
+                    }
+                    parse_time = std::chrono::steady_clock::now() - start;
+
                     return m_cb(__MAKE_FILELINE, 0, std::move(errmsg), std::move(arg));
                 }
             }
         } catch (const std::exception &ex) {
             std::fprintf(stderr, "%s: ex=%s\n", __MAKE_FILELINE, ex.what());
-            std::fprintf(stderr, "size=%u, ptr=%s\n", (unsigned)size, ptr);
+            std::fprintf(stderr, "size=%u, ptr=%.*s\n", (unsigned)size, (int)size, ptr);
             std::fflush(stderr);
         }
 
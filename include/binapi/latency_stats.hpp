@@ -0,0 +1,192 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__latency_stats_hpp
+#define __binapi__latency_stats_hpp
+
+#include <boost/beast/http/verb.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+// the log-linear histogram of the durations, as HdrHistogram does: each power of two range is
+// split into 16 buckets, so the value is kept with the precision of ~6%, from 1ns up to ~18 min.
+// it's written without the locks, by the requests completed on any thread, and can be read at the same time.
+struct latency_histogram {
+    enum: std::size_t {
+         sub_bits = 4
+        ,sub_count = 1u << sub_bits
+        ,max_bits = 40
+        ,buckets = (max_bits - sub_bits + 1) * sub_count
+    };
+
+    struct snapshot_t {
+        std::uint64_t count;
+        std::chrono::nanoseconds sum;
+        std::chrono::nanoseconds min;
+        std::chrono::nanoseconds max;
+        std::vector<std::uint64_t> counts; // by bucket
+
+        std::chrono::nanoseconds mean() const;
+        // 'p' is in the range [0, 100]
+        std::chrono::nanoseconds percentile(double p) const;
+
+        friend std::ostream &operator<<(std::ostream &os, const snapshot_t &o);
+    };
+
+    latency_histogram();
+
+    void record(std::chrono::nanoseconds v);
+    void reset();
+
+    snapshot_t snapshot() const;
+
+    static std::size_t bucket_of(std::uint64_t v);
+    // the middle of the bucket
+    static std::uint64_t value_of(std::size_t bucket);
+
+private:
+    std::array<std::atomic<std::uint64_t>, buckets> m_counts;
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_min;
+    std::atomic<std::uint64_t> m_max;
+};
+
+/*************************************************************************************************/
+
+// the latency of the REST requests by the stages of their lifecycle, per endpoint.
+struct latency_stats {
+    enum class e_stage {
+         queue       // in the queue of the async requests, including the rate limiter delay
+        ,sign        // the request is built and signed
+        ,dns         // the host name is resolved, for the new connection only
+        ,connect     // TCP connect, for the new connection only
+        ,handshake   // TLS handshake, for the new connection only
+        ,write       // the request is written
+        ,first_byte  // from the request written until the response header is read
+        ,read        // the response body is read
+        ,parse       // JSON parsing and the result construction
+        ,total       // from the call until the result is ready, without the callback
+    };
+    enum: std::size_t { stage_count = static_cast<std::size_t>(e_stage::total) + 1 };
+
+    static const char* e_stage_to_string(e_stage stage);
+
+    struct endpoint {
+        endpoint(boost::beast::http::verb action, const char *target);
+
+        void record(e_stage stage, std::chrono::nanoseconds v) {
+            m_stages[static_cast<std::size_t>(stage)].record(v);
+        }
+
+        const boost::beast::http::verb m_action;
+        const std::string m_target;
+        std::array<latency_histogram, stage_count> m_stages;
+    };
+
+    struct endpoint_snapshot_t {
+        boost::beast::http::verb action;
+        std::string target;
+        std::array<latency_histogram::snapshot_t, stage_count> stages;
+
+        const latency_histogram::snapshot_t& stage(e_stage s) const { return stages[static_cast<std::size_t>(s)]; }
+
+        friend std::ostream &operator<<(std::ostream &os, const endpoint_snapshot_t &o);
+    };
+
+    latency_stats();
+    ~latency_stats();
+
+    // the endpoint is created on the first use, and lives as long as this object.
+    // 'target' must have the static storage, e.g. be the literal: it's looked up by the address
+    // without the lock, and by the value only the first time the address is seen
+    endpoint* get(boost::beast::http::verb action, const char *target);
+
+    std::vector<endpoint_snapshot_t> snapshot() const;
+    void reset();
+
+private:
+    // the address of the target, with the endpoint of its value
+    struct alias {
+        const char *target;
+        boost::beast::http::verb action;
+        endpoint *ep;
+    };
+    // the open addressing table, filled up to the half at most, so the probe finds the empty slot
+    enum: std::size_t { index_size = 256 };
+
+    static std::size_t slot_of(boost::beast::http::verb action, const char *target);
+    endpoint* find_or_create(boost::beast::http::verb action, const char *target);
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<endpoint>> m_endpoints;
+    std::vector<std::unique_ptr<alias>> m_aliases;
+    std::array<std::atomic<const alias *>, index_size> m_index;
+};
+
+/*************************************************************************************************/
+
+// measures the consecutive stages of one request
+struct stage_clock {
+    explicit stage_clock(latency_stats::endpoint *stats = nullptr)
+        :m_stats{stats}
+        ,m_start{m_stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}}
+        ,m_mark{m_start}
+    {}
+
+    // the stage is completed now, the next one starts
+    void lap(latency_stats::e_stage stage) {
+        if ( m_stats ) {
+            const auto now = std::chrono::steady_clock::now();
+            m_stats->record(stage, now - m_mark);
+            m_mark = now;
+        }
+    }
+    // the stage which doesn't follow the previous one
+    void record(latency_stats::e_stage stage, std::chrono::nanoseconds v) const {
+        if ( m_stats ) {
+            m_stats->record(stage, v);
+        }
+    }
+    // the time of the failed stages is not counted
+    void restart() {
+        if ( m_stats ) {
+            m_mark = std::chrono::steady_clock::now();
+        }
+    }
+    std::chrono::nanoseconds elapsed() const {
+        return m_stats ? std::chrono::steady_clock::now() - m_start : std::chrono::nanoseconds::zero();
+    }
+
+    latency_stats::endpoint *m_stats;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_mark;
+};
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
+
+#endif // __binapi__latency_stats_hpp
@@ -0,0 +1,98 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__mpsc_queue_hpp
+#define __binapi__mpsc_queue_hpp
+
+#include <atomic>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+struct mpsc_queue_hook {
+    std::atomic<mpsc_queue_hook *> m_next{nullptr};
+};
+
+// the intrusive multi-producer single-consumer queue of D. Vyukov: the push is one atomic exchange
+// and never waits, the pop is wait-free too, but can miss the element whose push is in progress.
+// the elements are derived from 'mpsc_queue_hook' and are not owned by the queue.
+template<typename T>
+struct mpsc_queue {
+    mpsc_queue()
+        :m_head{&m_stub}
+        ,m_tail{&m_stub}
+        ,m_stub{}
+    {}
+
+    mpsc_queue(const mpsc_queue &) = delete;
+    mpsc_queue& operator= (const mpsc_queue &) = delete;
+
+    // from any thread
+    void push(T *v) { push_hook(v); }
+
+    // from the consumer only. it's not empty while the push is in progress
+    bool empty() const {
+        return m_tail == &m_stub && m_head.load(std::memory_order_acquire) == &m_stub;
+    }
+
+    // from the consumer only. returns nullptr if the queue is empty, or if the push of the next
+    // element is not completed yet, so the producer has to notify the consumer after the push.
+    T* pop() {
+        mpsc_queue_hook *tail = m_tail;
+        mpsc_queue_hook *next = tail->m_next.load(std::memory_order_acquire);
+        if ( tail == &m_stub ) {
+            if ( !next ) {
+                return nullptr;
+            }
+            m_tail = next;
+            tail = next;
+            next = next->m_next.load(std::memory_order_acquire);
+        }
+        if ( next ) {
+            m_tail = next;
+
+            return static_cast<T *>(tail);
+        }
+
+        if ( tail != m_head.load(std::memory_order_acquire) ) {
+            return nullptr;
+        }
+
+        // the last element can be popped only when the stub is behind it
+        push_hook(&m_stub);
+        next = tail->m_next.load(std::memory_order_acquire);
+        if ( next ) {
+            m_tail = next;
+
+            return static_cast<T *>(tail);
+        }
+
+        return nullptr;
+    }
+
+private:
+    void push_hook(mpsc_queue_hook *v) {
+        v->m_next.store(nullptr, std::memory_order_relaxed);
+        mpsc_queue_hook *prev = m_head.exchange(v, std::memory_order_acq_rel);
+        prev->m_next.store(v, std::memory_order_release);
+    }
+
+    std::atomic<mpsc_queue_hook *> m_head; // the producers' end
+    mpsc_queue_hook *m_tail;              // the consumer's end
+    mpsc_queue_hook m_stub;
+};
+
+/*************************************************************************************************/
+
+} // ns binapi
+
+#endif // __binapi__mpsc_queue_hpp
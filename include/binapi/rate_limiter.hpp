@@ -0,0 +1,84 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__rate_limiter_hpp
+#define __binapi__rate_limiter_hpp
+
+#include "types.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+// the client side governor of the REQUEST_WEIGHT/ORDERS/RAW_REQUESTS limits.
+// the limits are the fixed windows as they are counted by the server. the usage is accounted
+// locally when a request is sent, and is corrected by the X-MBX-USED-WEIGHT-*/X-MBX-ORDER-COUNT-*
+// headers of the responses, so the requests made by other clients from the same IP are counted too.
+// after the 429/418 response nothing is sent until the Retry-After expires.
+struct rate_limiter {
+    // what to do with the request which would breach a limit
+    enum class e_policy {
+         delay  // wait until the window in which it fits
+        ,reject // fail it with TOO_MANY_REQUESTS/TOO_MANY_ORDERS error
+    };
+
+    struct cost_t {
+        std::size_t weight;
+        std::size_t orders;
+    };
+
+    struct headroom_t {
+        std::string type;               // REQUEST_WEIGHT/ORDERS/RAW_REQUESTS
+        std::chrono::seconds interval;
+        std::size_t limit;
+        std::size_t used;
+        std::size_t remaining;
+    };
+
+    // the defaults are the spot API limits. they are replaced by the limits from exchangeInfo.
+    rate_limiter();
+    ~rate_limiter();
+
+    void set_policy(e_policy policy);
+    e_policy get_policy() const;
+
+    void set_limits(const std::vector<exchange_info_t::rate_limit_t> &limits);
+    std::vector<headroom_t> headroom() const;
+
+    // if the request fits into all the limits, it's accounted and zero is returned.
+    // otherwise nothing is accounted, and the time to wait is returned. 'orders_limit' is set when
+    // the ORDERS limit is the one which is breached.
+    std::chrono::steady_clock::duration acquire(const cost_t &cost, bool *orders_limit = nullptr);
+
+    // to be called for each header of the response
+    void on_header(boost::string_view name, boost::string_view value);
+    // to be called on 429/418 responses
+    void on_ban(std::chrono::seconds retry_after);
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
+
+#endif // __binapi__rate_limiter_hpp
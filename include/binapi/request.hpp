@@ -0,0 +1,119 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__request_hpp
+#define __binapi__request_hpp
+
+#include <ostream> // boost::string_view from the verb.hpp needs it but does not include it
+#include <boost/beast/http/verb.hpp>
+
+#include <initializer_list>
+#include <type_traits>
+#include <string>
+#include <cstdint>
+
+namespace binapi {
+
+struct signer;
+
+namespace rest {
+
+/*************************************************************************************************/
+
+// the typed parameter of the query string.
+// the null strings and the zero numbers are not valid values, and such parameters are skipped.
+struct query_param {
+    enum class kind_type: std::uint8_t { string, number };
+
+    query_param(const char *k, const char *v)
+        :key{k}
+        ,str{v}
+        ,num{}
+        ,kind{kind_type::string}
+    {}
+    template<
+         typename T
+        ,typename = typename std::enable_if<std::is_integral<T>::value>::type
+    >
+    query_param(const char *k, T v)
+        :key{k}
+        ,str{}
+        ,num{static_cast<std::uint64_t>(v)}
+        ,kind{kind_type::number}
+    {}
+
+    bool is_valid() const { return kind == kind_type::string ? str != nullptr : num != 0u; }
+
+    const char *key;
+    const char *str;
+    std::uint64_t num;
+    kind_type kind;
+};
+
+using query_params = std::initializer_list<query_param>;
+
+/*************************************************************************************************/
+
+// serializes the HTTP/1.1 requests directly to the caller's buffers.
+// the header fields common for all the requests are serialized once, in the ctor.
+// when the buffers are reused their capacity is reused too, so in a steady state
+// building of a request does not allocate.
+struct request_builder {
+    request_builder(
+         const std::string &host
+        ,const std::string &pk
+        ,const std::string &user_agent
+        ,const signer &signer
+        ,std::size_t recv_window
+    );
+
+    // appends the decimal representation of 'v'
+    static void append_number(std::string &dst, std::uint64_t v);
+    // appends the valid 'params' as 'key=value&key=value'
+    static void append_query(std::string &dst, query_params params);
+    static void append_query(std::string &dst, const query_param *first, const query_param *last);
+
+    // builds the whole request to 'wire'. 'query' is a scratch buffer.
+    // for the GET/DELETE requests the query is sent in the target, otherwise in the body.
+    // if 'compressed', the gzip/deflate encoded response is accepted.
+    void build(
+         std::string &wire
+        ,std::string &query
+        ,bool _signed
+        ,std::uint64_t timestamp
+        ,const char *target
+        ,boost::beast::http::verb action
+        ,query_params params
+        ,bool compressed
+    ) const;
+    // the same, but the params are already in 'query'. the signature is appended to 'query'.
+    void build_prepared(
+         std::string &wire
+        ,std::string &query
+        ,bool _signed
+        ,std::uint64_t timestamp
+        ,const char *target
+        ,boost::beast::http::verb action
+        ,bool compressed
+    ) const;
+
+private:
+    const signer &m_signer;
+    const std::size_t m_recv_window;
+    std::string m_headers;
+};
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
+
+#endif // __binapi__request_hpp
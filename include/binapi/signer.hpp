@@ -0,0 +1,124 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__signer_hpp
+#define __binapi__signer_hpp
+
+#include <memory>
+#include <string>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+// the signer of the requests, selected per api/wsapi client by the key type:
+// https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md#signed-trade-and-user_data-endpoint-security
+// the keys are loaded once, in the ctors. the signing is thread safe.
+struct signer {
+    virtual ~signer() = default;
+
+    // the max size of the signature
+    virtual std::size_t max_size() const = 0;
+    // writes the signature of 'data' to 'dst', which has at least 'max_size()' chars, and returns
+    // its size. 'dst' is not null-terminated.
+    virtual std::size_t sign(char *dst, const char *data, std::size_t dlen) const = 0;
+
+    // appends the signature of 'data' to 'dst'.
+    void sign(std::string &dst, const char *data, std::size_t dlen) const;
+    // the signature of the whole 'data' is appended to 'data' after the 'sep', url-encoded,
+    // as it's the part of the query string.
+    void sign_append(std::string &data, const char *sep) const;
+};
+
+/*************************************************************************************************/
+
+// HMAC-SHA256 signer, the signature is in hex.
+// the key schedule(the hash states after the ipad/opad blocks) is computed once in the ctor,
+// and for each signature these states are cloned into the preallocated per-thread contexts,
+// so the signing does not allocate and does not touch the key.
+struct hmac_sha256_signer: signer {
+    enum: std::size_t {
+         digest_size = 32
+        ,hex_size = digest_size * 2
+    };
+
+    explicit hmac_sha256_signer(const std::string &key);
+    ~hmac_sha256_signer();
+
+    hmac_sha256_signer(const hmac_sha256_signer &) = delete;
+    hmac_sha256_signer& operator= (const hmac_sha256_signer &) = delete;
+
+    std::size_t max_size() const override { return hex_size; }
+    // writes exactly 'hex_size' lowercase hex chars to 'dst'.
+    std::size_t sign(char *dst, const char *data, std::size_t dlen) const override;
+    using signer::sign;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+// RSA(PKCS#1 v1.5, SHA-256) signer, the signature is in base64.
+// 'pem' is the PEM-encoded private key itself, not the file name.
+struct rsa_sha256_signer: signer {
+    explicit rsa_sha256_signer(const std::string &pem, const std::string &password = {});
+    ~rsa_sha256_signer();
+
+    rsa_sha256_signer(const rsa_sha256_signer &) = delete;
+    rsa_sha256_signer& operator= (const rsa_sha256_signer &) = delete;
+
+    std::size_t max_size() const override;
+    std::size_t sign(char *dst, const char *data, std::size_t dlen) const override;
+    using signer::sign;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+// Ed25519 signer, the signature is in base64.
+// the recommended key type: the signing is much cheaper than RSA, and the signature is short.
+// 'pem' is the PEM-encoded private key itself, not the file name.
+struct ed25519_signer: signer {
+    enum: std::size_t {
+         signature_size = 64
+        ,base64_size = (signature_size + 2) / 3 * 4
+    };
+
+    explicit ed25519_signer(const std::string &pem, const std::string &password = {});
+    ~ed25519_signer();
+
+    ed25519_signer(const ed25519_signer &) = delete;
+    ed25519_signer& operator= (const ed25519_signer &) = delete;
+
+    std::size_t max_size() const override { return base64_size; }
+    std::size_t sign(char *dst, const char *data, std::size_t dlen) const override;
+    using signer::sign;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+// reads the whole file, e.g. the PEM key
+std::string read_key_file(const std::string &fname);
+
+/*************************************************************************************************/
+
+} // ns binapi
+
+#endif // __binapi__signer_hpp
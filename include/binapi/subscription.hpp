@@ -0,0 +1,180 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__subscription_hpp
+#define __binapi__subscription_hpp
+
+#include "websocket.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/post.hpp>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace binapi {
+namespace ws {
+
+/*************************************************************************************************/
+
+// the websocket stream whose messages are queued, to be pulled by next() instead of being pushed
+// to the callback. next() takes the asio completion token, the completion signature is
+// 'void(subscription<T>::result)', so in a coroutine:
+//     ws::subscription<ws::book_ticker_t> book{ioctx, ws, [](ws::websockets &ws, auto cb){ return ws.book("BTCUSDT", std::move(cb)); }};
+//     for ( ;; ) {
+//         auto msg = co_await book.next(boost::asio::use_awaitable);
+//         if ( !msg ) { break; }
+//         ...
+//     }
+// when the queue is full the oldest message is dropped. after an error the stream is closed,
+// and next() completes with that error.
+// must be used from the io_context thread, and must outlive the pending next().
+template<typename T>
+struct subscription {
+    struct result {
+        int ec;
+        std::string errmsg;
+        T v;
+
+        // returns FALSE when error
+        explicit operator bool() const { return errmsg.empty(); }
+    };
+
+    template<typename F>
+    subscription(boost::asio::io_context &ioctx, websockets &ws, F &&subscribe, std::size_t max_queued = 1024)
+        :m_ws{ws}
+        ,m_handle{}
+        ,m_self{std::make_shared<subscription *>(this)}
+        ,m_timer{ioctx}
+        ,m_queue{}
+        ,m_max_queued{max_queued}
+        ,m_dropped{}
+        ,m_closed{}
+    {
+        // the condition variable for the pending next()
+        m_timer.expires_at(boost::asio::steady_timer::time_point::max());
+
+        // the message which was already read can arrive after close()
+        auto cb = [self=m_self](const char *fl, int ec, std::string errmsg, T msg) {
+            if ( !*self ) {
+                return false;
+            }
+
+            (*self)->on_message(fl, ec, std::move(errmsg), std::move(msg));
+            return !ec;
+        };
+        m_handle = subscribe(m_ws, std::move(cb));
+    }
+    ~subscription() {
+        close();
+    }
+
+    subscription(const subscription &) = delete;
+    subscription& operator= (const subscription &) = delete;
+
+    websockets::handle handle() const { return m_handle; }
+    std::size_t queued() const { return m_queue.size(); }
+    // how many messages were dropped because of the full queue
+    std::size_t dropped() const { return m_dropped; }
+
+    template<typename Token>
+    auto next(Token &&token) {
+        return boost::asio::async_initiate<Token, void(result)>(
+             [this](auto handler) {
+                if ( !m_queue.empty() || m_closed ) {
+                    auto ex = boost::asio::get_associated_executor(handler, m_timer.get_executor());
+                    boost::asio::post(
+                         ex
+                        ,[handler=std::move(handler), res=pop()]() mutable
+                         { handler(std::move(res)); }
+                    );
+
+                    return;
+                }
+
+                // completed with 'operation_aborted' when the message arrives or the stream is closed
+                m_timer.async_wait(
+                    [this, handler=std::move(handler)](const boost::system::error_code &) mutable
+                    { handler(pop()); }
+                );
+             }
+            ,token
+        );
+    }
+
+    // unsubscribes, the pending next() completes with an error
+    void close() {
+        if ( m_closed ) {
+            return;
+        }
+
+        m_closed = true;
+        *m_self = nullptr;
+        m_ws.async_unsubscribe(m_handle);
+        m_timer.cancel();
+    }
+
+private:
+    void on_message(const char *fl, int ec, std::string errmsg, T msg) {
+        if ( m_queue.size() == m_max_queued ) {
+            m_queue.pop_front();
+            ++m_dropped;
+        }
+
+        result res{ec, std::string{}, std::move(msg)};
+        if ( ec || !errmsg.empty() ) {
+            if ( fl ) {
+                res.errmsg = fl;
+                res.errmsg += ": ";
+            }
+            res.errmsg += errmsg;
+        }
+        m_queue.push_back(std::move(res));
+
+        // the stream is stopped on error
+        if ( ec ) {
+            m_closed = true;
+        }
+        m_timer.cancel_one();
+    }
+
+    result pop() {
+        if ( m_queue.empty() ) {
+            return result{-1, "subscription closed", T{}};
+        }
+
+        result res = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        return res;
+    }
+
+    websockets &m_ws;
+    websockets::handle m_handle;
+    std::shared_ptr<subscription *> m_self;
+    boost::asio::steady_timer m_timer;
+    std::deque<result> m_queue;
+    const std::size_t m_max_queued;
+    std::size_t m_dropped;
+    bool m_closed;
+};
+
+/*************************************************************************************************/
+
+} // ns ws
+} // ns binapi
+
+#endif // __binapi__subscription_hpp
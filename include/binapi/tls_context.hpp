@@ -0,0 +1,61 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__tls_context_hpp
+#define __binapi__tls_context_hpp
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+#include <memory>
+#include <string>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+// the client ssl::context and the cache of TLS sessions keyed by host.
+// one instance per io_context is shared by all the rest::api and ws::websockets working on it:
+//     auto &tls = boost::asio::use_service<binapi::tls_context>(ioctx);
+//     auto stat = tls.get_stat();
+// the sessions(tickets) received from a host are used to resume the handshake of the next
+// connection to that host, which saves a round trip and the asymmetric crypto.
+struct tls_context: boost::asio::io_context::service {
+    static boost::asio::io_context::id id;
+
+    explicit tls_context(boost::asio::io_context &ioctx);
+    ~tls_context();
+
+    boost::asio::ssl::context& context();
+
+    // sets SNI and the cached session for the host. must be called before the handshake.
+    boost::system::error_code prepare(SSL *ssl, const std::string &host);
+    // must be called after the successful handshake.
+    void handshake_completed(SSL *ssl);
+
+    struct stat_t {
+        std::size_t full_handshakes;
+        std::size_t resumed_handshakes;
+    };
+    stat_t get_stat() const;
+
+private:
+    void shutdown() override;
+
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+} // ns binapi
+
+#endif // __binapi__tls_context_hpp
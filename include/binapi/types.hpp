@@ -162,6 +162,7 @@ struct exchange_info_t {
     struct rate_limit_t {
         std::string rateLimitType;
         std::string interval;
+        std::size_t intervalNum;
         std::size_t limit;
 
         friend std::ostream &operator<<(std::ostream &os, const rate_limit_t &f);
@@ -627,6 +628,17 @@ struct cancel_order_info_t {
     friend std::ostream &operator<<(std::ostream &os, const cancel_order_info_t &o);
 };
 
+// https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md#cancel-an-existing-order-and-send-a-new-order-trade
+struct cancel_replace_order_info_t {
+    std::string cancelResult;   // SUCCESS, FAILURE or NOT_ATTEMPTED
+    std::string newOrderResult; // SUCCESS, FAILURE or NOT_ATTEMPTED
+    cancel_order_info_t cancelResponse;   // valid if cancelResult is SUCCESS
+    new_order_resp_type newOrderResponse; // valid if newOrderResult is SUCCESS
+
+    static cancel_replace_order_info_t construct(const flatjson::fjson &json);
+    friend std::ostream &operator<<(std::ostream &os, const cancel_replace_order_info_t &o);
+};
+
 // https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md#cancel-all-open-orders-on-a-symbol-trade
 struct cancel_all_open_orders_info_t {
 
@@ -16,6 +16,9 @@
 
 #include <memory>
 #include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
 
 namespace boost {
 namespace asio {
@@ -54,10 +57,36 @@ struct websockets final {
     websockets& operator= (websockets &&) noexcept = default;
 
     using on_message_received_cb = std::function<void(const char *channel, const char *ptr, std::size_t size)>;
+    // of all the connections: received over the last interval, and the average per second since the start
     using on_network_stat_cb = std::function<
         void(std::size_t msg_recvd, std::size_t msg_recvd_avg, std::size_t bytes_recvd, std::size_t bytes_recvd_avg)
     >;
 
+    struct network_stat_t {
+        struct counters_t {
+            std::string target; // of the connection, empty for the total
+            std::size_t streams;
+            std::uint64_t messages; // since the start
+            std::uint64_t bytes;
+            // per second
+            double msg_rate; // over the last interval
+            double msg_rate_avg; // since the start
+            double msg_rate_peak; // the max of the intervals
+            double bytes_rate;
+            double bytes_rate_avg;
+            double bytes_rate_peak;
+            // the average per message, in microseconds
+            double parse_us;
+            double callback_us;
+            std::size_t reconnects;
+            std::size_t queue_depth; // the outgoing frames which are not written yet
+        };
+
+        counters_t total;
+        std::vector<counters_t> connections;
+    };
+    using on_network_stat_ex_cb = std::function<void(const network_stat_t &stat)>;
+
     websockets(
          boost::asio::io_context &ioctx
         ,std::string host
@@ -68,8 +97,49 @@ struct websockets final {
     );
     ~websockets();
 
+    // the streams are multiplexed over the connections to '/stream?streams=a/b/c', up to 'max_streams'
+    // per connection(the exchange allows 1024), and the messages are routed to the callbacks by the
+    // stream name. the streams subscribed until the io_context handles the next event share the
+    // connection. the streams subscribed and unsubscribed later are added to and removed from the open
+    // connections by the SUBSCRIBE/UNSUBSCRIBE requests, batched and sent at most 4 per second, so the
+    // other streams of the connection are not interrupted. the connection is closed when it has no
+    // streams left after the batch. the stream rejected by the exchange gets the error to its callback.
+    // 0 - each stream has its own connection, the default.
+    // NOTE: is applied to the streams subscribed after the call.
+    void set_combined_streams(std::size_t max_streams);
+
+    // in addition to the 'stat_cb' of the ctor, is called every 'stat_interval' seconds as well
+    void set_network_stat_cb(on_network_stat_ex_cb cb);
+
     using handle = void *;
 
+    // the interval when the streams of the connection were not received, because it was lost
+    struct gap_t {
+        std::uint64_t from; // ms since epoch, when the connection was lost
+        std::uint64_t to;   // ms since epoch, when the first message is received after the reconnection
+        int ec; // the error the connection was lost by
+        std::string errmsg;
+    };
+    // called for each stream of the reconnected connection, before any of its messages
+    using on_gap_cb = std::function<void(handle h, const char *stream, const gap_t &gap)>;
+
+    // the supervisor of the connections: the lost one is reconnected after the delay, which is doubled
+    // from 'min_delay_ms' up to 'max_delay_ms' with each failed attempt, and is jittered by its half.
+    // the streams are resubscribed over the new connection, using the cached DNS and TLS sessions, and
+    // the stream callbacks are not called with the error. the connection is also replaced after
+    // 'max_lifetime_s', before the exchange drops it at 24h: the new one is opened while the old one
+    // is still read, and the old one is closed when the new one receives its first message, so there
+    // is no gap, but a few messages around the switch can be received twice. the failed replacement
+    // is retried after 'max_delay_ms'. the streams are subscribed over the combined connections, one
+    // stream per connection if set_combined_streams() is not called.
+    // NOTE: is applied to the streams subscribed after the call.
+    void set_reconnect(
+         on_gap_cb gap_cb
+        ,std::size_t min_delay_ms = 100
+        ,std::size_t max_delay_ms = 30000
+        ,std::size_t max_lifetime_s = 23*60*60
+    );
+
     // https://github.com/binance/binance-spot-api-docs/blob/master/web-socket-streams.md#partial-book-depth-streams
     using on_part_depths_received_cb = std::function<bool(const char *fl, int ec, std::string errmsg, part_depths_t msg)>;
     handle part_depth(const char *pair, e_levels level, e_freq freq, on_part_depths_received_cb cb);
@@ -0,0 +1,300 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__websocket_stream_hpp
+#define __binapi__websocket_stream_hpp
+
+#include "dns_cache.hpp"
+#include "tls_context.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/stream.hpp>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+
+#include <boost/preprocessor/stringize.hpp>
+#include <boost/intrusive/set.hpp>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#define __BINAPI_CB_ON_ERROR(cb, ec) \
+    cb(__FILE__ "(" BOOST_PP_STRINGIZE(__LINE__) ")", ec.value(), ec.message(), nullptr, 0);
+
+namespace binapi
+{
+    namespace ws
+    {
+
+        struct websockets;
+
+        /*************************************************************************************************/
+
+        struct websocket : std::enable_shared_from_this<websocket>
+        {
+            friend struct websockets;
+
+            explicit websocket(boost::asio::io_context &ioctx)
+                : m_ioctx{ioctx}, m_tls{boost::asio::use_service<tls_context>(m_ioctx)}, m_dns{boost::asio::use_service<dns_cache>(m_ioctx)}, m_ws{m_ioctx, m_tls.context()}, m_buf{}, m_host{}, m_target{}, m_stop_requested{}, m_connected{}, m_writing{}, m_write_queue{}
+            {
+            }
+            virtual ~websocket()
+            {
+            }
+
+            using holder_type = std::shared_ptr<websocket>;
+
+            template <typename CB>
+            void async_start(
+                const std::string &host, const std::string &port, const std::string &target, CB cb, holder_type holder)
+            {
+                m_host = host;
+                m_target = target;
+
+                m_dns.async_resolve(
+                    m_host, port, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type res) mutable
+                    {
+                if ( ec ) {
+                    if ( !m_stop_requested ) { __BINAPI_CB_ON_ERROR(cb, ec); }
+                } else if ( !m_stop_requested ) {
+                    async_connect(std::move(res), std::move(cb), std::move(holder));
+                } });
+            }
+
+            void stop()
+            {
+                // the close is in progress already
+                if (m_stop_requested)
+                {
+                    return;
+                }
+
+                m_stop_requested = true;
+
+                if (!m_connected)
+                {
+                    abort_connect();
+                }
+                else if (m_ws.next_layer().next_layer().is_open())
+                {
+                    boost::system::error_code ec;
+                    m_ws.close(boost::beast::websocket::close_code::normal, ec);
+                }
+            }
+
+            void async_stop()
+            {
+                if (m_stop_requested)
+                {
+                    return;
+                }
+
+                m_stop_requested = true;
+                holder_type holder = shared_from_this();
+
+                if (!m_connected)
+                {
+                    abort_connect();
+                }
+                else if (m_ws.next_layer().next_layer().is_open())
+                {
+                    m_ws.async_close(
+                        boost::beast::websocket::close_code::normal, [holder = std::move(holder)](const boost::system::error_code &) {});
+                }
+            }
+
+            // the connect or the handshakes in progress are completed with the error, there is no
+            // session to close yet
+            void abort_connect()
+            {
+                boost::system::error_code ec;
+                m_ws.next_layer().next_layer().close(ec);
+            }
+
+            template <typename CB>
+            void async_connect(boost::asio::ip::tcp::resolver::results_type res, CB cb, holder_type holder)
+            {
+                auto error_code = m_tls.prepare(m_ws.next_layer().native_handle(), m_host);
+                if (error_code)
+                {
+                    __BINAPI_CB_ON_ERROR(cb, error_code);
+
+                    return;
+                }
+
+                boost::asio::async_connect(
+                    m_ws.next_layer().next_layer(),
+                    res.begin(),
+                    res.end(),
+                    [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec, boost::asio::ip::basic_resolver_iterator<boost::asio::ip::tcp>) mutable
+                    {
+                        if (ec)
+                        {
+                            if (!m_stop_requested)
+                            {
+                                __BINAPI_CB_ON_ERROR(cb, ec);
+                            }
+                        }
+                        else
+                        {
+                            on_connected(std::move(cb), std::move(holder));
+                        }
+                    });
+            }
+
+            template <typename CB>
+            void on_connected(CB cb, holder_type holder)
+            {
+                m_ws.control_callback(
+                    [this](boost::beast::websocket::frame_type kind, boost::beast::string_view payload) mutable
+                    {
+                        (void)kind;
+                        (void)payload;
+                        // std::cout << "control_callback(" << this << "): kind=" << static_cast<int>(kind) << ", payload=" << payload.data() << std::endl;
+                        m_ws.async_pong(
+                            boost::beast::websocket::ping_data{}, [](boost::beast::error_code ec)
+                            { (void)ec; /*std::cout << "control_callback_cb(" << this << "): ec=" << ec << std::endl;*/ });
+                    });
+
+                m_ws.next_layer().async_handshake(
+                    boost::asio::ssl::stream_base::client, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec) mutable
+                    {
+                if ( ec ) {
+                    if ( !m_stop_requested ) { __BINAPI_CB_ON_ERROR(cb, ec); }
+                } else {
+                    m_tls.handshake_completed(m_ws.next_layer().native_handle());
+                    on_async_ssl_handshake(std::move(cb), std::move(holder));
+                } });
+            }
+            template <typename CB>
+            void on_async_ssl_handshake(CB cb, holder_type holder)
+            {
+                m_ws.async_handshake(
+                    m_host, m_target, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec) mutable
+                    {
+                        if (!ec)
+                        {
+                            m_connected = true;
+                            start_write();
+                        }
+                        start_read(ec, std::move(cb), std::move(holder));
+                    });
+            }
+
+            // the text frames are sent one by one in the order of the calls.
+            // the ones written before the handshake is completed are sent right after it.
+            void async_write(std::string msg)
+            {
+                m_write_queue.push_back(std::move(msg));
+                start_write();
+            }
+            void start_write()
+            {
+                if (!m_connected || m_writing || m_stop_requested || m_write_queue.empty())
+                {
+                    return;
+                }
+
+                m_writing = true;
+                m_ws.text(true);
+                m_ws.async_write(
+                    boost::asio::buffer(m_write_queue.front()), [this, holder = shared_from_this()](boost::system::error_code ec, std::size_t) mutable
+                    { on_write(ec); });
+            }
+            void on_write(boost::system::error_code ec)
+            {
+                m_writing = false;
+                if (ec)
+                {
+                    // the pending read is completed with the error too, and it's reported from there
+                    m_write_queue.clear();
+
+                    return;
+                }
+
+                m_write_queue.pop_front();
+                start_write();
+            }
+            template <typename CB>
+            void start_read(boost::system::error_code ec, CB cb, holder_type holder)
+            {
+                if (ec)
+                {
+                    if (!m_stop_requested)
+                    {
+                        __BINAPI_CB_ON_ERROR(cb, ec);
+                    }
+
+                    stop();
+
+                    return;
+                }
+
+                m_ws.async_read(
+                    m_buf, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec, std::size_t rd) mutable
+                    { on_read(ec, rd, std::move(cb), std::move(holder)); });
+            }
+            template <typename CB>
+            void on_read(boost::system::error_code ec, std::size_t rd, CB cb, holder_type holder)
+            {
+                if (ec)
+                {
+                    if (!m_stop_requested)
+                    {
+                        __BINAPI_CB_ON_ERROR(cb, ec);
+                    }
+
+                    stop();
+
+                    return;
+                }
+
+                auto size = m_buf.size();
+                assert(size == rd);
+
+                // the message is passed right from the storage of the buffer, which is reused by the
+                // next read. so the pointer is valid until the callback returns
+                const auto *ptr = static_cast<const char *>(m_buf.data().data());
+                bool ok = cb(nullptr, 0, std::string{}, ptr, size);
+                m_buf.consume(size);
+                if (!ok)
+                {
+                    stop();
+                }
+                else
+                {
+                    start_read(boost::system::error_code{}, std::move(cb), std::move(holder));
+                }
+            }
+
+            boost::asio::io_context &m_ioctx;
+            tls_context &m_tls;
+            dns_cache &m_dns;
+            boost::beast::websocket::stream<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> m_ws;
+            boost::beast::flat_buffer m_buf; // grows up to the largest message, and is reused
+            std::string m_host;
+            std::string m_target;
+            bool m_stop_requested;
+            bool m_connected;
+            bool m_writing;
+            std::deque<std::string> m_write_queue;
+            boost::intrusive::set_member_hook<> m_intrusive_set_hook;
+        };
+
+    } // ns ws
+} // ns binapi
+
+#endif // __binapi__websocket_stream_hpp
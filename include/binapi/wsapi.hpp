@@ -0,0 +1,142 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__wsapi_hpp
+#define __binapi__wsapi_hpp
+
+#include "types.hpp"
+#include "enums.hpp"
+#include "signer.hpp"
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <cstdint>
+
+namespace boost {
+namespace asio {
+
+class io_context;
+
+} // ns asio
+} // ns boost
+
+namespace binapi {
+
+struct clock_sync;
+
+namespace wsapi {
+
+/*************************************************************************************************/
+
+// https://github.com/binance/binance-spot-api-docs/blob/master/web-socket-api.md
+// the orders are placed and cancelled over one persistent websocket session, so there is no
+// HTTP request/response for each of them. the requests are sent as JSON-RPC frames identified
+// by the 'id', and each response is passed to the callback of its request.
+// the session is connected by the ctor. if it's lost, the requests waiting for the response are
+// completed with the error, and the next request connects the new session.
+// the frames written before the session is connected are sent right after the handshake.
+// must be used from the io_context thread.
+struct client {
+    using request_id = std::uint64_t;
+
+    client(
+         boost::asio::io_context &ioctx
+        ,std::string host
+        ,std::string port
+        ,std::string pk
+        ,std::string sk
+        ,std::size_t recv_window
+        ,std::string target = "/ws-api/v3"
+    );
+    // the requests are signed by the 'signer', for the RSA and Ed25519 API keys
+    // NOTE: throws std::invalid_argument if the 'signer' is null.
+    client(
+         boost::asio::io_context &ioctx
+        ,std::string host
+        ,std::string port
+        ,std::string pk
+        ,std::shared_ptr<const signer> signer
+        ,std::size_t recv_window
+        ,std::string target = "/ws-api/v3"
+    );
+    ~client();
+
+    client(const client &) = delete;
+    client(client &&) = default;
+
+    // the timestamps of the requests are taken from the estimate of the server clock, e.g. the one
+    // of the rest::api, instead of the local one. it must outlive the client, null resets it.
+    void set_clock_sync(const clock_sync *clock);
+
+    // how many requests are waiting for the response
+    std::size_t pending() const;
+
+    // https://github.com/binance/binance-spot-api-docs/blob/master/web-socket-api.md#place-new-order-trade
+    using new_order_cb = std::function<bool(const char *fl, int ec, std::string errmsg, rest::new_order_resp_type res)>;
+    request_id new_order(
+         const char *symbol
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,new_order_cb cb
+    );
+
+    // https://github.com/binance/binance-spot-api-docs/blob/master/web-socket-api.md#cancel-order-trade
+    using cancel_order_cb = std::function<bool(const char *fl, int ec, std::string errmsg, rest::cancel_order_info_t res)>;
+    request_id cancel_order(
+         const char *symbol
+        ,std::size_t order_id
+        ,const char *client_order_id
+        ,const char *new_client_order_id
+        ,cancel_order_cb cb
+    );
+
+    // https://github.com/binance/binance-spot-api-docs/blob/master/web-socket-api.md#cancel-and-replace-order-trade
+    // the order is cancelled and the new one is placed by one request.
+    // the order to cancel is identified by 'cancel_order_id' or 'cancel_client_order_id'.
+    // when one of them failed the 'ec' is not zero, but the 'res' is still valid: its 'cancelResult'
+    // and 'newOrderResult' tell which one.
+    using cancel_replace_order_cb = std::function<bool(const char *fl, int ec, std::string errmsg, rest::cancel_replace_order_info_t res)>;
+    request_id cancel_replace_order(
+         const char *symbol
+        ,const e_cancel_replace_mode mode
+        ,std::size_t cancel_order_id
+        ,const char *cancel_client_order_id
+        ,const e_side side
+        ,const e_type type
+        ,const e_time time
+        ,const e_trade_resp_type resp
+        ,const char *amount
+        ,const char *price
+        ,const char *client_order_id
+        ,const char *stop_price
+        ,const char *iceberg_amount
+        ,cancel_replace_order_cb cb
+    );
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl;
+};
+
+/*************************************************************************************************/
+
+} // ns wsapi
+} // ns binapi
+
+#endif // __binapi__wsapi_hpp
@@ -12,10 +12,15 @@
 #include <binapi/api.hpp>
 #include <binapi/invoker.hpp>
 #include <binapi/errors.hpp>
+#include <binapi/dns_cache.hpp>
+#include <binapi/tls_context.hpp>
+#include <binapi/signer.hpp>
+#include <binapi/request.hpp>
+#include <binapi/inflater.hpp>
+#include <binapi/mpsc_queue.hpp>
 
 #include <boost/preprocessor.hpp>
 #include <boost/callable_traits.hpp>
-#include <boost/variant.hpp>
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -24,14 +29,26 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl/error.hpp>
 #include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/intrusive/set.hpp>
 
 #include <chrono>
-#include <queue>
+#include <array>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <algorithm>
 #include <type_traits>
 #include <iostream>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
 
-#include <openssl/hmac.h>
-#include <openssl/sha.h>
 #include <binapi/flatjson.hpp>
 
 namespace binapi {
@@ -90,118 +107,102 @@ namespace rest {
 
 /*************************************************************************************************/
 
-std::uint64_t get_current_ms_epoch() {
-    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count());
-}
-
-std::string b2a_hex(const std::uint8_t *p, std::size_t n) {
-    static const char hex[] = "0123456789abcdef";
-    std::string res;
-    res.reserve(n * 2);
-
-    for ( auto end = p + n; p != end; ++p ) {
-        const std::uint8_t v = (*p);
-        res += hex[(v >> 4) & 0x0F];
-        res += hex[v & 0x0F];
+const query_param* find_param(query_params params, const char *key) {
+    for ( const auto &it: params ) {
+        if ( std::strcmp(it.key, key) == 0 && it.is_valid() ) {
+            return &it;
+        }
     }
 
-    return res;
+    return nullptr;
 }
 
-std::string hmac_sha256(const char *key, std::size_t klen, const char *data, std::size_t dlen) {
-    std::uint8_t digest[EVP_MAX_MD_SIZE];
-    std::uint32_t dilen{};
-
-    auto p = ::HMAC(
-         ::EVP_sha256()
-        ,key
-        ,klen
-        ,(std::uint8_t *)data
-        ,dlen
-        ,digest
-        ,&dilen
-    );
-    assert(p);
-
-    return b2a_hex(digest, dilen);
-}
+// https://github.com/binance/binance-spot-api-docs/blob/master/rest-api.md
+// the weights are of the current docs, they are changed by the exchange from time to time
+rate_limiter::cost_t get_request_cost(const char *target, boost::beast::http::verb action, query_params params) {
+    using boost::beast::http::verb;
 
-// unused for now
-bool verify_signature(const unsigned char* sig, std::size_t slen, const char* data, std::size_t dlen)
-{
-    bool result = true;
-    auto pubkeyfile = BIO_new_file ( "testnet.pub.pem", "r" );
-    auto vkey = PEM_read_bio_PUBKEY( pubkeyfile, nullptr, nullptr, nullptr);
-
-    auto ctx = EVP_MD_CTX_new();
-    auto md = ::EVP_sha256();
-    assert(pubkeyfile && vkey && ctx && md);
-
-    if ( 1 != ( EVP_DigestInit_ex ( ctx, md, nullptr ) &&
-                EVP_DigestVerifyInit ( ctx, nullptr, md, nullptr, vkey ) &&
-                EVP_DigestVerifyUpdate ( ctx, data, dlen ) &&
-                EVP_DigestVerifyFinal ( ctx, sig, slen ) ) )
+    const bool with_symbol = find_param(params, "symbol") != nullptr;
+    if ( std::strcmp(target, "/api/v3/exchangeInfo") == 0 ) {
+        return {20, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/depth") == 0 ) {
+        const auto *param = find_param(params, "limit");
+        const std::uint64_t limit = param ? param->num : 100u;
+        return {limit <= 100 ? 5u : limit <= 500 ? 25u : limit <= 1000 ? 50u : 250u, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/ticker/24hr") == 0 ) {
+        return {with_symbol ? 2u : 80u, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/ticker/price") == 0 ) {
+        return {with_symbol ? 2u : 4u, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/order") == 0 ) {
+        if ( action == verb::post ) {
+            return {1, 1};
+        }
+        return {action == verb::get ? 4u : 1u, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/order/cancelReplace") == 0 ) {
+        return {1, 1};
+    }
+    if ( std::strcmp(target, "/api/v3/openOrders") == 0 ) {
+        return {action == verb::get ? (with_symbol ? 6u : 80u) : 1u, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/allOrders") == 0
+        || std::strcmp(target, "/api/v3/account") == 0
+        || std::strcmp(target, "/api/v3/myTrades") == 0 )
     {
-        std::cerr << "EVP_DigestVerify* failed!" << std::endl;
-        result = false;
+        return {20, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/trades") == 0 ) {
+        return {25, 0};
+    }
+    if ( std::strcmp(target, "/api/v3/aggTrades") == 0
+        || std::strcmp(target, "/api/v3/klines") == 0
+        || std::strcmp(target, "/api/v3/avgPrice") == 0
+        || std::strcmp(target, "/api/v3/userDataStream") == 0 )
+    {
+        return {2, 0};
     }
 
-    if (pubkeyfile)
-        BIO_free( pubkeyfile );
-    if (ctx)
-        EVP_MD_CTX_free( ctx );
-    if (vkey)
-        EVP_PKEY_free( vkey );
-
-    return result;
+    return {1, 0};
 }
 
-// unused for now
-std::string rsa_sha256(const char* privkeyfile, std::size_t /*pklen*/, const char *data, std::size_t dlen )
-{
-    static EVP_PKEY *pkey = nullptr;
-    if ( !pkey ) {
-         auto keybp = BIO_new_file ( privkeyfile, "r" );
-         pkey = EVP_PKEY_new();
-         pkey = PEM_read_bio_PrivateKey(keybp, nullptr, nullptr, nullptr);
-
-         if ( keybp )
-             BIO_free(keybp);
-    }
-    assert(pkey);
-
-    auto mdctx = EVP_MD_CTX_new();
-    std::size_t req = 0, slen = 0;
-    if ( 1 != (EVP_DigestSignInit( mdctx, nullptr, ::EVP_sha256(), nullptr, pkey ) &&
-               EVP_DigestSignUpdate( mdctx, data, dlen ) &&
-               EVP_DigestSignFinal( mdctx, nullptr, &req )) )
+api::e_priority get_request_priority(const char *target, boost::beast::http::verb action, bool _signed) {
+    using boost::beast::http::verb;
+
+    if ( std::strcmp(target, "/api/v3/order") == 0
+        || std::strcmp(target, "/api/v3/order/test") == 0
+        || std::strcmp(target, "/api/v3/order/cancelReplace") == 0 )
     {
-        std::cerr << "EVP_DigestSign* failed!" << std::endl;
-        exit(1);
+        return action == verb::get ? api::e_priority::account : api::e_priority::order_entry;
     }
-
-    unsigned char* signature;
-    slen = req;
-    signature =  static_cast<unsigned char*> ( OPENSSL_malloc ( req ) );
-    if ( 1 != EVP_DigestSignFinal ( mdctx, signature, &slen ) ) {
-        std::cerr << "Digest Final (2) failed" << std::endl;
+    if ( std::strcmp(target, "/api/v3/openOrders") == 0 && action == verb::delete_ ) {
+        return api::e_priority::order_entry;
     }
-    assert(slen == req);
+    if ( _signed || std::strcmp(target, "/api/v3/userDataStream") == 0 ) {
+        return api::e_priority::account;
+    }
+
+    return api::e_priority::market_data;
+}
 
-    // Uncomment to verify if priv/pub keypairs are working together
-    // assert( verify_signature(signature, slen, data, dlen ) );
+// sent twice, they have the effect of one. the POSTs are not: the second 'POST /api/v3/order'
+// places the second order
+bool is_idempotent(boost::beast::http::verb action) {
+    using boost::beast::http::verb;
 
-    unsigned char encodedSig[512];
-    int elen = EVP_EncodeBlock ( encodedSig, signature, slen );
+    return action == verb::get || action == verb::delete_;
+}
 
-    if ( mdctx )
-        EVP_MD_CTX_free(mdctx);
-    if ( signature )
-        OPENSSL_free(signature);
+// the requests are signed by it when they are sent, so it's checked by the constructor
+std::shared_ptr<const signer> not_null_signer(std::shared_ptr<const signer> signer) {
+    if ( !signer ) {
+        throw std::invalid_argument("the signer is null");
+    }
 
-    return std::string(reinterpret_cast<char*>(encodedSig), elen);
+    return signer;
 }
 
 /*************************************************************************************************/
@@ -212,26 +213,66 @@ struct api::impl {
         ,std::string host
         ,std::string port
         ,std::string pk
-        ,std::string sk
+        ,std::shared_ptr<const signer> signer
         ,std::size_t timeout
         ,std::string client_api_string
     )
-        :m_ioctx{ioctx}
+        :m_id{next_id()}
+        ,m_ioctx{ioctx}
+        ,m_strand{boost::asio::make_strand(m_ioctx)}
+        ,m_executor{m_ioctx.get_executor()}
+        ,m_thread_safe{}
+        ,m_submissions{}
+        ,m_drain_scheduled{}
         ,m_host{std::move(host)}
         ,m_port{std::move(port)}
         ,m_pk{std::move(pk)}
-        ,m_sk{std::move(sk)}
+        ,m_signer{not_null_signer(std::move(signer))}
         ,m_timeout{timeout}
         ,m_client_api_string{std::move(client_api_string)}
-        ,m_write_in_process{}
+        ,m_builder{m_host, m_pk, m_client_api_string, *m_signer, m_timeout}
+        ,m_max_inflight{8}
+        ,m_inflight{}
+        ,m_max_inflight_bulk{4}
+        ,m_inflight_bulk{}
         ,m_async_requests{}
-        ,m_ssl_ctx{boost::asio::ssl::context::sslv23_client}
-        ,m_resolver{m_ioctx}
+        ,m_req_pool{std::make_shared<async_req_pool>()}
+        ,m_tls{boost::asio::use_service<tls_context>(m_ioctx)}
+        ,m_dns{boost::asio::use_service<dns_cache>(m_ioctx)}
+        ,m_mutex{}
+        ,m_max_idle_connections{4}
+        ,m_idle_timeout{std::chrono::seconds{30}}
+        ,m_idle_connections{}
+        ,m_limiter{}
+        ,m_limit_timer{m_executor}
+        ,m_limit_waiting{}
+        ,m_default_deadline{std::chrono::seconds{10}}
+        ,m_next{}
+        ,m_last_handle{}
+        ,m_active_requests{}
+        ,m_dedicated_io_thread{}
+        ,m_clock{}
+        ,m_clock_timer{m_executor}
+        ,m_clock_interval{}
+        ,m_clock_generation{}
+        ,m_latency{}
+        ,m_latency_enabled{true}
+        ,m_json{}
+        ,m_compressed{
+             "/api/v3/exchangeInfo"
+            ,"/api/v3/ticker/24hr"
+            ,"/api/v3/ticker/price"
+            ,"/api/v3/depth"
+        }
     {}
+    ~impl() {
+        // submitted, but not queued yet
+        while ( async_req_item *item = m_submissions.pop() ) {
+            delete item;
+        }
+    }
 
-    using val_type = boost::variant<std::size_t, const char *>;
-    using kv_type = std::pair<const char *, val_type>;
-    using init_list_type = std::initializer_list<kv_type>;
+    using init_list_type = query_params;
 
     template<
          typename CB
@@ -239,37 +280,9 @@ struct api::impl {
         ,typename R = typename std::tuple_element<3, Args>::type
     >
     api::result<R>
-    post(bool _signed, const char *target, boost::beast::http::verb action, const std::initializer_list<kv_type> &map, CB cb) {
+    post(bool _signed, const char *target, boost::beast::http::verb action, query_params params, CB cb) {
         static_assert(std::tuple_size<Args>::value == 4, "callback signature is wrong!");
 
-        auto is_valid_value = [](const val_type &v) -> bool {
-            if ( const auto *p = boost::get<const char *>(&v) ) {
-                return *p != nullptr;
-            }
-            if ( const auto *p = boost::get<std::size_t>(&v) ) {
-                return *p != 0u;
-            }
-
-            assert(!"unreachable");
-
-            return false;
-        };
-
-        auto to_string = [](char *buf, std::size_t bufsize, const val_type &v) -> const char* {
-            if ( const auto *p = boost::get<const char *>(&v) ) {
-                return *p;
-            }
-            if ( const auto *p = boost::get<std::size_t>(&v) ) {
-                std::snprintf(buf, bufsize, "%zu", *p);
-
-                return buf;
-            }
-
-            assert(!"unreachable");
-
-            return buf;
-        };
-
         auto is_html = [](const char *str) -> bool {
             return std::strstr(str, "<HTML>")
                 || std::strstr(str, "<HEAD>")
@@ -277,62 +290,42 @@ struct api::impl {
             ;
         };
 
-        std::string starget = target;
-        std::string data;
-        for ( const auto &it: map ) {
-            if ( is_valid_value(it.second) ) {
-                if ( !data.empty() ) {
-                    data += "&";
-                }
-                data += it.first;
-                data += "=";
-
-                char buf[32];
-                data += to_string(buf, sizeof(buf), it.second);
-            }
-        }
-
-        if ( _signed ) {
-            assert(!m_pk.empty() && !m_sk.empty());
+        assert(!_signed || !m_pk.empty());
 
-            if ( !data.empty() ) {
-                data += "&";
+        api::result<R> res{};
+        auto &next = next_options();
+        if ( !cb ) {
+            if ( m_dedicated_io_thread
+                && !m_ioctx.get_executor().running_in_this_thread()
+                && post_and_wait<R>(res, _signed, target, action, params) )
+            {
+                return res;
             }
-            data += "timestamp=";
-            char buf[32];
-            data += to_string(buf, sizeof(buf), get_current_ms_epoch());
-
-            data += "&recvWindow=";
-            data += to_string(buf, sizeof(buf), m_timeout);
-
-            std::string signature = hmac_sha256(
-                 m_sk.c_str()
-                ,m_sk.length()
-                ,data.c_str()
-                ,data.length()
-            );
 
-            data += "&signature=";
-            data += signature;
-        }
-
-        bool get_delete =
-            action == boost::beast::http::verb::get ||
-            action == boost::beast::http::verb::delete_
-        ;
-        if ( get_delete && !data.empty() ) {
-            starget += "?";
-            starget += data;
-            data.clear();
-        }
+            // the deadlines and priorities are for the async requests only
+            next.deadline.reset();
+            next.priority.reset();
 
-        api::result<R> res{};
-        if ( !cb ) {
+            stage_clock clock{latency_of(action, target)};
             try {
-                api::result<std::string> r = sync_post(starget.c_str(), action, std::move(data));
+                api::result<std::string> r = sync_post(_signed, target, action, params, clock);
+                if ( !r ) {
+                    res.ec = r.ec;
+                    res.errmsg = std::move(r.errmsg);
+
+                    return res;
+                }
                 if ( !r.v.empty() && is_html(r.v.c_str()) ) {
                     r.errmsg = std::move(r.v);
                 } else {
+                    const auto transport = clock.elapsed();
+                    const auto parse_start = std::chrono::steady_clock::now();
+                    auto parsed = [&clock, transport, parse_start]() {
+                        const std::chrono::nanoseconds parse_time = std::chrono::steady_clock::now() - parse_start;
+                        clock.record(latency_stats::e_stage::parse, parse_time);
+                        clock.record(latency_stats::e_stage::total, transport + parse_time);
+                    };
+
                     std::string strbuf = std::move(r.v);
                     const flatjson::fjson json{strbuf.c_str(), strbuf.length()};
                     if ( json.error() != flatjson::FJ_EC_OK ) {
@@ -348,10 +341,21 @@ struct api::impl {
                         res.ec = error.first;
                         __MAKE_ERRMSG(res, error.second)
                         res.reply.clear();
+                        // the partial result, e.g. of the failed cancel-replace
+                        if ( json.contains("data") ) {
+                            try {
+                                res.v = R::construct(json.at("data"));
+                            } catch (const std::exception &) {
+                                res.v = R{};
+                            }
+                        }
+                        parsed();
 
                         return res;
                     } else {
                         res.v = R::construct(json);
+                        parsed();
+                        update_rate_limits(res.v);
                     }
                 }
             } catch (const std::exception &ex) {
@@ -360,311 +364,1302 @@ struct api::impl {
 
             return res;
         } else {
-            using invoker_type = detail::invoker<typename boost::callable_traits::return_type<CB>::type, R, CB>;
-            async_req_item item{
-                 starget
+            const auto priority = next.priority
+                ? *next.priority
+                : get_request_priority(target, action, _signed)
+            ;
+            const auto deadline = next.deadline ? *next.deadline : m_default_deadline.load();
+            next.priority.reset();
+            next.deadline.reset();
+
+            // the request is signed when it's sent, because it can wait in the queue
+            res.handle = enqueue<R>(
+                 priority
+                ,deadline
+                ,_signed
+                ,target
                 ,action
-                ,std::move(data)
-                ,std::make_shared<invoker_type>(std::move(cb))
+                ,get_request_cost(target, action, params)
+                ,params
+                ,std::move(cb)
+            );
+        }
+
+        return res;
+    }
+
+    template<typename R, typename CB>
+    api::request_handle enqueue(
+         api::e_priority priority
+        ,std::chrono::milliseconds deadline
+        ,bool _signed
+        ,const char *target
+        ,boost::beast::http::verb action
+        ,rate_limiter::cost_t cost
+        ,query_params params
+        ,CB cb)
+    {
+        async_req_ptr item = make_request<R>(
+             priority
+            ,deadline
+            ,_signed
+            ,target
+            ,action
+            ,cost
+            ,params
+            ,std::move(cb)
+        );
+        const auto handle = item->handle;
+        submit(std::move(item));
+
+        return handle;
+    }
+    // can be called from any thread
+    template<typename R, typename CB>
+    auto make_request(
+         api::e_priority priority
+        ,std::chrono::milliseconds deadline
+        ,bool _signed
+        ,const char *target
+        ,boost::beast::http::verb action
+        ,rate_limiter::cost_t cost
+        ,query_params params
+        ,CB cb)
+    {
+        auto wrapped = wrap_rate_limits_update<R>(std::move(cb));
+        using wrapped_type = decltype(wrapped);
+        using invoker_type = detail::invoker<typename boost::callable_traits::return_type<CB>::type, R, wrapped_type>;
+
+        async_req_ptr item = acquire_request();
+        item->handle = m_last_handle.fetch_add(1, std::memory_order_relaxed) + 1;
+        item->priority = priority;
+        item->target = target;
+        item->action = action;
+        item->_signed = _signed;
+        item->cost = cost;
+        request_builder::append_query(item->query, params);
+        item->emplace_invoker<invoker_type>(std::move(wrapped));
+        item->clock = stage_clock{latency_of(action, target)};
+        if ( deadline != std::chrono::milliseconds::zero() ) {
+            // counted from the call, the timer is started when the request is queued
+            item->deadline.expires_after(deadline);
+        } else {
+            item->deadline.expires_at(boost::asio::steady_timer::time_point{});
+        }
+
+        return item;
+    }
+    // the sync request from the thread other than the io_context's one, when the io_context is
+    // run by the dedicated thread. the request is passed to the io_context thread as the async one,
+    // so it shares the connections, the queues and the rate limiter with the others.
+    // the request is taken by the io_context thread only if it's picked up in time, otherwise it's
+    // retracted and false is returned, for the request to be made in place: the io_context which is
+    // not run(yet, or any more) would never complete it.
+    struct pickup_state {
+        enum e_state { pending, picked, retracted };
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        e_state state = pending;
+    };
+    static constexpr std::chrono::milliseconds pickup_timeout{100};
+
+    template<typename R>
+    bool post_and_wait(api::result<R> &res, bool _signed, const char *target, boost::beast::http::verb action, query_params params) {
+        std::promise<api::result<R>> promise;
+        auto future = promise.get_future();
+
+        auto cb = [&promise](const char *fl, int ec, std::string errmsg, R v) {
+            api::result<R> res{};
+            res.ec = ec;
+            if ( ec || !errmsg.empty() ) {
+                if ( fl ) {
+                    res.errmsg = fl;
+                    res.errmsg += ": ";
+                }
+                res.errmsg += errmsg;
+            }
+            res.v = std::move(v);
+            promise.set_value(std::move(res));
+
+            return true;
+        };
+
+        async_req_ptr item = make_request<R>(
+             get_request_priority(target, action, _signed)
+            ,m_default_deadline.load()
+            ,_signed
+            ,target
+            ,action
+            ,get_request_cost(target, action, params)
+            ,params
+            ,std::move(cb)
+        );
+        // the handler can be run after the retraction, so the state is shared with it
+        auto pickup = std::make_shared<pickup_state>();
+        boost::asio::post(
+             m_ioctx
+            ,[this, pickup, item=std::move(item)]() mutable {
+                {
+                    std::lock_guard<std::mutex> lock{pickup->mutex};
+                    if ( pickup->state == pickup_state::retracted ) {
+                        // the callback refers to the caller's promise, which is gone
+                        return;
+                    }
+                    pickup->state = pickup_state::picked;
+                }
+                pickup->cv.notify_one();
+                submit(std::move(item));
+             }
+        );
+
+        {
+            std::unique_lock<std::mutex> lock{pickup->mutex};
+            if ( !pickup->cv.wait_for(lock, pickup_timeout, [&pickup]{ return pickup->state == pickup_state::picked; }) ) {
+                pickup->state = pickup_state::retracted;
+
+                return false;
+            }
+        }
+
+        res = future.get();
+
+        return true;
+    }
+
+    // the limits from the exchangeInfo reply are used by the rate limiter
+    template<typename R>
+    void update_rate_limits(const R &) {}
+    void update_rate_limits(const exchange_info_t &info) {
+        if ( !info.rateLimits.empty() ) {
+            m_limiter.set_limits(info.rateLimits);
+        }
+    }
+    // only the exchangeInfo callback is wrapped, the others are invoked directly
+    template<typename R, typename CB>
+    auto wrap_rate_limits_update(CB cb) {
+        if constexpr ( std::is_same<R, exchange_info_t>::value ) {
+            return [this, cb=std::move(cb)](const char *fl, int ec, std::string errmsg, R res) mutable {
+                if ( !ec ) {
+                    update_rate_limits(res);
+                }
+
+                return cb(fl, ec, std::move(errmsg), std::move(res));
             };
-            m_async_requests.push(std::move(item));
+        } else {
+            return cb;
+        }
+    }
 
-            async_post();
+    // the body is decoded while it's read, and parsed right from its contiguous storage
+    using body_type = inflating_body;
+    using response_type = boost::beast::http::response<body_type>;
+    // the header and the body are read separately, for the time to the first byte
+    using parser_type = boost::beast::http::response_parser<body_type>;
+    using ssl_socket_type = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+
+    struct connection {
+        // in the thread-safe mode the executor is the strand of the connection
+        connection(const boost::asio::any_io_executor &ex, boost::asio::ssl::context &ssl_ctx)
+            :stream{ex, ssl_ctx}
+            ,buffer{}
+            ,wire{}
+            ,query{}
+            ,parser{}
+            ,body{}
+            ,decoder{}
+            ,json{}
+            ,last_used{}
+            ,connected{}
+        {}
+
+        // the body storage is moved into the parser of each response and back, so its capacity
+        // is reused by all the responses received over this connection
+        parser_type& start_response() {
+            parser.emplace();
+            parser->get().body().buffer = std::move(body);
+            parser->get().body().decoder = &decoder;
+
+            return *parser;
+        }
+        // the body of the response is not valid after
+        void finish_response() {
+            if ( parser ) {
+                body = std::move(parser->get().body().buffer);
+                body.clear();
+                parser.reset();
+            }
         }
 
-        return res;
+        ssl_socket_type stream;
+        boost::beast::flat_buffer buffer; // (Must persist between reads)
+        std::string wire;  // the serialized request of the sync calls
+        std::string query; // the scratch buffer
+        std::optional<parser_type> parser; // of the response being read
+        boost::beast::flat_buffer body;
+        inflater decoder; // its state is reused by the compressed responses
+        flatjson::fjson json; // the parser of the async responses
+        std::chrono::steady_clock::time_point last_used;
+        bool connected;
+    };
+    using connection_ptr = std::unique_ptr<connection>;
+
+    connection_ptr make_connection() {
+        if ( m_thread_safe ) {
+            return std::make_unique<connection>(boost::asio::make_strand(m_ioctx), m_tls.context());
+        }
+
+        return std::make_unique<connection>(m_ioctx.get_executor(), m_tls.context());
     }
+    // returns a warm idle connection if there is one, or a new unconnected one
+    connection_ptr acquire_connection() {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        while ( !m_idle_connections.empty() ) {
+            connection_ptr conn = std::move(m_idle_connections.back());
+            m_idle_connections.pop_back();
+            if ( is_alive(*conn) ) {
+                return conn;
+            }
 
-    api::result<std::string>
-    sync_post(const char *target, boost::beast::http::verb action, std::string data) {
-        api::result<std::string> res{};
+            close_connection(*conn);
+        }
+        lock.unlock();
 
-        boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssl_stream(m_ioctx, m_ssl_ctx);
+        return make_connection();
+    }
+    void release_connection(connection_ptr conn, bool keep_alive) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if ( keep_alive && conn->connected && m_idle_connections.size() < m_max_idle_connections ) {
+            conn->last_used = std::chrono::steady_clock::now();
+            m_idle_connections.push_back(std::move(conn));
+        } else {
+            close_connection(*conn);
+        }
+    }
+    bool is_alive(connection &conn) const {
+        auto &sock = conn.stream.next_layer();
+        if ( !conn.connected || !sock.is_open() || conn.buffer.size() ) {
+            return false;
+        }
+        if ( std::chrono::steady_clock::now() - conn.last_used >= m_idle_timeout ) {
+            return false;
+        }
 
-        if( !SSL_set_tlsext_host_name(ssl_stream.native_handle(), m_host.c_str()) ) {
-            boost::system::error_code ec{static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
-            std::cerr << __MESSAGE("msg=" << ec.message()) << std::endl;
+        // an idle keep-alive stream has nothing to read. if it has - it's a close_notify/FIN from the server.
+        boost::system::error_code ec;
+        sock.non_blocking(true, ec);
+        char ch;
+        sock.receive(boost::asio::buffer(&ch, 1), boost::asio::ip::tcp::socket::message_peek, ec);
+        const bool alive = (ec == boost::asio::error::would_block);
+        sock.non_blocking(false, ec);
 
-            __MAKE_ERRMSG(res, ec.message());
-            return res;
+        return alive;
+    }
+    void on_response(const response_type &resp) {
+        for ( const auto &it: resp ) {
+            m_limiter.on_header(it.name_string(), it.value());
         }
 
+        const auto status = resp.result_int();
+        if ( status == 429 || status == 418 ) {
+            std::size_t retry_after = 60;
+            auto it = resp.find(boost::beast::http::field::retry_after);
+            if ( it != resp.end() ) {
+                retry_after = std::strtoul(std::string{it->value()}.c_str(), nullptr, 10);
+            }
+            m_limiter.on_ban(std::chrono::seconds{retry_after});
+        }
+    }
+    static void close_connection(connection &conn) {
         boost::system::error_code ec;
-        auto const results = m_resolver.resolve(m_host, m_port, ec);
+        conn.stream.next_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        conn.stream.next_layer().close(ec);
+        conn.connected = false;
+    }
+    bool is_compressed(const char *target) const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return std::any_of(
+             m_compressed.begin()
+            ,m_compressed.end()
+            ,[target](const std::string &it) { return it == target; }
+        );
+    }
+    // how far the request got over the connection
+    struct exchange_progress {
+        std::size_t written; // the bytes of the request
+        bool received; // any byte of the response
+    };
+    // the server may close an idle keep-alive connection at any moment, then the request is sent
+    // again using a new one. but only when the server can't have processed it: nothing of it is
+    // written, or nothing is received for the idempotent one. the signed POSTs are never resent
+    static bool can_retry(bool reused, boost::beast::http::verb action, const exchange_progress &progress) {
+        return reused && (progress.written == 0 || (!progress.received && is_idempotent(action)));
+    }
+    latency_stats::endpoint* latency_of(boost::beast::http::verb action, const char *target) {
+        return m_latency_enabled.load(std::memory_order_relaxed) ? m_latency.get(action, target) : nullptr;
+    }
+
+    // the one-shot options of the next async request
+    struct one_shot_options {
+        std::uint64_t owner; // the 'm_id'
+        std::optional<std::chrono::milliseconds> deadline;
+        std::optional<api::e_priority> priority;
+    };
+    // in the thread-safe mode they are per thread, so the concurrent requests don't take them.
+    // they are of the api by its id, not by the address: the new api can be at the address of
+    // the destroyed one, whose options are left unused
+    one_shot_options& next_options() {
+        if ( !m_thread_safe ) {
+            return m_next;
+        }
+
+        static thread_local one_shot_options options{};
+        if ( options.owner != m_id ) {
+            options = one_shot_options{m_id, {}, {}};
+        }
+
+        return options;
+    }
+    static std::uint64_t next_id() {
+        static std::atomic<std::uint64_t> last{};
+
+        return last.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    // in the thread-safe mode the state of the async requests is changed on the strand
+    template<typename F>
+    void configure(F f) {
+        if ( m_thread_safe ) {
+            boost::asio::dispatch(m_executor, std::move(f));
+        } else {
+            f();
+        }
+    }
+
+    // the local times of the exchange on the wire, for the samples of the server clock
+    struct wire_stamps {
+        std::chrono::steady_clock::time_point sent;     // the request is written
+        std::chrono::steady_clock::time_point received; // the first byte of the response is read
+    };
+
+    api::result<std::string>
+    sync_post(
+         bool _signed
+        ,const char *target
+        ,boost::beast::http::verb action
+        ,query_params params
+        ,stage_clock &clock
+        ,wire_stamps *stamps = nullptr)
+    {
+        api::result<std::string> res{};
+
+        bool orders_limit{};
+        const auto cost = get_request_cost(target, action, params);
+        for ( auto wait = m_limiter.acquire(cost, &orders_limit); wait.count(); wait = m_limiter.acquire(cost, &orders_limit) ) {
+            // the delay would stall all the async requests and the websockets of the io_context
+            if ( m_limiter.get_policy() == rate_limiter::e_policy::reject
+                || m_ioctx.get_executor().running_in_this_thread() )
+            {
+                res.ec = static_cast<int>(orders_limit ? e_error::TOO_MANY_ORDERS : e_error::TOO_MANY_REQUESTS);
+                __MAKE_ERRMSG(res, "rejected by the client side rate limiter");
+
+                return res;
+            }
+
+            std::this_thread::sleep_for(wait);
+        }
+        clock.lap(latency_stats::e_stage::queue);
+
+        connection_ptr conn = acquire_connection();
+        const bool reused = conn->connected;
+        m_builder.build(conn->wire, conn->query, _signed, m_clock.now_ms(), target, action, params, is_compressed(target));
+        clock.lap(latency_stats::e_stage::sign);
+
+        bool keep_alive{};
+        exchange_progress progress{};
+        boost::system::error_code ec = sync_exchange(*conn, res.v, keep_alive, clock, progress, stamps);
+        if ( ec && can_retry(reused, action, progress) ) {
+            // retry once using a new connection
+            close_connection(*conn);
+            auto fresh = std::make_unique<connection>(conn->stream.get_executor(), m_tls.context());
+            fresh->wire.swap(conn->wire);
+            conn = std::move(fresh);
+            clock.restart();
+            ec = sync_exchange(*conn, res.v, keep_alive, clock, progress, stamps);
+        }
         if ( ec ) {
             std::cerr << __MESSAGE("msg=" << ec.message()) << std::endl;
+            close_connection(*conn);
 
             __MAKE_ERRMSG(res, ec.message());
             return res;
         }
+//        std::cout << target << " REPLY:\n" << res.v << std::endl << std::endl;
+
+        release_connection(std::move(conn), keep_alive);
 
-        boost::asio::connect(ssl_stream.next_layer(), results.begin(), results.end(), ec);
+        return res;
+    }
+    boost::system::error_code sync_connect(connection &conn, stage_clock &clock) {
+        boost::system::error_code ec = m_tls.prepare(conn.stream.native_handle(), m_host);
         if ( ec ) {
-            std::cerr << __MESSAGE("msg=" << ec.message()) << std::endl;
+            return ec;
+        }
 
-            __MAKE_ERRMSG(res, ec.message());
-            return res;
+        auto const results = m_dns.resolve(m_host, m_port, ec);
+        if ( ec ) {
+            return ec;
         }
+        clock.lap(latency_stats::e_stage::dns);
 
-        ssl_stream.handshake(boost::asio::ssl::stream_base::client, ec);
+        boost::asio::connect(conn.stream.next_layer(), results.begin(), results.end(), ec);
         if ( ec ) {
-            std::cerr << __MESSAGE("msg=" << ec.message()) << std::endl;
+            return ec;
+        }
+        clock.lap(latency_stats::e_stage::connect);
 
-            __MAKE_ERRMSG(res, ec.message());
-            return res;
+        conn.stream.handshake(boost::asio::ssl::stream_base::client, ec);
+        if ( ec ) {
+            return ec;
         }
+        clock.lap(latency_stats::e_stage::handshake);
 
-        boost::beast::http::request<boost::beast::http::string_body> req;
-        req.target(target);
-        req.version(11);
+        m_tls.handshake_completed(conn.stream.native_handle());
+        conn.connected = true;
 
-        req.method(action);
-        if ( action != boost::beast::http::verb::get ) {
-            req.body() = std::move(data);
-            req.set(boost::beast::http::field::content_length, std::to_string(req.body().length()));
+        return ec;
+    }
+    boost::system::error_code sync_exchange(
+         connection &conn
+        ,std::string &body
+        ,bool &keep_alive
+        ,stage_clock &clock
+        ,exchange_progress &progress
+        ,wire_stamps *stamps)
+    {
+        progress = exchange_progress{};
+
+        boost::system::error_code ec;
+        if ( !conn.connected ) {
+            ec = sync_connect(conn, clock);
+            if ( ec ) {
+                return ec;
+            }
         }
 
-        req.insert("X-MBX-APIKEY", m_pk);
-        req.set(boost::beast::http::field::host, m_host);
-        req.set(boost::beast::http::field::user_agent, m_client_api_string);
-        req.set(boost::beast::http::field::content_type, "application/x-www-form-urlencoded");
+        if ( stamps ) {
+            stamps->sent = std::chrono::steady_clock::now();
+        }
+        progress.written = boost::asio::write(conn.stream, boost::asio::buffer(conn.wire), ec);
+        if ( ec ) {
+            return ec;
+        }
+        clock.lap(latency_stats::e_stage::write);
 
-        boost::beast::http::write(ssl_stream, req, ec);
+        parser_type &parser = conn.start_response();
+        boost::beast::http::read_header(conn.stream, conn.buffer, parser, ec);
+        // the incomplete header is left in the buffer
+        progress.received = !ec || conn.buffer.size() != 0;
         if ( ec ) {
-            std::cerr << __MESSAGE("msg=" << ec.message()) << std::endl;
+            return ec;
+        }
+        if ( stamps ) {
+            stamps->received = std::chrono::steady_clock::now();
+        }
+        clock.lap(latency_stats::e_stage::first_byte);
 
-            __MAKE_ERRMSG(res, ec.message());
-            return res;
+        boost::beast::http::read(conn.stream, conn.buffer, parser, ec);
+        if ( ec ) {
+            return ec;
         }
+        clock.lap(latency_stats::e_stage::read);
 
-        boost::beast::flat_buffer buffer;
-        boost::beast::http::response<boost::beast::http::string_body> bres;
+        response_type &resp = parser.get();
 
-        boost::beast::http::read(ssl_stream, buffer, bres, ec);
-        if ( ec ) {
-            std::cerr << __MESSAGE("msg=" << ec.message()) << std::endl;
+        keep_alive = resp.keep_alive();
+        on_response(resp);
+        body = boost::beast::buffers_to_string(resp.body().buffer.data());
+        conn.finish_response();
 
-            __MAKE_ERRMSG(res, ec.message());
-            return res;
+        return ec;
+    }
+
+    // in the thread-safe mode it's passed to the strand by the queue of the submissions
+    struct async_req_item: mpsc_queue_hook {
+        explicit async_req_item(const boost::asio::any_io_executor &ex)
+            :handle{}
+            ,priority{}
+            ,target{}
+            ,action{}
+            ,_signed{}
+            ,cost{}
+            ,query{}
+            ,wire{}
+            ,invoker{}
+            ,invoker_inplace{}
+            ,conn{}
+            ,reused{}
+            ,progress{}
+            ,deadline{ex}
+            ,abort_ec{}
+            ,abort_msg{}
+            ,clock{nullptr}
+            ,executor{}
+            ,cancel_posted{}
+            ,stamps{}
+            ,active_hook{}
+        {}
+        ~async_req_item() {
+            destroy_invoker();
         }
 
-        res.v = std::move(bres.body());
-//        std::cout << target << " REPLY:\n" << res.v << std::endl << std::endl;
+        // the invoker of the usual callback fits the storage of the item, so it's not allocated
+        template<typename T, typename F>
+        void emplace_invoker(F f) {
+            if constexpr ( sizeof(T) <= sizeof(invoker_storage) && alignof(T) <= alignof(std::max_align_t) ) {
+                invoker = new(invoker_storage) T{std::move(f)};
+                invoker_inplace = true;
+            } else {
+                invoker = new T{std::move(f)};
+                invoker_inplace = false;
+            }
+        }
+        void destroy_invoker() {
+            if ( invoker_inplace ) {
+                invoker->~invoker_base();
+            } else {
+                delete invoker;
+            }
+            invoker = nullptr;
+            invoker_inplace = false;
+        }
+        // the buffers keep their capacity
+        void recycle() {
+            destroy_invoker();
+            query.clear();
+            wire.clear();
+            conn.reset();
+            reused = false;
+            progress = exchange_progress{};
+            abort_ec = 0;
+            abort_msg = nullptr;
+            executor = boost::asio::any_io_executor{};
+            cancel_posted = false;
+            stamps.reset();
+        }
+
+        api::request_handle handle;
+        api::e_priority priority;
+        const char *target;
+        boost::beast::http::verb action;
+        bool _signed;
+        rate_limiter::cost_t cost;
+        std::string query;
+        std::string wire; // the serialized request
+        detail::invoker_base *invoker;
+        bool invoker_inplace; // in 'invoker_storage'
+        connection_ptr conn;
+        bool reused;
+        exchange_progress progress;
+        boost::asio::steady_timer deadline;
+        std::atomic<int> abort_ec; // the request is aborted because of the deadline or cancellation
+        const char *abort_msg;
+        stage_clock clock;
+        boost::asio::any_io_executor executor; // of the connection it's sent over
+        bool cancel_posted; // to the executor, in the thread-safe mode
+        std::shared_ptr<wire_stamps> stamps; // of the clock samples only
+        boost::intrusive::set_member_hook<> active_hook; // in 'm_active_requests'
+        alignas(std::max_align_t) unsigned char invoker_storage[96];
+    };
+    struct async_req_handle_getter {
+        using type = api::request_handle;
+        type operator()(const async_req_item &item) const { return item.handle; }
+    };
+    // queued and in-flight, by the handle. the set is intrusive, so the lookup by the handle
+    // needs no allocation
+    using active_requests_type = boost::intrusive::set<
+         async_req_item
+        ,boost::intrusive::key_of_value<async_req_handle_getter>
+        ,boost::intrusive::member_hook<async_req_item, boost::intrusive::set_member_hook<>, &async_req_item::active_hook>
+    >;
+    // the completed async requests are kept for the next ones, so the usual request does not
+    // allocate the item, its buffers and its invoker. the handlers left in the io_context after
+    // the api can destroy the requests, so the pool is shared with them
+    struct async_req_pool {
+        enum: std::size_t { max_items = 64 };
+
+        ~async_req_pool() {
+            for ( auto *it: items ) {
+                delete it;
+            }
+        }
 
-        ssl_stream.shutdown(ec);
+        std::mutex mutex;
+        std::vector<async_req_item *> items;
+    };
+    struct async_req_deleter {
+        void operator()(async_req_item *item) const {
+            item->recycle();
+            {
+                std::lock_guard<std::mutex> lock{pool->mutex};
+                if ( pool->items.size() < async_req_pool::max_items ) {
+                    pool->items.push_back(item);
+
+                    return;
+                }
+            }
 
-        return res;
+            delete item;
+        }
+
+        std::shared_ptr<async_req_pool> pool;
+    };
+    using async_req_ptr = std::unique_ptr<async_req_item, async_req_deleter>;
+
+    async_req_ptr acquire_request() {
+        async_req_item *item{};
+        {
+            std::lock_guard<std::mutex> lock{m_req_pool->mutex};
+            if ( !m_req_pool->items.empty() ) {
+                item = m_req_pool->items.back();
+                m_req_pool->items.pop_back();
+            }
+        }
+        if ( !item ) {
+            item = new async_req_item{m_executor};
+        }
+
+        return async_req_ptr{item, async_req_deleter{m_req_pool}};
+    }
+
+    void submit(async_req_ptr item) {
+        if ( !m_thread_safe ) {
+            queue_request(std::move(item));
+            async_post();
+
+            return;
+        }
+
+        m_submissions.push(item.release());
+        // the drain is scheduled by the first one who finds it is not
+        if ( !m_drain_scheduled.exchange(true, std::memory_order_acq_rel) ) {
+            boost::asio::post(m_executor, [this]() { drain_submissions(); });
+        }
+    }
+    // on the strand
+    void drain_submissions() {
+        // the pushes completed before are seen by the pops below, and the ones which are still
+        // in progress will find the drain is not scheduled
+        m_drain_scheduled.exchange(false, std::memory_order_acq_rel);
+        while ( async_req_item *item = m_submissions.pop() ) {
+            queue_request(async_req_ptr{item, async_req_deleter{m_req_pool}});
+        }
+
+        async_post();
     }
+    void queue_request(async_req_ptr item) {
+        start_deadline(*item);
+        m_active_requests.insert(*item);
+        m_async_requests[static_cast<std::size_t>(item->priority)].push_back(std::move(item));
+    }
+
+    // the queue of the highest priority which has a request that can be sent now
+    std::deque<async_req_ptr>* next_queue() {
+        for ( auto &it: m_async_requests ) {
+            if ( it.empty() ) {
+                continue;
+            }
+            if ( it.front()->priority == api::e_priority::market_data && m_inflight_bulk >= m_max_inflight_bulk ) {
+                continue;
+            }
 
-    using request_ptr = std::unique_ptr<boost::beast::http::request<boost::beast::http::string_body>>;
-    using request_type = typename request_ptr::element_type;
-    using response_ptr = std::unique_ptr<boost::beast::http::response<boost::beast::http::string_body>>;
-    using response_type = typename response_ptr::element_type;
-    using ssl_socket_ptr = std::unique_ptr<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>;
-    using ssl_socket_type = typename ssl_socket_ptr::element_type;
+            return &it;
+        }
 
+        return nullptr;
+    }
     void async_post() {
-        if ( m_write_in_process ) {
+        std::deque<async_req_ptr> *queue{};
+        while ( !m_limit_waiting && m_inflight < m_max_inflight && (queue = next_queue()) ) {
+            bool orders_limit{};
+            auto wait = m_limiter.acquire(queue->front()->cost, &orders_limit);
+            if ( wait.count() ) {
+                if ( m_limiter.get_policy() == rate_limiter::e_policy::reject ) {
+                    async_req_ptr item = std::move(queue->front());
+                    queue->pop_front();
+                    reject_request(std::move(item), orders_limit);
+                    continue;
+                }
+
+                m_limit_waiting = true;
+                m_limit_timer.expires_after(wait);
+                m_limit_timer.async_wait(
+                    [this](const boost::system::error_code &ec) {
+                        // the timer is destroyed with the api, or replaced by set_thread_safe()
+                        if ( ec == boost::asio::error::operation_aborted ) {
+                            return;
+                        }
+
+                        m_limit_waiting = false;
+                        async_post();
+                    }
+                );
+
+                return;
+            }
+
+            async_req_ptr item = std::move(queue->front());
+            queue->pop_front();
+
+            ++m_inflight;
+            if ( item->priority == api::e_priority::market_data ) {
+                ++m_inflight_bulk;
+            }
+            start_request(std::move(item));
+        }
+    }
+    void reject_request(async_req_ptr item, bool orders_limit) {
+        const auto ec = orders_limit ? e_error::TOO_MANY_ORDERS : e_error::TOO_MANY_REQUESTS;
+        fail_queued_request(__MAKE_FILELINE, std::move(item), static_cast<int>(ec), "rejected by the client side rate limiter");
+    }
+    // for the requests which were not sent
+    void fail_queued_request(const char *fl, async_req_ptr item, int ec, const char *errmsg) {
+        m_active_requests.erase(item->handle);
+        item->deadline.cancel();
+
+        // not from the caller's stack
+        boost::asio::post(
+             m_executor
+            ,[this, fl, ec, errmsg, item=std::move(item)]() mutable
+             { process_reply(fl, *item, ec, errmsg, m_json, nullptr, 0); }
+        );
+    }
+
+    void start_deadline(async_req_item &item) {
+        if ( item.deadline.expiry() == boost::asio::steady_timer::time_point{} ) {
+            // no deadline
             return;
         }
 
-        m_write_in_process = true;
+        // the item can be destroyed before the handler is called, so it's looked up by the handle
+        item.deadline.async_wait(
+            [this, handle=item.handle](const boost::system::error_code &ec) {
+                if ( ec ) {
+                    return;
+                }
 
-        auto &front = m_async_requests.front();
-        auto action = front.action;
-        std::string data = std::move(front.data);
-        std::string target = front.target;
-        //std::cout << "async_post(): target=" << target << std::endl;
+                auto it = m_active_requests.find(handle);
+                if ( it != m_active_requests.end() ) {
+                    abort_request(*it, static_cast<int>(e_error::TIMEOUT), "request deadline expired");
+                }
+            }
+        );
+    }
+    bool cancel_request(api::request_handle handle) {
+        auto it = m_active_requests.find(handle);
+        if ( it == m_active_requests.end() ) {
+            return false;
+        }
 
-        auto req = std::make_unique<request_type>();
-        req->version(11);
-        req->method(action);
-        if ( action != boost::beast::http::verb::get ) {
-            req->body() = std::move(data);
-            req->set(boost::beast::http::field::content_length, std::to_string(req->body().length()));
+        return abort_request(
+             *it
+            ,boost::asio::error::operation_aborted
+            ,"request cancelled"
+        );
+    }
+    bool abort_request(async_req_item &item, int ec, const char *errmsg) {
+        if ( item.abort_ec ) {
+            return false;
         }
 
-        req->target(target);
-        req->insert("X-MBX-APIKEY", m_pk);
-        req->set(boost::beast::http::field::host, m_host);
-        req->set(boost::beast::http::field::user_agent, m_client_api_string);
-        req->set(boost::beast::http::field::content_type, "application/x-www-form-urlencoded");
+        // the message is read after the code, by the strand of the connection in the thread-safe mode
+        item.abort_msg = errmsg;
+        item.abort_ec = ec;
+        item.deadline.cancel();
 
-        //std::cout << target << " REQUEST:\n" << m_req << std::endl;
+        auto &queue = m_async_requests[static_cast<std::size_t>(item.priority)];
+        auto pred = [&item](const async_req_ptr &it) { return it.get() == &item; };
+        auto it = std::find_if(queue.begin(), queue.end(), pred);
+        if ( it != queue.end() ) {
+            async_req_ptr queued = std::move(*it);
+            queue.erase(it);
+            fail_queued_request(__MAKE_FILELINE, std::move(queued), ec, errmsg);
 
+            return true;
+        }
+
+        // in flight. the I/O in progress completes with an error, and the next step sees 'abort_ec'
+        if ( !m_thread_safe ) {
+            cancel_io(item);
+
+            return true;
+        }
+
+        // the connection is used on its strand. the item is not destroyed until the posted
+        // cancellation is executed, see retire_request()
+        item.cancel_posted = true;
+        boost::asio::post(item.executor, [&item]() { cancel_io(item); });
+
+        return true;
+    }
+    // the socket is closed, not cancelled: the cancel() is lost when the read of the composed
+    // operation is completed but its handler is not called yet, the TLS read issues the next one.
+    // the connection is not reused after the abort anyway
+    static void cancel_io(async_req_item &item) {
+        if ( item.conn ) {
+            boost::system::error_code ignored;
+            item.conn->stream.next_layer().close(ignored);
+        }
+    }
+    // in the thread-safe mode, for the cancellation from the other thread: the request can be still
+    // in the queue of the submissions
+    void cancel_submitted(api::request_handle handle) {
+        drain_submissions();
+        if ( cancel_request(handle) || m_active_requests.count(handle) ) {
+            return;
+        }
+        if ( !m_submissions.empty() ) {
+            // the push is in progress
+            boost::asio::post(m_executor, [this, handle]() { cancel_submitted(handle); });
+        }
+    }
+    void start_request(async_req_ptr item) {
+        item->clock.lap(latency_stats::e_stage::queue);
+        m_builder.build_prepared(
+             item->wire
+            ,item->query
+            ,item->_signed
+            ,m_clock.now_ms()
+            ,item->target
+            ,item->action
+            ,is_compressed(item->target)
+        );
+        item->clock.lap(latency_stats::e_stage::sign);
+
+        item->conn = acquire_connection();
+        item->reused = item->conn->connected;
+        item->executor = item->conn->stream.get_executor();
+        if ( !m_thread_safe ) {
+            send_request(std::move(item));
+
+            return;
+        }
+
+        // the I/O, the parsing and the callback are on the strand of the connection
+        auto ex = item->executor;
+        boost::asio::post(
+             ex
+            ,[this, item=std::move(item)]() mutable
+             { send_request(std::move(item)); }
+        );
+    }
+    void send_request(async_req_ptr item) {
+        if ( item->reused ) {
+            async_write_request(std::move(item));
+        } else {
+            async_connect(std::move(item));
+        }
+    }
+    void async_connect(async_req_ptr item) {
         // Look up the domain name
-        m_resolver.async_resolve(
+        m_dns.async_resolve(
              m_host
             ,m_port
-            ,[this, req=std::move(req)]
+            ,[this, item=std::move(item)]
              (const boost::system::error_code &ec, boost::asio::ip::tcp::resolver::results_type res) mutable
-             { on_resolve(ec, std::move(req), std::move(res)); }
+             {
+                // the cached endpoints are passed in place, the resolved ones - by the resolver's handler
+                auto ex = item->executor;
+                boost::asio::dispatch(
+                     ex
+                    ,[this, ec, item=std::move(item), res=std::move(res)]() mutable
+                     { on_resolve(ec, std::move(item), std::move(res)); }
+                );
+             }
         );
     }
     void on_resolve(
          const boost::system::error_code &ec
-        ,request_ptr req
+        ,async_req_ptr item
         ,boost::asio::ip::tcp::resolver::results_type results)
     {
-        if ( ec ) {
-            m_write_in_process = false;
-            process_reply(__MAKE_FILELINE, ec.value(), ec.message(), std::string{});
+        if ( ec || item->abort_ec ) {
+            on_request_error(__MAKE_FILELINE, ec, std::move(item));
             return;
         }
+        item->clock.lap(latency_stats::e_stage::dns);
 
-        ssl_socket_ptr ssl_socket = std::make_unique<ssl_socket_type>(m_ioctx, m_ssl_ctx);
-
-        if(! SSL_set_tlsext_host_name(ssl_socket->native_handle(), m_host.c_str())) {
-            boost::system::error_code ec2{static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
-            std::cerr << __MESSAGE("msg=" << ec2.message()) << std::endl;
-
+        auto tls_ec = m_tls.prepare(item->conn->stream.native_handle(), m_host);
+        if ( tls_ec ) {
+            std::cerr << __MESSAGE("msg=" << tls_ec.message()) << std::endl;
+            on_request_error(__MAKE_FILELINE, tls_ec, std::move(item));
             return;
         }
 
-        auto sptr = ssl_socket.get();
+        auto *conn_ptr = item->conn.get();
 
         boost::asio::async_connect(
-             sptr->next_layer()
+             conn_ptr->stream.next_layer()
             ,results.begin()
             ,results.end()
-            ,[this, req=std::move(req), ssl_socket=std::move(ssl_socket)]
+            ,[this, item=std::move(item)]
              (const boost::system::error_code &ec, auto) mutable
-             { on_connect(ec, std::move(req), std::move(ssl_socket)); }
+             { on_connect(ec, std::move(item)); }
         );
     }
-    void on_connect(
-         const boost::system::error_code &ec
-        ,request_ptr req
-        ,ssl_socket_ptr ssl_socket)
-    {
-        if ( ec ) {
-            m_write_in_process = false;
-            process_reply(__MAKE_FILELINE, ec.value(), ec.message(), std::string{});
+    void on_connect(const boost::system::error_code &ec, async_req_ptr item) {
+        if ( ec || item->abort_ec ) {
+            on_request_error(__MAKE_FILELINE, ec, std::move(item));
             return;
         }
+        item->clock.lap(latency_stats::e_stage::connect);
 
-        auto sptr = ssl_socket.get();
+        auto *conn_ptr = item->conn.get();
 
         // Perform the SSL handshake
-        sptr->async_handshake(
+        conn_ptr->stream.async_handshake(
              boost::asio::ssl::stream_base::client
-            ,[this, req=std::move(req), ssl_socket=std::move(ssl_socket)]
+            ,[this, item=std::move(item)]
              (const boost::system::error_code &ec) mutable
-             { on_handshake(ec, std::move(req), std::move(ssl_socket)); }
+             { on_handshake(ec, std::move(item)); }
         );
     }
-    void on_handshake(
-         const boost::system::error_code &ec
-        ,request_ptr req
-        ,ssl_socket_ptr ssl_socket)
-    {
-        if ( ec ) {
-            m_write_in_process = false;
-            process_reply(__MAKE_FILELINE, ec.value(), ec.message(), std::string{});
+    void on_handshake(const boost::system::error_code &ec, async_req_ptr item) {
+        if ( ec || item->abort_ec ) {
+            on_request_error(__MAKE_FILELINE, ec, std::move(item));
             return;
         }
 
-        auto *request_ptr = req.get();
-        auto *socket_ptr = ssl_socket.get();
+        m_tls.handshake_completed(item->conn->stream.native_handle());
+        item->conn->connected = true;
+        item->clock.lap(latency_stats::e_stage::handshake);
+
+        async_write_request(std::move(item));
+    }
+    void async_write_request(async_req_ptr item) {
+        if ( item->stamps ) {
+            item->stamps->sent = std::chrono::steady_clock::now();
+        }
+        auto buffer = boost::asio::buffer(item->wire);
+        auto *conn_ptr = item->conn.get();
 
         // Send the HTTP request to the remote host
-        boost::beast::http::async_write(
-            *socket_ptr
-            ,*request_ptr
-            ,[this, req=std::move(req), ssl_socket=std::move(ssl_socket)]
+        boost::asio::async_write(
+             conn_ptr->stream
+            ,buffer
+            ,[this, item=std::move(item)]
              (const boost::system::error_code &ec, std::size_t wr) mutable
-             { on_write(ec, std::move(req), std::move(ssl_socket), wr); }
+             { on_write(ec, std::move(item), wr); }
         );
     }
-    void on_write(const boost::system::error_code &ec, request_ptr req, ssl_socket_ptr ssl_socket, std::size_t wr) {
-        boost::ignore_unused(wr);
-        boost::ignore_unused(req);
+    void on_write(const boost::system::error_code &ec, async_req_ptr item, std::size_t wr) {
+        item->progress.written = wr;
+        if ( ec || item->abort_ec ) {
+            on_request_error(__MAKE_FILELINE, ec, std::move(item));
+            return;
+        }
+        item->clock.lap(latency_stats::e_stage::write);
 
-        if ( ec ) {
-            m_write_in_process = false;
-            process_reply(__MAKE_FILELINE, ec.value(), ec.message(), std::string{});
+        auto *conn_ptr = item->conn.get();
+
+        // Receive the HTTP response header
+        boost::beast::http::async_read_header(
+             conn_ptr->stream
+            ,conn_ptr->buffer
+            ,conn_ptr->start_response()
+            ,[this, item=std::move(item)]
+             (const boost::system::error_code &ec, std::size_t rd) mutable
+             { on_read_header(ec, std::move(item), rd); }
+        );
+    }
+    void on_read_header(const boost::system::error_code &ec, async_req_ptr item, std::size_t rd) {
+        boost::ignore_unused(rd);
+
+        // the incomplete header is left in the buffer
+        item->progress.received = !ec || item->conn->buffer.size() != 0;
+        if ( ec || item->abort_ec ) {
+            on_request_error(__MAKE_FILELINE, ec, std::move(item));
             return;
         }
+        if ( item->stamps ) {
+            item->stamps->received = std::chrono::steady_clock::now();
+        }
+        item->clock.lap(latency_stats::e_stage::first_byte);
 
-        auto resp = std::make_unique<response_type>();
-        auto *resp_ptr = resp.get();
-        auto *socket_ptr = ssl_socket.get();
+        auto *conn_ptr = item->conn.get();
 
-        // Receive the HTTP response
+        // Receive the HTTP response body
         boost::beast::http::async_read(
-             *socket_ptr
-            ,m_buffer
-            ,*resp_ptr
-            ,[this, resp=std::move(resp), ssl_socket=std::move(ssl_socket)]
+             conn_ptr->stream
+            ,conn_ptr->buffer
+            ,*conn_ptr->parser
+            ,[this, item=std::move(item)]
              (const boost::system::error_code &ec, std::size_t rd) mutable
-             { on_read(ec, std::move(resp), std::move(ssl_socket), rd); }
+             { on_read(ec, std::move(item), rd); }
         );
     }
-    void on_read(const boost::system::error_code &ec, response_ptr resp, ssl_socket_ptr ssl_socket, std::size_t rd) {
+    void on_read(const boost::system::error_code &ec, async_req_ptr item, std::size_t rd) {
         boost::ignore_unused(rd);
 
-        if ( ec ) {
-            m_write_in_process = false;
-            process_reply(__MAKE_FILELINE, ec.value(), ec.message(), std::string{});
+        if ( ec || item->abort_ec ) {
+            on_request_error(__MAKE_FILELINE, ec, std::move(item));
             return;
         }
+        item->clock.lap(latency_stats::e_stage::read);
 
-        auto *socket_ptr = ssl_socket.get();
+        connection_ptr conn = std::move(item->conn);
+        const response_type &resp = conn->parser->get();
+        on_response(resp);
+        const bool keep_alive = resp.keep_alive();
 
-        socket_ptr->async_shutdown(
-            [this, resp=std::move(resp), ssl_socket=std::move(ssl_socket)]
-            (const boost::system::error_code &ec) mutable
-            { on_shutdown(ec, std::move(resp), std::move(ssl_socket)); }
+        // the body is parsed in place, and the connection is released after that
+        const auto body = resp.body().buffer.data();
+        if ( !m_thread_safe ) {
+            end_request(*item);
+        }
+        // the parser is taken from the connection for the time of the callback, so the nested
+        // requests of the callback can't get to it, and it's put back with its capacity
+        flatjson::fjson json = std::move(conn->json);
+        process_reply(
+             __MAKE_FILELINE
+            ,*item
+            ,0
+            ,std::string{}
+            ,json
+            ,static_cast<const char *>(body.data())
+            ,body.size()
         );
+        conn->json = std::move(json);
+        conn->finish_response();
+
+        complete_request(std::move(item), std::move(conn), keep_alive);
     }
-    void on_shutdown(const boost::system::error_code &ec, response_ptr resp, ssl_socket_ptr ssl_socket) {
-        boost::ignore_unused(ec);
-        boost::ignore_unused(ssl_socket);
+    void on_request_error(const char *fl, const boost::system::error_code &ec, async_req_ptr item) {
+        close_connection(*item->conn);
 
-        std::string body = std::move(resp->body());
-        process_reply(__MAKE_FILELINE, 0, std::string{}, std::move(body));
+        if ( item->abort_ec ) {
+            const int abort_ec = item->abort_ec;
+            const char *abort_msg = item->abort_msg;
+            finish_request(fl, std::move(item), abort_ec, abort_msg);
+            return;
+        }
+        if ( can_retry(item->reused, item->action, item->progress) ) {
+            // retry once using a new connection
+            item->reused = false;
+            item->progress = exchange_progress{};
+            // on the same strand, the cancellation can be posted to it
+            item->conn = std::make_unique<connection>(item->executor, m_tls.context());
+            item->clock.restart();
+            async_connect(std::move(item));
+            return;
+        }
 
-        m_write_in_process = false;
+        finish_request(fl, std::move(item), ec.value(), ec.message());
+    }
+    // for the failed requests
+    void finish_request(const char *fl, async_req_ptr item, int ec, std::string errmsg) {
+        if ( !m_thread_safe ) {
+            end_request(*item);
+        }
+        process_reply(fl, *item, ec, std::move(errmsg), m_json, nullptr, 0);
 
-        if ( !m_async_requests.empty() ) {
+        complete_request(std::move(item), connection_ptr{}, false);
+    }
+    // after the callback is called
+    void complete_request(async_req_ptr item, connection_ptr conn, bool keep_alive) {
+        if ( !m_thread_safe ) {
+            if ( conn ) {
+                release_connection(std::move(conn), keep_alive);
+            }
             async_post();
+
+            return;
+        }
+
+        // the bookkeeping is on the strand
+        boost::asio::post(
+             m_executor
+            ,[this, item=std::move(item), conn=std::move(conn), keep_alive]() mutable {
+                end_request(*item);
+                if ( conn ) {
+                    release_connection(std::move(conn), keep_alive);
+                }
+                retire_request(std::move(item));
+
+                async_post();
+             }
+        );
+    }
+    void retire_request(async_req_ptr item) {
+        if ( item->cancel_posted ) {
+            // the strand of the request executes the posted cancellation before
+            auto ex = item->executor;
+            boost::asio::post(ex, [item=std::move(item)]() {});
+        }
+    }
+    void end_request(async_req_item &item) {
+        --m_inflight;
+        if ( item.priority == api::e_priority::market_data ) {
+            --m_inflight_bulk;
         }
+        m_active_requests.erase(item.handle);
+        item.deadline.cancel();
     }
 
-    void process_reply(const char *fl, int ec, std::string errmsg, std::string body) {
-        assert(!m_async_requests.empty());
+    // the server time is sampled by the bursts of the few requests, so even if some of them wait
+    // in the queue, the best one is good enough
+    static constexpr std::size_t clock_burst = 4;
 
-        __TRY_BLOCK() {
-            const auto item = std::move(m_async_requests.front());
-            m_async_requests.pop();
+    void start_clock_sync(std::chrono::seconds interval) {
+        ++m_clock_generation;
+        m_clock_interval = interval;
+        m_clock_timer.cancel();
+        if ( interval != std::chrono::seconds::zero() ) {
+            clock_sample(clock_burst, m_clock_generation);
+        }
+    }
+
+    // the sample is stamped on the wire, so the time the request waits in the queue, for the
+    // connection or for the handshake doesn't count
+    void clock_sample(std::size_t burst, std::size_t generation) {
+        auto stamps = std::make_shared<wire_stamps>();
+        auto cb = [this, stamps, burst, generation]
+            (const char *, int ec, std::string, server_time_t res)
+        {
+            if ( !ec ) {
+                m_clock.add_sample(stamps->sent, stamps->received, res.serverTime);
+            }
+
+            // the callback can be called on the strand of the connection
+            boost::asio::dispatch(
+                 m_executor
+                ,[this, burst, generation]()
+                 { clock_next(burst, generation); }
+            );
+
+            return true;
+        };
+
+        // not to wait behind the market data requests
+        async_req_ptr item = make_request<server_time_t>(
+             api::e_priority::account
+            ,m_default_deadline
+            ,false
+            ,"/api/v3/time"
+            ,boost::beast::http::verb::get
+            ,rate_limiter::cost_t{1, 0}
+            ,query_params{}
+            ,std::move(cb)
+        );
+        item->stamps = std::move(stamps);
+        submit(std::move(item));
+    }
+    // the sync sample is made in place, not by the io_context thread, so it's stamped on the wire
+    // the same way
+    void sync_clock_sample() {
+        const char *target = "/api/v3/time";
+        const auto action = boost::beast::http::verb::get;
+        stage_clock clock{latency_of(action, target)};
+        wire_stamps stamps{};
+        try {
+            api::result<std::string> r = sync_post(false, target, action, query_params{}, clock, &stamps);
+            if ( !r ) {
+                return;
+            }
 
-            //std::cout << "process_reply(): target=" << item.target << std::endl;
-            item.invoker->invoke(fl, ec, std::move(errmsg), body.c_str(), body.size());
+            const flatjson::fjson json{r.v.c_str(), r.v.length()};
+            if ( json.error() != flatjson::FJ_EC_OK || !json.is_object() || binapi::rest::is_api_error(json) ) {
+                return;
+            }
+
+            const auto res = server_time_t::construct(json);
+            m_clock.add_sample(stamps.sent, stamps.received, res.serverTime);
+        } catch (const std::exception &) {}
+    }
+
+    void clock_next(std::size_t burst, std::size_t generation) {
+        if ( generation != m_clock_generation ) {
+            return;
+        }
+
+        if ( burst > 1 ) {
+            clock_sample(burst - 1, generation);
+        } else {
+            m_clock_timer.expires_after(m_clock_interval);
+            m_clock_timer.async_wait([this, generation](const boost::system::error_code &ec) {
+                if ( !ec && generation == m_clock_generation ) {
+                    clock_sample(clock_burst, generation);
+                }
+            });
+        }
+    }
+
+    void process_reply(
+         const char *fl
+        ,const async_req_item &item
+        ,int ec
+        ,std::string errmsg
+        ,flatjson::fjson &json
+        ,const char *ptr
+        ,std::size_t size)
+    {
+        __TRY_BLOCK() {
+            // the callback is called by the invoker, so its time is excluded
+            const auto transport = item.clock.elapsed();
+            std::chrono::nanoseconds parse_time{};
+            item.invoker->invoke(fl, ec, std::move(errmsg), json, ptr, size, parse_time);
+            if ( parse_time.count() ) {
+                item.clock.record(latency_stats::e_stage::parse, parse_time);
+                item.clock.record(latency_stats::e_stage::total, transport + parse_time);
+            }
         } __CATCH_BLOCK(
             std::cout,
             (std::exception)
         )
     }
 
+    const std::uint64_t m_id; // unique, never zero
     boost::asio::io_context &m_ioctx;
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+    boost::asio::any_io_executor m_executor; // of the state of the async requests, the strand in the thread-safe mode
+    bool m_thread_safe;
+    mpsc_queue<async_req_item> m_submissions; // of the async requests, from any thread in the thread-safe mode
+    std::atomic<bool> m_drain_scheduled;
     const std::string m_host;
     const std::string m_port;
     const std::string m_pk;
-    const std::string m_sk;
+    const std::shared_ptr<const signer> m_signer;
     const std::size_t m_timeout;
     const std::string m_client_api_string;
-
-    bool m_write_in_process;
-    struct async_req_item {
-        std::string target;
-        boost::beast::http::verb action;
-        std::string data;
-        detail::invoker_ptr invoker;
-    };
-    std::queue<async_req_item> m_async_requests;
-    boost::asio::ssl::context m_ssl_ctx;
-    boost::asio::ip::tcp::resolver m_resolver;
-    boost::beast::flat_buffer m_buffer; // (Must persist between reads)
+    const request_builder m_builder;
+
+    std::size_t m_max_inflight;
+    std::size_t m_inflight;
+    std::size_t m_max_inflight_bulk;
+    std::size_t m_inflight_bulk;
+    std::array<std::deque<async_req_ptr>, 3> m_async_requests; // by priority
+    std::shared_ptr<async_req_pool> m_req_pool;
+    tls_context &m_tls;
+    dns_cache &m_dns;
+    mutable std::mutex m_mutex; // of the idle connections and their settings, and of the compressed targets
+    std::size_t m_max_idle_connections;
+    std::chrono::steady_clock::duration m_idle_timeout;
+    std::vector<connection_ptr> m_idle_connections;
+    rate_limiter m_limiter;
+    boost::asio::steady_timer m_limit_timer;
+    bool m_limit_waiting;
+    std::atomic<std::chrono::milliseconds> m_default_deadline;
+    one_shot_options m_next;
+    std::atomic<api::request_handle> m_last_handle;
+    active_requests_type m_active_requests;
+    bool m_dedicated_io_thread;
+    clock_sync m_clock;
+    boost::asio::steady_timer m_clock_timer;
+    std::chrono::seconds m_clock_interval;
+    std::size_t m_clock_generation; // of the running sampling
+    latency_stats m_latency;
+    std::atomic<bool> m_latency_enabled;
+    flatjson::fjson m_json; // for the failed requests, which are not parsed
+    std::vector<std::string> m_compressed; // the targets
 };
 
 /*************************************************************************************************/
@@ -683,7 +1678,27 @@ api::api(
         ,std::move(host)
         ,std::move(port)
         ,std::move(pk)
-        ,std::move(sk)
+        ,std::make_shared<const hmac_sha256_signer>(sk)
+        ,timeout
+        ,std::move(client_api_string)
+    )}
+{}
+
+api::api(
+     boost::asio::io_context &ioctx
+    ,std::string host
+    ,std::string port
+    ,std::string pk
+    ,std::shared_ptr<const signer> signer
+    ,std::size_t timeout
+    ,std::string client_api_string
+)
+    :pimpl{std::make_unique<impl>(
+         ioctx
+        ,std::move(host)
+        ,std::move(port)
+        ,std::move(pk)
+        ,std::move(signer)
         ,timeout
         ,std::move(client_api_string)
     )}
@@ -694,6 +1709,155 @@ api::~api()
 
 /*************************************************************************************************/
 
+boost::asio::io_context& api::get_io_context() {
+    return pimpl->m_ioctx;
+}
+
+void api::set_max_idle_connections(std::size_t num) {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    pimpl->m_max_idle_connections = num;
+    while ( pimpl->m_idle_connections.size() > num ) {
+        impl::close_connection(*pimpl->m_idle_connections.front());
+        pimpl->m_idle_connections.erase(pimpl->m_idle_connections.begin());
+    }
+}
+
+void api::set_idle_timeout(std::size_t seconds) {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    pimpl->m_idle_timeout = std::chrono::seconds{seconds};
+}
+
+void api::set_max_inflight_requests(std::size_t num) {
+    assert(num > 0);
+
+    auto *impl = pimpl.get();
+    impl->configure([impl, num]() {
+        impl->m_max_inflight = num;
+        impl->async_post();
+    });
+}
+
+void api::set_rate_limit_policy(rate_limiter::e_policy policy) {
+    pimpl->m_limiter.set_policy(policy);
+}
+
+void api::set_rate_limits(const std::vector<exchange_info_t::rate_limit_t> &limits) {
+    pimpl->m_limiter.set_limits(limits);
+}
+
+std::vector<rate_limiter::headroom_t> api::rate_limits_headroom() const {
+    return pimpl->m_limiter.headroom();
+}
+
+void api::set_default_deadline(std::size_t ms) {
+    pimpl->m_default_deadline = std::chrono::milliseconds{ms};
+}
+
+api& api::with_deadline(std::size_t ms) {
+    pimpl->next_options().deadline = std::chrono::milliseconds{ms};
+
+    return *this;
+}
+
+void api::set_max_inflight_bulk_requests(std::size_t num) {
+    assert(num > 0);
+
+    auto *impl = pimpl.get();
+    impl->configure([impl, num]() {
+        impl->m_max_inflight_bulk = num;
+        impl->async_post();
+    });
+}
+
+api& api::with_priority(e_priority priority) {
+    pimpl->next_options().priority = priority;
+
+    return *this;
+}
+
+bool api::cancel(request_handle handle) {
+    if ( !pimpl->m_thread_safe || pimpl->m_strand.running_in_this_thread() ) {
+        return pimpl->cancel_request(handle);
+    }
+    if ( !handle || handle > pimpl->m_last_handle.load(std::memory_order_relaxed) ) {
+        return false;
+    }
+
+    auto *impl = pimpl.get();
+    boost::asio::post(impl->m_executor, [impl, handle]() { impl->cancel_submitted(handle); });
+
+    return true;
+}
+
+void api::set_clock_sync_interval(std::size_t seconds) {
+    auto *impl = pimpl.get();
+    impl->configure([impl, seconds]()
+        { impl->start_clock_sync(std::chrono::seconds{seconds}); }
+    );
+}
+
+void api::sync_clock(std::size_t samples) {
+    for ( ; samples; --samples ) {
+        pimpl->sync_clock_sample();
+    }
+}
+
+const clock_sync& api::get_clock_sync() const {
+    return pimpl->m_clock;
+}
+
+void api::enable_latency_stats(bool enable) {
+    pimpl->m_latency_enabled = enable;
+}
+
+std::vector<latency_stats::endpoint_snapshot_t> api::latency_stats_snapshot() const {
+    return pimpl->m_latency.snapshot();
+}
+
+void api::reset_latency_stats() {
+    pimpl->m_latency.reset();
+}
+
+void api::set_compression(const char *target, bool enable) {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    auto &targets = pimpl->m_compressed;
+    targets.erase(std::remove(targets.begin(), targets.end(), target), targets.end());
+    if ( enable ) {
+        targets.emplace_back(target);
+    }
+}
+
+void api::set_dedicated_io_thread(bool enable) {
+    pimpl->m_dedicated_io_thread = enable;
+}
+
+void api::set_thread_safe(bool enable) {
+    pimpl->m_thread_safe = enable;
+    if ( enable ) {
+        pimpl->m_executor = pimpl->m_strand;
+    } else {
+        pimpl->m_executor = pimpl->m_ioctx.get_executor();
+    }
+    pimpl->m_limit_timer = boost::asio::steady_timer{pimpl->m_executor};
+    if ( pimpl->m_limit_waiting ) {
+        // the wait is aborted with the previous timer
+        pimpl->m_limit_waiting = false;
+        boost::asio::post(pimpl->m_executor, [impl=pimpl.get()]() { impl->async_post(); });
+    }
+    pimpl->m_clock_timer = boost::asio::steady_timer{pimpl->m_executor};
+    // the deadline timers of the pooled requests have the executor of the previous mode
+    pimpl->m_req_pool = std::make_shared<impl::async_req_pool>();
+
+    // the idle connections have the executor of the previous mode
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    for ( auto &it: pimpl->m_idle_connections ) {
+        impl::close_connection(*it);
+    }
+    pimpl->m_idle_connections.clear();
+}
+
+/*************************************************************************************************/
+
 api::result<ping_t> api::ping(ping_cb cb) {
     return pimpl->post(false, "/api/v3/ping", boost::beast::http::verb::get, {}, std::move(cb));
 }
@@ -999,6 +2163,171 @@ api::result<cancel_order_info_t> api::cancel_order(
 
 /*************************************************************************************************/
 
+api::result<cancel_replace_order_info_t> api::cancel_replace_order(
+     const char *symbol
+    ,const e_cancel_replace_mode mode
+    ,std::size_t cancel_order_id
+    ,const char *cancel_client_order_id
+    ,const e_side side
+    ,const e_type type
+    ,const e_time time
+    ,const e_trade_resp_type resp
+    ,const char *amount
+    ,const char *price
+    ,const char *client_order_id
+    ,const char *stop_price
+    ,const char *iceberg_amount
+    ,cancel_replace_order_cb cb
+) {
+    const char *mode_str = e_cancel_replace_mode_to_string(mode);
+    assert(mode_str);
+
+    const char *side_str = e_side_to_string(side);
+    assert(side_str);
+
+    const char *type_str = e_type_to_string(type);
+    assert(type_str);
+
+    const char *time_str = type == e_type::market ? nullptr : e_time_to_string(time);
+
+    const char *response_type = e_trade_resp_type_to_string(resp);
+    assert(response_type);
+
+    const impl::init_list_type map = {
+         {"symbol", symbol}
+        ,{"cancelReplaceMode", mode_str}
+        ,{"cancelOrderId", cancel_order_id}
+        ,{"cancelOrigClientOrderId", cancel_client_order_id}
+        ,{"side", side_str}
+        ,{"type", type_str}
+        ,{"timeInForce", time_str}
+        ,{"quantity", amount}
+        ,{"price", price}
+        ,{"newClientOrderId", client_order_id}
+        ,{"stopPrice", stop_price}
+        ,{"icebergQty", iceberg_amount}
+        ,{"newOrderRespType", response_type}
+    };
+
+    return pimpl->post(true, "/api/v3/order/cancelReplace", boost::beast::http::verb::post, map, std::move(cb));
+}
+
+/*************************************************************************************************/
+
+api::result<cancel_replace_order_info_t> api::requote(
+     const char *symbol
+    ,std::size_t cancel_order_id
+    ,const char *cancel_client_order_id
+    ,const e_side side
+    ,const e_type type
+    ,const e_time time
+    ,const e_trade_resp_type resp
+    ,const char *amount
+    ,const char *price
+    ,const char *client_order_id
+    ,const char *stop_price
+    ,const char *iceberg_amount
+    ,cancel_replace_order_cb cb
+) {
+    result<cancel_replace_order_info_t> res{};
+
+    if ( !cb ) {
+        auto cancelled = cancel_order(symbol, cancel_order_id, cancel_client_order_id, nullptr);
+        auto placed = new_order(
+             symbol, side, type, time, resp, amount, price
+            ,client_order_id, stop_price, iceberg_amount
+        );
+
+        res.v.cancelResult = cancelled ? "SUCCESS" : "FAILURE";
+        res.v.cancelResponse = std::move(cancelled.v);
+        res.v.newOrderResult = placed ? "SUCCESS" : "FAILURE";
+        res.v.newOrderResponse = std::move(placed.v);
+        if ( !cancelled ) {
+            res.ec = cancelled.ec;
+            res.errmsg = std::move(cancelled.errmsg);
+        } else if ( !placed ) {
+            res.ec = placed.ec;
+            res.errmsg = std::move(placed.errmsg);
+        }
+
+        return res;
+    }
+
+    struct state {
+        struct error_t {
+            const char *fl;
+            int ec;
+            std::string errmsg;
+        };
+
+        cancel_replace_order_cb cb;
+        cancel_replace_order_info_t res;
+        std::optional<error_t> cancel_error;
+        std::optional<error_t> new_order_error;
+        std::size_t pending;
+
+        void complete() {
+            if ( --pending ) {
+                return;
+            }
+
+            const auto &error = cancel_error ? cancel_error : new_order_error;
+            if ( error ) {
+                cb(error->fl, error->ec, error->errmsg, std::move(res));
+            } else {
+                cb(nullptr, 0, std::string{}, std::move(res));
+            }
+        }
+    };
+    auto sp = std::make_shared<state>();
+    sp->cb = std::move(cb);
+    sp->pending = 2;
+
+    // both of the requests must take the one-shot options
+    const auto deadline = pimpl->next_options().deadline;
+    const auto priority = pimpl->next_options().priority;
+
+    cancel_order(
+         symbol
+        ,cancel_order_id
+        ,cancel_client_order_id
+        ,nullptr
+        ,[sp](const char *fl, int ec, std::string errmsg, cancel_order_info_t v) {
+            sp->res.cancelResult = ec ? "FAILURE" : "SUCCESS";
+            sp->res.cancelResponse = std::move(v);
+            if ( ec ) {
+                sp->cancel_error = state::error_t{fl, ec, std::move(errmsg)};
+            }
+            sp->complete();
+
+            return true;
+         }
+    );
+
+    pimpl->next_options().deadline = deadline;
+    pimpl->next_options().priority = priority;
+
+    auto placed = new_order(
+         symbol, side, type, time, resp, amount, price
+        ,client_order_id, stop_price, iceberg_amount
+        ,[sp](const char *fl, int ec, std::string errmsg, new_order_resp_type v) {
+            sp->res.newOrderResult = ec ? "FAILURE" : "SUCCESS";
+            sp->res.newOrderResponse = std::move(v);
+            if ( ec ) {
+                sp->new_order_error = state::error_t{fl, ec, std::move(errmsg)};
+            }
+            sp->complete();
+
+            return true;
+         }
+    );
+    res.handle = placed.handle;
+
+    return res;
+}
+
+/*************************************************************************************************/
+
 api::result<cancel_all_open_orders_info_t> api::cancel_all_open_orders(
      const char *symbol
     ,cancel_all_open_orders_cb cb
@@ -0,0 +1,199 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/clock_sync.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+namespace {
+
+std::int64_t to_us(std::chrono::steady_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+std::int64_t system_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+// the limit of the local clock drift, as the ratio
+constexpr double max_drift = 500e-6;
+// the samples get worse with the age, as if their RTT grew by 100us per second
+constexpr std::int64_t age_penalty_div = 10000;
+
+} // anon ns
+
+/*************************************************************************************************/
+
+struct clock_sync::impl {
+    struct sample {
+        std::int64_t at;     // the middle of the round trip, steady us
+        std::int64_t offset; // the server time minus the 'at', us
+        std::int64_t rtt;    // us
+    };
+
+    impl(std::size_t window)
+        :m_mutex{}
+        ,m_window{std::max<std::size_t>(window, 1)}
+        ,m_samples{}
+        ,m_next{}
+        ,m_used{}
+        ,m_at{}
+        ,m_offset{}
+        ,m_drift{}
+        ,m_rtt{}
+    {
+        m_samples.reserve(m_window);
+    }
+
+    void add_sample(std::int64_t sent, std::int64_t received, std::int64_t server_time) {
+        if ( received < sent ) {
+            return;
+        }
+
+        const sample s{
+             sent + (received - sent) / 2
+            ,server_time - (sent + (received - sent) / 2)
+            ,received - sent
+        };
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if ( m_samples.size() < m_window ) {
+            m_samples.push_back(s);
+        } else {
+            m_samples[m_next] = s;
+            m_next = (m_next + 1) % m_window;
+        }
+
+        const auto latest = std::max_element(
+             m_samples.begin()
+            ,m_samples.end()
+            ,[](const sample &l, const sample &r) { return l.at < r.at; }
+        )->at;
+        const auto best = *std::min_element(
+             m_samples.begin()
+            ,m_samples.end()
+            ,[latest](const sample &l, const sample &r) {
+                return l.rtt + (latest - l.at) / age_penalty_div
+                     < r.rtt + (latest - r.at) / age_penalty_div;
+             }
+        );
+        // the best one is already taken into account
+        if ( m_used && best.at <= m_at ) {
+            return;
+        }
+
+        ++m_used;
+        if ( m_used == 1 ) {
+            m_at = best.at;
+            m_offset = best.offset;
+            m_rtt = best.rtt;
+
+            return;
+        }
+
+        // the first samples are taken with the bigger weight to converge quickly
+        const double alpha = std::max(1.0 / static_cast<double>(m_used), 0.25);
+        const std::int64_t dt = best.at - m_at;
+        const double predicted = static_cast<double>(m_offset) + m_drift * static_cast<double>(dt);
+        const double error = static_cast<double>(best.offset) - predicted;
+
+        m_offset = static_cast<std::int64_t>(predicted + alpha * error);
+        if ( dt > 0 ) {
+            m_drift += alpha * alpha * error / static_cast<double>(dt);
+            m_drift = std::min(std::max(m_drift, -max_drift), max_drift);
+        }
+        m_at = best.at;
+        m_rtt = best.rtt;
+    }
+
+    // the server time at the steady 'now', us
+    std::int64_t server_time(std::int64_t now) const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if ( !m_used ) {
+            return system_now_us();
+        }
+
+        const double offset = static_cast<double>(m_offset) + m_drift * static_cast<double>(now - m_at);
+
+        return now + static_cast<std::int64_t>(offset);
+    }
+
+    mutable std::mutex m_mutex;
+    const std::size_t m_window;
+    std::vector<sample> m_samples;
+    std::size_t m_next; // the oldest one, when the window is full
+    std::size_t m_used;
+    std::int64_t m_at;
+    std::int64_t m_offset;
+    double m_drift;
+    std::int64_t m_rtt;
+};
+
+/*************************************************************************************************/
+
+clock_sync::clock_sync(std::size_t window)
+    :pimpl{std::make_unique<impl>(window)}
+{}
+
+clock_sync::~clock_sync()
+{}
+
+void clock_sync::add_sample(
+     std::chrono::steady_clock::time_point sent
+    ,std::chrono::steady_clock::time_point received
+    ,std::uint64_t server_time)
+{
+    // the server time is truncated to ms, so on average it's in the middle of the ms
+    pimpl->add_sample(to_us(sent), to_us(received), static_cast<std::int64_t>(server_time) * 1000 + 500);
+}
+
+bool clock_sync::synced() const {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    return pimpl->m_used != 0;
+}
+
+std::uint64_t clock_sync::now_ms() const {
+    const auto now = pimpl->server_time(to_us(std::chrono::steady_clock::now()));
+
+    return static_cast<std::uint64_t>(now / 1000);
+}
+
+std::int64_t clock_sync::offset_ms() const {
+    const auto now = pimpl->server_time(to_us(std::chrono::steady_clock::now()));
+
+    return (now - system_now_us()) / 1000;
+}
+
+double clock_sync::drift_ppm() const {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    return pimpl->m_drift * 1e6;
+}
+
+std::chrono::microseconds clock_sync::uncertainty() const {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    return std::chrono::microseconds{pimpl->m_rtt / 2};
+}
+
+std::int64_t clock_sync::latency_ms(std::uint64_t event_time) const {
+    return static_cast<std::int64_t>(now_ms()) - static_cast<std::int64_t>(event_time);
+}
+
+/*************************************************************************************************/
+
+} // ns binapi
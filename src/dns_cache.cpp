@@ -0,0 +1,261 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/dns_cache.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+boost::asio::io_context::id dns_cache::id;
+
+struct dns_cache::impl {
+    using clock_type = std::chrono::steady_clock;
+
+    struct entry {
+        entry(boost::asio::io_context &ioctx, std::string host, std::string port)
+            :host{std::move(host)}
+            ,port{std::move(port)}
+            ,resolver{ioctx}
+            ,results{}
+            ,resolved{}
+            ,expires{}
+            ,in_progress{}
+            ,waiters{}
+        {}
+
+        const std::string host;
+        const std::string port;
+        boost::asio::ip::tcp::resolver resolver;
+        results_type results;
+        bool resolved;    // 'results' holds the last successfully resolved endpoints
+        clock_type::time_point expires;
+        bool in_progress;
+        std::vector<resolve_cb> waiters;
+    };
+
+    explicit impl(boost::asio::io_context &ioctx)
+        :m_ioctx{ioctx}
+        ,m_ttl{std::chrono::seconds{60}}
+        ,m_retry_interval{std::chrono::seconds{5}}
+        ,m_mutex{}
+        ,m_entries{}
+        ,m_refresh_ioctx{}
+        ,m_refresh_work{boost::asio::make_work_guard(m_refresh_ioctx)}
+        ,m_refresher{}
+    {}
+    ~impl() {
+        stop_refresher();
+    }
+
+    static std::string make_key(const std::string &host, const std::string &port) {
+        std::string key = host;
+        key += ':';
+        key += port;
+
+        return key;
+    }
+
+    entry& get_entry(const std::string &host, const std::string &port) {
+        auto &ptr = m_entries[make_key(host, port)];
+        if ( !ptr ) {
+            ptr = std::make_unique<entry>(m_ioctx, host, port);
+        }
+
+        return *ptr;
+    }
+
+    results_type resolve(const std::string &host, const std::string &port, boost::system::error_code &ec) {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            auto &e = get_entry(host, port);
+            if ( e.resolved ) {
+                // the expired endpoints are still used while they are being refreshed
+                if ( !e.in_progress && clock_type::now() >= e.expires ) {
+                    start_sync_resolve(e);
+                }
+                ec.clear();
+
+                return e.results;
+            }
+        }
+
+        // nothing to use while the host is resolved the first time
+        boost::asio::ip::tcp::resolver resolver{m_ioctx};
+        results_type results = resolver.resolve(host, port, ec);
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto &e = get_entry(host, port);
+        if ( ec ) {
+            if ( !e.resolved ) {
+                return results;
+            }
+
+            // the last good endpoints are still in use
+            ec.clear();
+            e.expires = clock_type::now() + m_retry_interval;
+
+            return e.results;
+        }
+
+        e.results = results;
+        e.resolved = true;
+        e.expires = clock_type::now() + m_ttl;
+
+        return results;
+    }
+
+    void async_resolve(const std::string &host, const std::string &port, resolve_cb cb) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        auto &e = get_entry(host, port);
+        if ( e.resolved ) {
+            // the expired endpoints are still used while they are being refreshed
+            if ( !e.in_progress && clock_type::now() >= e.expires ) {
+                start_resolve(e);
+            }
+
+            results_type results = e.results;
+            lock.unlock();
+
+            cb(boost::system::error_code{}, std::move(results));
+
+            return;
+        }
+
+        e.waiters.push_back(std::move(cb));
+        if ( !e.in_progress ) {
+            start_resolve(e);
+        }
+    }
+
+    // must be called under the lock
+    void start_resolve(entry &e) {
+        e.in_progress = true;
+        e.resolver.async_resolve(
+             e.host
+            ,e.port
+            ,[this, &e](const boost::system::error_code &ec, results_type results)
+             { on_resolved(e, ec, std::move(results)); }
+        );
+    }
+    // must be called under the lock. the sync users may not run the io_context at all,
+    // so the entry is refreshed by the blocking lookup on the background thread
+    void start_sync_resolve(entry &e) {
+        e.in_progress = true;
+        if ( !m_refresher.joinable() ) {
+            m_refresher = std::thread{[this]{ m_refresh_ioctx.run(); }};
+        }
+
+        boost::asio::post(
+             m_refresh_ioctx
+            ,[this, &e]() {
+                boost::asio::ip::tcp::resolver resolver{m_refresh_ioctx};
+                boost::system::error_code ec;
+                results_type results = resolver.resolve(e.host, e.port, ec);
+                on_resolved(e, ec, std::move(results));
+            }
+        );
+    }
+    void on_resolved(entry &e, const boost::system::error_code &ec, results_type results) {
+        if ( ec == boost::asio::error::operation_aborted ) {
+            return;
+        }
+
+        std::vector<resolve_cb> waiters;
+        boost::system::error_code waiters_ec = ec;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            e.in_progress = false;
+            if ( !ec ) {
+                e.results = std::move(results);
+                e.resolved = true;
+            }
+            if ( e.resolved ) {
+                // on error the last good endpoints are still in use
+                waiters_ec.clear();
+                e.expires = clock_type::now() + (ec ? m_retry_interval : m_ttl);
+            }
+
+            results = e.results;
+            waiters.swap(e.waiters);
+        }
+
+        for ( auto &it: waiters ) {
+            it(waiters_ec, results);
+        }
+    }
+
+    // the lookup in progress is waited for
+    void stop_refresher() {
+        m_refresh_work.reset();
+        m_refresh_ioctx.stop();
+        if ( m_refresher.joinable() ) {
+            m_refresher.join();
+        }
+    }
+
+    void shutdown() {
+        stop_refresher();
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_entries.clear();
+    }
+
+    boost::asio::io_context &m_ioctx;
+    clock_type::duration m_ttl;
+    const clock_type::duration m_retry_interval;
+    std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<entry>> m_entries;
+    boost::asio::io_context m_refresh_ioctx;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_refresh_work;
+    std::thread m_refresher;
+};
+
+/*************************************************************************************************/
+
+dns_cache::dns_cache(boost::asio::io_context &ioctx)
+    :boost::asio::io_context::service{ioctx}
+    ,pimpl{std::make_unique<impl>(ioctx)}
+{}
+
+dns_cache::~dns_cache()
+{}
+
+void dns_cache::set_ttl(std::size_t seconds) {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    pimpl->m_ttl = std::chrono::seconds{seconds};
+}
+
+dns_cache::results_type
+dns_cache::resolve(const std::string &host, const std::string &port, boost::system::error_code &ec) {
+    return pimpl->resolve(host, port, ec);
+}
+
+void dns_cache::async_resolve_impl(const std::string &host, const std::string &port, resolve_cb cb) {
+    return pimpl->async_resolve(host, port, std::move(cb));
+}
+
+void dns_cache::shutdown() {
+    pimpl->shutdown();
+}
+
+/*************************************************************************************************/
+
+} // ns binapi
@@ -114,7 +114,7 @@ e_trade_resp_type e_trade_resp_type_from_string(const char *str) {
 
 const char* e_trade_resp_type_to_string(e_trade_resp_type resp) {
     switch ( resp ) {
-        case e_trade_resp_type::ACK: return "ASK";
+        case e_trade_resp_type::ACK: return "ACK";
         case e_trade_resp_type::RESULT: return "RESULT";
         case e_trade_resp_type::FULL: return "FULL";
         case e_trade_resp_type::TEST: return "TEST";
@@ -163,4 +163,30 @@ const char* e_permissions_to_string(e_permissions resp) {
 
 /*************************************************************************************************/
 
+e_cancel_replace_mode e_cancel_replace_mode_from_string(const char *str) {
+    const auto hash = fnv1a(str);
+    switch ( hash ) {
+        case fnv1a("STOP_ON_FAILURE"): return e_cancel_replace_mode::STOP_ON_FAILURE;
+        case fnv1a("ALLOW_FAILURE"): return e_cancel_replace_mode::ALLOW_FAILURE;
+    }
+
+    assert(!"unreachable");
+
+    // the default of the exchange
+    return e_cancel_replace_mode::STOP_ON_FAILURE;
+}
+
+const char* e_cancel_replace_mode_to_string(e_cancel_replace_mode mode) {
+    switch ( mode ) {
+        case e_cancel_replace_mode::STOP_ON_FAILURE: return "STOP_ON_FAILURE";
+        case e_cancel_replace_mode::ALLOW_FAILURE: return "ALLOW_FAILURE";
+    }
+
+    assert(!"unreachable");
+
+    return nullptr;
+}
+
+/*************************************************************************************************/
+
 } // ns binapi
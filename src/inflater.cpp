@@ -0,0 +1,186 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/inflater.hpp>
+
+#include <boost/beast/zlib/error.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+namespace {
+
+// the output buffer grows at least by this size
+constexpr std::size_t min_chunk = 16 * 1024;
+
+bool iequals(boost::beast::string_view l, const char *r) {
+    const auto len = std::strlen(r);
+    if ( l.size() != len ) {
+        return false;
+    }
+
+    for ( std::size_t i = 0; i < len; ++i ) {
+        if ( std::tolower(static_cast<unsigned char>(l[i])) != r[i] ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int window_bits(inflater::e_encoding encoding) {
+    // +16 is for the gzip wrapper, the deflate is zlib-wrapped as the RFC requires
+    return encoding == inflater::e_encoding::gzip ? MAX_WBITS + 16 : MAX_WBITS;
+}
+
+boost::system::error_code make_error(int r) {
+    switch ( r ) {
+        case Z_NEED_DICT: return boost::beast::zlib::error::need_dict;
+        case Z_STREAM_ERROR: return boost::beast::zlib::error::stream_error;
+        case Z_MEM_ERROR: return boost::system::errc::make_error_code(boost::system::errc::not_enough_memory);
+        default: return boost::beast::zlib::error::general;
+    }
+}
+
+} // anon ns
+
+/*************************************************************************************************/
+
+struct inflater::impl {
+    impl()
+        :m_zs{}
+        ,m_inited{}
+        ,m_encoding{e_encoding::identity}
+        ,m_raw{}
+        ,m_fed{}
+        ,m_finished{}
+    {}
+    ~impl() {
+        if ( m_inited ) {
+            inflateEnd(&m_zs);
+        }
+    }
+
+    void reset(e_encoding encoding) {
+        m_encoding = encoding;
+        m_raw = false;
+        m_fed = 0;
+        m_finished = false;
+        if ( m_inited ) {
+            inflateReset2(&m_zs, window_bits(encoding));
+        }
+    }
+
+    boost::system::error_code write(const void *ptr, std::size_t size, boost::beast::flat_buffer &dst, std::size_t limit) {
+        if ( !m_inited ) {
+            const int r = inflateInit2(&m_zs, window_bits(m_encoding));
+            if ( r != Z_OK ) {
+                return make_error(r);
+            }
+            m_inited = true;
+        }
+
+        m_zs.next_in = static_cast<Bytef *>(const_cast<void *>(ptr));
+        m_zs.avail_in = static_cast<uInt>(size);
+        // when the output is full there can be more of it even if the input is consumed
+        bool full = false;
+        while ( (m_zs.avail_in || full) && !m_finished ) {
+            // the output is bounded before it's written, so the small input inflated to the huge
+            // output doesn't take the memory
+            if ( dst.size() >= limit ) {
+                return boost::beast::http::error::body_limit;
+            }
+            auto mb = dst.prepare(std::min(limit - dst.size(), std::max<std::size_t>(m_zs.avail_in * 4, min_chunk)));
+            m_zs.next_out = static_cast<Bytef *>(mb.data());
+            m_zs.avail_out = static_cast<uInt>(mb.size());
+
+            const int r = inflate(&m_zs, Z_NO_FLUSH);
+            dst.commit(mb.size() - m_zs.avail_out);
+            full = m_zs.avail_out == 0;
+            if ( r == Z_BUF_ERROR ) {
+                // no progress is possible until the next input
+                break;
+            } else if ( r == Z_STREAM_END ) {
+                m_finished = true;
+            } else if ( r == Z_DATA_ERROR && m_encoding == e_encoding::deflate && !m_raw && !m_fed ) {
+                // some servers send the raw deflate stream, without the zlib wrapper
+                m_raw = true;
+                inflateReset2(&m_zs, -MAX_WBITS);
+                m_zs.next_in = static_cast<Bytef *>(const_cast<void *>(ptr));
+                m_zs.avail_in = static_cast<uInt>(size);
+            } else if ( r != Z_OK ) {
+                return make_error(r);
+            }
+        }
+        m_fed += size;
+
+        return {};
+    }
+
+    z_stream m_zs;
+    bool m_inited;
+    e_encoding m_encoding;
+    bool m_raw;
+    std::size_t m_fed; // by the previous writes of the current stream
+    bool m_finished;
+};
+
+/*************************************************************************************************/
+
+inflater::e_encoding inflater::encoding_of(boost::beast::string_view content_encoding) {
+    if ( content_encoding.empty() || iequals(content_encoding, "identity") ) {
+        return e_encoding::identity;
+    }
+    if ( iequals(content_encoding, "gzip") || iequals(content_encoding, "x-gzip") ) {
+        return e_encoding::gzip;
+    }
+    if ( iequals(content_encoding, "deflate") ) {
+        return e_encoding::deflate;
+    }
+
+    return e_encoding::unsupported;
+}
+
+inflater::inflater()
+    :pimpl{std::make_unique<impl>()}
+{}
+
+inflater::~inflater()
+{}
+
+void inflater::reset(e_encoding encoding) {
+    pimpl->reset(encoding);
+}
+
+inflater::e_encoding inflater::encoding() const {
+    return pimpl->m_encoding;
+}
+
+boost::system::error_code inflater::write(const void *ptr, std::size_t size, boost::beast::flat_buffer &dst, std::size_t limit) {
+    return pimpl->write(ptr, size, dst, limit);
+}
+
+bool inflater::finished() const {
+    return pimpl->m_finished;
+}
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
@@ -0,0 +1,294 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/latency_stats.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+namespace {
+
+void increase(std::atomic<std::uint64_t> &v, std::uint64_t n) {
+    v.fetch_add(n, std::memory_order_relaxed);
+}
+
+void store_min(std::atomic<std::uint64_t> &v, std::uint64_t n) {
+    auto cur = v.load(std::memory_order_relaxed);
+    while ( n < cur && !v.compare_exchange_weak(cur, n, std::memory_order_relaxed) )
+    {}
+}
+
+void store_max(std::atomic<std::uint64_t> &v, std::uint64_t n) {
+    auto cur = v.load(std::memory_order_relaxed);
+    while ( n > cur && !v.compare_exchange_weak(cur, n, std::memory_order_relaxed) )
+    {}
+}
+
+double to_us(std::chrono::nanoseconds v) {
+    return static_cast<double>(v.count()) / 1000.0;
+}
+
+} // anon ns
+
+/*************************************************************************************************/
+
+latency_histogram::latency_histogram()
+    :m_counts{}
+    ,m_count{}
+    ,m_sum{}
+    ,m_min{std::numeric_limits<std::uint64_t>::max()}
+    ,m_max{}
+{}
+
+std::size_t latency_histogram::bucket_of(std::uint64_t v) {
+    if ( v < sub_count ) {
+        return static_cast<std::size_t>(v);
+    }
+
+    const std::size_t e = 63 - static_cast<std::size_t>(__builtin_clzll(v));
+    if ( e >= max_bits ) {
+        return buckets - 1;
+    }
+
+    return (e - sub_bits + 1) * sub_count + static_cast<std::size_t>((v >> (e - sub_bits)) & (sub_count - 1));
+}
+
+std::uint64_t latency_histogram::value_of(std::size_t bucket) {
+    if ( bucket < sub_count * 2 ) {
+        return bucket;
+    }
+
+    const std::size_t e = bucket / sub_count + sub_bits - 1;
+    const std::uint64_t sub = bucket % sub_count;
+    const std::uint64_t low = (sub_count + sub) << (e - sub_bits);
+
+    return low + (std::uint64_t{1} << (e - sub_bits)) / 2;
+}
+
+void latency_histogram::record(std::chrono::nanoseconds v) {
+    const std::uint64_t ns = v.count() > 0 ? static_cast<std::uint64_t>(v.count()) : 0u;
+
+    increase(m_counts[bucket_of(ns)], 1);
+    increase(m_count, 1);
+    increase(m_sum, ns);
+    store_min(m_min, ns);
+    store_max(m_max, ns);
+}
+
+void latency_histogram::reset() {
+    for ( auto &it: m_counts ) {
+        it.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+latency_histogram::snapshot_t latency_histogram::snapshot() const {
+    snapshot_t res{};
+    res.counts.resize(buckets);
+    for ( std::size_t i = 0; i < buckets; ++i ) {
+        res.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        res.count += res.counts[i];
+    }
+    res.sum = std::chrono::nanoseconds{m_sum.load(std::memory_order_relaxed)};
+    res.max = std::chrono::nanoseconds{m_max.load(std::memory_order_relaxed)};
+    const auto min = m_min.load(std::memory_order_relaxed);
+    res.min = std::chrono::nanoseconds{res.count ? std::min(min, static_cast<std::uint64_t>(res.max.count())) : 0u};
+
+    return res;
+}
+
+/*************************************************************************************************/
+
+std::chrono::nanoseconds latency_histogram::snapshot_t::mean() const {
+    return count ? sum / static_cast<std::int64_t>(count) : std::chrono::nanoseconds::zero();
+}
+
+std::chrono::nanoseconds latency_histogram::snapshot_t::percentile(double p) const {
+    if ( !count ) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    p = std::min(std::max(p, 0.0), 100.0);
+    const auto rank = std::max<std::uint64_t>(static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(count) + 0.5), 1);
+    std::uint64_t seen = 0;
+    for ( std::size_t i = 0; i < counts.size(); ++i ) {
+        seen += counts[i];
+        if ( seen >= rank ) {
+            const auto v = std::chrono::nanoseconds{value_of(i)};
+
+            return std::min(std::max(v, min), max);
+        }
+    }
+
+    return max;
+}
+
+std::ostream &operator<<(std::ostream &os, const latency_histogram::snapshot_t &o) {
+    os
+    << "{"
+    << "\"count\":" << o.count << ","
+    << "\"mean_us\":" << to_us(o.mean()) << ","
+    << "\"min_us\":" << to_us(o.min) << ","
+    << "\"p50_us\":" << to_us(o.percentile(50)) << ","
+    << "\"p90_us\":" << to_us(o.percentile(90)) << ","
+    << "\"p99_us\":" << to_us(o.percentile(99)) << ","
+    << "\"p999_us\":" << to_us(o.percentile(99.9)) << ","
+    << "\"max_us\":" << to_us(o.max)
+    << "}";
+
+    return os;
+}
+
+/*************************************************************************************************/
+
+const char* latency_stats::e_stage_to_string(e_stage stage) {
+    switch ( stage ) {
+        case e_stage::queue: return "queue";
+        case e_stage::sign: return "sign";
+        case e_stage::dns: return "dns";
+        case e_stage::connect: return "connect";
+        case e_stage::handshake: return "handshake";
+        case e_stage::write: return "write";
+        case e_stage::first_byte: return "first_byte";
+        case e_stage::read: return "read";
+        case e_stage::parse: return "parse";
+        case e_stage::total: return "total";
+    }
+
+    return "unknown";
+}
+
+latency_stats::endpoint::endpoint(boost::beast::http::verb action, const char *target)
+    :m_action{action}
+    ,m_target{target}
+    ,m_stages{}
+{}
+
+std::ostream &operator<<(std::ostream &os, const latency_stats::endpoint_snapshot_t &o) {
+    os
+    << "{"
+    << "\"method\":\"" << boost::beast::http::to_string(o.action) << "\","
+    << "\"target\":\"" << o.target << "\"";
+    for ( std::size_t i = 0; i < latency_stats::stage_count; ++i ) {
+        if ( !o.stages[i].count ) {
+            continue;
+        }
+
+        os << ",\"" << latency_stats::e_stage_to_string(static_cast<latency_stats::e_stage>(i)) << "\":" << o.stages[i];
+    }
+    os << "}";
+
+    return os;
+}
+
+/*************************************************************************************************/
+
+latency_stats::latency_stats()
+    :m_mutex{}
+    ,m_endpoints{}
+    ,m_aliases{}
+    ,m_index{}
+{}
+
+latency_stats::~latency_stats()
+{}
+
+std::size_t latency_stats::slot_of(boost::beast::http::verb action, const char *target) {
+    const auto h = (reinterpret_cast<std::uintptr_t>(target) >> 3) ^ (static_cast<std::uintptr_t>(action) * 0x9e3779b1u);
+
+    return static_cast<std::size_t>(h) & (index_size - 1);
+}
+
+latency_stats::endpoint* latency_stats::get(boost::beast::http::verb action, const char *target) {
+    for ( std::size_t i = slot_of(action, target), n = 0; n < index_size; i = (i + 1) & (index_size - 1), ++n ) {
+        const alias *a = m_index[i].load(std::memory_order_acquire);
+        if ( !a ) {
+            break;
+        }
+        if ( a->target == target && a->action == action ) {
+            return a->ep;
+        }
+    }
+
+    return find_or_create(action, target);
+}
+
+latency_stats::endpoint* latency_stats::find_or_create(boost::beast::http::verb action, const char *target) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    endpoint *ep = nullptr;
+    for ( const auto &it: m_endpoints ) {
+        if ( it->m_action == action && std::strcmp(it->m_target.c_str(), target) == 0 ) {
+            ep = it.get();
+            break;
+        }
+    }
+    if ( !ep ) {
+        m_endpoints.push_back(std::make_unique<endpoint>(action, target));
+        ep = m_endpoints.back().get();
+    }
+
+    // when the index is full the address is looked up by the value each time
+    if ( m_aliases.size() >= index_size / 2 ) {
+        return ep;
+    }
+
+    std::size_t i = slot_of(action, target);
+    for ( ; const alias *a = m_index[i].load(std::memory_order_relaxed); i = (i + 1) & (index_size - 1) ) {
+        // added by the concurrent call
+        if ( a->target == target && a->action == action ) {
+            return ep;
+        }
+    }
+    m_aliases.push_back(std::make_unique<alias>(alias{target, action, ep}));
+    m_index[i].store(m_aliases.back().get(), std::memory_order_release);
+
+    return ep;
+}
+
+std::vector<latency_stats::endpoint_snapshot_t> latency_stats::snapshot() const {
+    std::vector<endpoint_snapshot_t> res;
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    res.reserve(m_endpoints.size());
+    for ( const auto &it: m_endpoints ) {
+        endpoint_snapshot_t s{it->m_action, it->m_target, {}};
+        for ( std::size_t i = 0; i < stage_count; ++i ) {
+            s.stages[i] = it->m_stages[i].snapshot();
+        }
+        res.push_back(std::move(s));
+    }
+
+    return res;
+}
+
+void latency_stats::reset() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for ( const auto &it: m_endpoints ) {
+        for ( auto &h: it->m_stages ) {
+            h.reset();
+        }
+    }
+}
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
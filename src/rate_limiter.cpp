@@ -0,0 +1,284 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/rate_limiter.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <cctype>
+#include <cstdint>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+namespace {
+
+enum class e_kind { weight, orders, raw_requests };
+
+const char* kind_to_string(e_kind kind) {
+    switch ( kind ) {
+        case e_kind::weight: return "REQUEST_WEIGHT";
+        case e_kind::orders: return "ORDERS";
+        case e_kind::raw_requests: return "RAW_REQUESTS";
+    }
+
+    return "UNKNOWN";
+}
+
+bool kind_from_string(e_kind &kind, const std::string &str) {
+    if ( str == "REQUEST_WEIGHT" ) { kind = e_kind::weight; return true; }
+    if ( str == "ORDERS" ) { kind = e_kind::orders; return true; }
+    if ( str == "RAW_REQUESTS" ) { kind = e_kind::raw_requests; return true; }
+
+    return false;
+}
+
+std::uint64_t interval_from_string(const std::string &str) {
+    if ( str == "SECOND" ) return 1;
+    if ( str == "MINUTE" ) return 60;
+    if ( str == "HOUR" ) return 60 * 60;
+    if ( str == "DAY" ) return 24 * 60 * 60;
+
+    return 0;
+}
+
+bool istarts_with(boost::string_view str, boost::string_view prefix) {
+    if ( str.size() < prefix.size() ) {
+        return false;
+    }
+
+    return std::equal(prefix.begin(), prefix.end(), str.begin(), [](char l, char r) {
+        return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+    });
+}
+
+// '1m', '10s', '1d' ...
+std::uint64_t interval_from_suffix(boost::string_view str) {
+    std::uint64_t num{};
+    auto res = std::from_chars(str.data(), str.data() + str.size(), num);
+    if ( res.ec != std::errc{} || res.ptr + 1 != str.data() + str.size() ) {
+        return 0;
+    }
+
+    switch ( std::tolower(static_cast<unsigned char>(*res.ptr)) ) {
+        case 's': return num;
+        case 'm': return num * 60;
+        case 'h': return num * 60 * 60;
+        case 'd': return num * 24 * 60 * 60;
+    }
+
+    return 0;
+}
+
+// the windows are aligned to the epoch, the same way the server does
+std::uint64_t now_ms() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count());
+}
+
+} // anon ns
+
+/*************************************************************************************************/
+
+struct rate_limiter::impl {
+    struct window {
+        e_kind kind;
+        std::uint64_t interval; // seconds
+        std::size_t limit;
+        std::size_t used;
+        std::uint64_t id;
+
+        void roll(std::uint64_t now) {
+            const std::uint64_t current = now / (interval * 1000);
+            if ( current != id ) {
+                id = current;
+                used = 0;
+            }
+        }
+        std::uint64_t ends_at() const { return (id + 1) * interval * 1000; }
+    };
+
+    impl()
+        :m_mutex{}
+        ,m_policy{e_policy::delay}
+        ,m_windows{
+             {e_kind::weight, 60, 6000, 0, 0}
+            ,{e_kind::orders, 10, 100, 0, 0}
+            ,{e_kind::orders, 24 * 60 * 60, 200000, 0, 0}
+            ,{e_kind::raw_requests, 5 * 60, 61000, 0, 0}
+        }
+        ,m_banned_until{}
+    {}
+
+    static std::size_t amount(const window &w, const cost_t &cost) {
+        switch ( w.kind ) {
+            case e_kind::weight: return cost.weight;
+            case e_kind::orders: return cost.orders;
+            case e_kind::raw_requests: return 1;
+        }
+
+        return 0;
+    }
+
+    std::chrono::steady_clock::duration acquire(const cost_t &cost, bool *orders_limit) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        const auto steady_now = std::chrono::steady_clock::now();
+        if ( steady_now < m_banned_until ) {
+            return m_banned_until - steady_now;
+        }
+
+        const auto now = now_ms();
+        std::uint64_t wait_until = 0;
+        for ( auto &it: m_windows ) {
+            it.roll(now);
+            const auto n = amount(it, cost);
+            // the request that is larger than the limit is sent into the empty window
+            if ( n && it.used && it.used + n > it.limit && it.ends_at() > wait_until ) {
+                wait_until = it.ends_at();
+                if ( orders_limit ) {
+                    *orders_limit = (it.kind == e_kind::orders);
+                }
+            }
+        }
+        if ( wait_until ) {
+            return std::chrono::milliseconds{wait_until - now};
+        }
+
+        for ( auto &it: m_windows ) {
+            it.used += amount(it, cost);
+        }
+
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    void on_header(boost::string_view name, boost::string_view value) {
+        static const boost::string_view weight_prefix = "x-mbx-used-weight-";
+        static const boost::string_view orders_prefix = "x-mbx-order-count-";
+
+        e_kind kind{};
+        boost::string_view suffix;
+        if ( istarts_with(name, weight_prefix) ) {
+            kind = e_kind::weight;
+            suffix = name.substr(weight_prefix.size());
+        } else if ( istarts_with(name, orders_prefix) ) {
+            kind = e_kind::orders;
+            suffix = name.substr(orders_prefix.size());
+        } else {
+            return;
+        }
+
+        const auto interval = interval_from_suffix(suffix);
+        std::size_t used{};
+        auto res = std::from_chars(value.data(), value.data() + value.size(), used);
+        if ( !interval || res.ec != std::errc{} ) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const auto now = now_ms();
+        for ( auto &it: m_windows ) {
+            if ( it.kind == kind && it.interval == interval ) {
+                it.roll(now);
+                // the requests still in flight are not counted by the server yet
+                it.used = std::max(it.used, used);
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    e_policy m_policy;
+    std::vector<window> m_windows;
+    std::chrono::steady_clock::time_point m_banned_until;
+};
+
+/*************************************************************************************************/
+
+rate_limiter::rate_limiter()
+    :pimpl{std::make_unique<impl>()}
+{}
+
+rate_limiter::~rate_limiter()
+{}
+
+void rate_limiter::set_policy(e_policy policy) {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    pimpl->m_policy = policy;
+}
+
+rate_limiter::e_policy rate_limiter::get_policy() const {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    return pimpl->m_policy;
+}
+
+void rate_limiter::set_limits(const std::vector<exchange_info_t::rate_limit_t> &limits) {
+    std::vector<impl::window> windows;
+    for ( const auto &it: limits ) {
+        e_kind kind{};
+        const auto interval = interval_from_string(it.interval) * std::max<std::size_t>(it.intervalNum, 1);
+        if ( kind_from_string(kind, it.rateLimitType) && interval ) {
+            windows.push_back({kind, interval, it.limit, 0, 0});
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    // the usage of the already known windows is kept
+    for ( auto &it: windows ) {
+        for ( const auto &old: pimpl->m_windows ) {
+            if ( old.kind == it.kind && old.interval == it.interval ) {
+                it.used = old.used;
+                it.id = old.id;
+            }
+        }
+    }
+    pimpl->m_windows = std::move(windows);
+}
+
+std::vector<rate_limiter::headroom_t> rate_limiter::headroom() const {
+    std::vector<headroom_t> res;
+
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    const auto now = now_ms();
+    for ( auto &it: pimpl->m_windows ) {
+        it.roll(now);
+        res.push_back({
+             kind_to_string(it.kind)
+            ,std::chrono::seconds{it.interval}
+            ,it.limit
+            ,it.used
+            ,it.used < it.limit ? it.limit - it.used : 0
+        });
+    }
+
+    return res;
+}
+
+std::chrono::steady_clock::duration rate_limiter::acquire(const cost_t &cost, bool *orders_limit) {
+    return pimpl->acquire(cost, orders_limit);
+}
+
+void rate_limiter::on_header(boost::string_view name, boost::string_view value) {
+    pimpl->on_header(name, value);
+}
+
+void rate_limiter::on_ban(std::chrono::seconds retry_after) {
+    std::lock_guard<std::mutex> lock{pimpl->m_mutex};
+    pimpl->m_banned_until = std::max(pimpl->m_banned_until, std::chrono::steady_clock::now() + retry_after);
+}
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
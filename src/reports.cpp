@@ -11,6 +11,7 @@
 
 #include <binapi/reports.hpp>
 #include <binapi/api.hpp>
+#include <binapi/batch.hpp>
 #include <binapi/tools.hpp>
 #include <binapi/pairslist.hpp>
 #include <binapi/iofmt.hpp>
@@ -19,11 +20,22 @@
 #include <boost/format.hpp>
 
 #include <iostream> // TODO: comment out
+#include <stdexcept>
 
 namespace binapi {
 
 /*************************************************************************************************/
 
+// the failed request fails the report
+template<typename T>
+static void check_result(const rest::api::result<T> &res) {
+    if ( !res ) {
+        throw std::runtime_error(res.errmsg);
+    }
+}
+
+/*************************************************************************************************/
+
 std::uint64_t mstime_from_str(const std::string &strtime) {
     std::istringstream is(strtime);
     std::tm tm{};
@@ -129,10 +141,21 @@ std::vector<cycle_pair> get_full_cycle_trades(
     ,const trade_info_container_t &trades
     ,const std::function<void(const rest::order_info_t &)> &tick)
 {
-    std::vector<cycle_pair> res;
-    for ( auto &oit: trades ) {
-        auto sell_order_info = api.order_info(oit.symbol, oit.orderId);
-        assert(sell_order_info);
+    // the SELL orders
+    rest::batch<rest::order_info_t> sells{api};
+    for ( const auto &oit: trades ) {
+        sells.add([&oit](rest::api &api, auto cb) {
+            return api.order_info(oit.symbol, oit.orderId, std::string{}, std::move(cb));
+        });
+    }
+    auto sell_infos = sells.join();
+
+    // the BUY orders for them
+    std::vector<std::size_t> cycle_sells;
+    rest::batch<rest::order_info_t> buys{api};
+    for ( std::size_t idx = 0; idx < sell_infos.size(); ++idx ) {
+        const auto &sell_order_info = sell_infos[idx];
+        check_result(sell_order_info);
 
         if ( tick ) { tick(sell_order_info.v); }
         if ( sell_order_info.v.clientOrderId.empty() ) { continue; }
@@ -143,13 +166,24 @@ std::vector<cycle_pair> get_full_cycle_trades(
 
         std::size_t buy_order_id = std::strtoul(buy_order_id_ptr+1, nullptr, 10);
 
-        auto buy_order_info = api.order_info(oit.symbol, buy_order_id);
-        assert(buy_order_info);
+        const auto &symbol = trades[idx].symbol;
+        buys.add([&symbol, buy_order_id](rest::api &api, auto cb) {
+            return api.order_info(symbol, buy_order_id, std::string{}, std::move(cb));
+        });
+        cycle_sells.push_back(idx);
+    }
+    auto buy_infos = buys.join();
+
+    std::vector<cycle_pair> res;
+    for ( std::size_t idx = 0; idx < buy_infos.size(); ++idx ) {
+        auto &sell_order_info = sell_infos[cycle_sells[idx]];
+        auto &buy_order_info = buy_infos[idx];
+        check_result(buy_order_info);
 
         if ( tick ) { tick(buy_order_info.v); }
 
         std::cout
-        << (boost::format("%-10s: ") % oit.symbol)
+        << (boost::format("%-10s: ") % trades[cycle_sells[idx]].symbol)
         << "B:" << buy_order_info.v.orderId
         << " -> S:" << sell_order_info.v.orderId
         << " C:" << sell_order_info.v.clientOrderId
@@ -225,14 +259,24 @@ void make_trades_report(
     ;
 
     auto prices = api.prices();
-    assert(prices);
+    check_result(prices);
 
     std::map<std::string, pair_trades> buy_sell_pairs;
     auto mpairs = get_pairs_for_pairs(accinfo, exinfo, pairs);
     std::sort(mpairs.begin(), mpairs.end());
+
+    rest::batch<rest::my_trades_info_t> trades_batch{api};
     for ( const auto &pair: mpairs ) {
-        auto r_trades = api.my_trades(pair, mtime_from, 0, 0, 1000);
-        assert(r_trades);
+        trades_batch.add([&pair, mtime_from](rest::api &api, auto cb) {
+            return api.my_trades(pair, mtime_from, 0, 0, 1000, std::move(cb));
+        });
+    }
+    auto all_trades = trades_batch.join();
+
+    for ( std::size_t idx = 0; idx < mpairs.size(); ++idx ) {
+        const auto &pair = mpairs[idx];
+        auto &r_trades = all_trades[idx];
+        check_result(r_trades);
 
         if ( r_trades.v.trades.empty() ) { continue; }
 
@@ -375,24 +419,36 @@ rest::orders_info_t get_open_orders(
     binapi::rest::orders_info_t orders;
     if ( pairs.empty() ) {
         auto req = api.open_orders(nullptr);
-        assert(req);
+        check_result(req);
         orders = std::move(req.v);
     } else {
+        std::vector<std::string> symbols;
         for ( const auto &it: pairs ) {
             auto tmp = binapi::process_pairs(it, "", exinfo);
-            for ( const auto &pit: tmp ) {
-                if ( tick ) { tick(pit); }
-
-                auto req = api.open_orders(pit);
-                assert(req);
-                if ( req.v.orders.empty() ) { continue; }
+            symbols.insert(symbols.end(), tmp.begin(), tmp.end());
+        }
 
-                for ( auto &oit: req.v.orders ) {
-                    auto &vec = orders.orders[oit.first];
-                    vec.insert(vec.end(), oit.second.begin(), oit.second.end());
-                }
-            }
+        rest::batch<rest::orders_info_t> batch{api};
+        for ( const auto &it: symbols ) {
+            batch.add([&it](rest::api &api, auto cb) {
+                return api.open_orders(it, std::move(cb));
+            });
         }
+        // the callback is called by the io_context, so the failure is thrown after all
+        rest::api::result<rest::orders_info_t> failed;
+        batch.stream([&](std::size_t idx, rest::api::result<rest::orders_info_t> &req) {
+            if ( tick ) { tick(symbols[idx]); }
+
+            if ( !req ) {
+                if ( failed ) { failed = std::move(req); }
+                return;
+            }
+            for ( auto &oit: req.v.orders ) {
+                auto &vec = orders.orders[oit.first];
+                vec.insert(vec.end(), oit.second.begin(), oit.second.end());
+            }
+        });
+        check_result(failed);
     }
 
     if ( side ) {
@@ -562,7 +618,7 @@ void show_exchanger_price_for_orders(
 {
     rest::orders_info_t orders = get_open_orders(api, exinfo, pairs, tick, "SELL");
     auto r_prices = api.prices();
-    assert(r_prices);
+    check_result(r_prices);
     rest::prices_t prices = std::move(r_prices.v);
 
     struct out_item {
@@ -627,7 +683,7 @@ void calc_loss_for_orders(
 {
     rest::orders_info_t orders = get_open_orders(api, exinfo, pairs, tick, "SELL");
     auto r_prices = api.prices();
-    assert(r_prices);
+    check_result(r_prices);
     rest::prices_t prices = std::move(r_prices.v);
 
     struct out_item {
@@ -0,0 +1,145 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/request.hpp>
+#include <binapi/signer.hpp>
+
+#include <charconv>
+#include <cstring>
+
+namespace binapi {
+namespace rest {
+
+/*************************************************************************************************/
+
+request_builder::request_builder(
+     const std::string &host
+    ,const std::string &pk
+    ,const std::string &user_agent
+    ,const signer &signer
+    ,std::size_t recv_window
+)
+    :m_signer{signer}
+    ,m_recv_window{recv_window}
+    ,m_headers{}
+{
+    m_headers += "X-MBX-APIKEY: ";
+    m_headers += pk;
+    m_headers += "\r\nHost: ";
+    m_headers += host;
+    m_headers += "\r\nUser-Agent: ";
+    m_headers += user_agent;
+    m_headers += "\r\nContent-Type: application/x-www-form-urlencoded\r\n";
+}
+
+void request_builder::append_number(std::string &dst, std::uint64_t v) {
+    char buf[24];
+    auto res = std::to_chars(std::begin(buf), std::end(buf), v);
+
+    dst.append(buf, res.ptr);
+}
+
+void request_builder::append_query(std::string &dst, query_params params) {
+    append_query(dst, params.begin(), params.end());
+}
+
+void request_builder::append_query(std::string &dst, const query_param *first, const query_param *last) {
+    for ( ; first != last; ++first ) {
+        const auto &it = *first;
+        if ( !it.is_valid() ) {
+            continue;
+        }
+
+        if ( !dst.empty() ) {
+            dst += '&';
+        }
+        dst += it.key;
+        dst += '=';
+        if ( it.kind == query_param::kind_type::string ) {
+            dst += it.str;
+        } else {
+            append_number(dst, it.num);
+        }
+    }
+}
+
+void request_builder::build(
+     std::string &wire
+    ,std::string &query
+    ,bool _signed
+    ,std::uint64_t timestamp
+    ,const char *target
+    ,boost::beast::http::verb action
+    ,query_params params
+    ,bool compressed
+) const {
+    query.clear();
+    append_query(query, params);
+
+    build_prepared(wire, query, _signed, timestamp, target, action, compressed);
+}
+
+void request_builder::build_prepared(
+     std::string &wire
+    ,std::string &query
+    ,bool _signed
+    ,std::uint64_t timestamp
+    ,const char *target
+    ,boost::beast::http::verb action
+    ,bool compressed
+) const {
+    if ( _signed ) {
+        if ( !query.empty() ) {
+            query += '&';
+        }
+        query += "timestamp=";
+        append_number(query, timestamp);
+        query += "&recvWindow=";
+        append_number(query, m_recv_window);
+
+        m_signer.sign_append(query, "&signature=");
+    }
+
+    const bool in_target =
+        action == boost::beast::http::verb::get ||
+        action == boost::beast::http::verb::delete_
+    ;
+
+    const auto method = boost::beast::http::to_string(action);
+
+    wire.clear();
+    wire.append(method.data(), method.size());
+    wire += ' ';
+    wire += target;
+    if ( in_target && !query.empty() ) {
+        wire += '?';
+        wire += query;
+    }
+    wire += " HTTP/1.1\r\n";
+    wire += m_headers;
+    if ( compressed ) {
+        wire += "Accept-Encoding: gzip, deflate\r\n";
+    }
+    if ( action != boost::beast::http::verb::get ) {
+        wire += "Content-Length: ";
+        append_number(wire, in_target ? 0u : query.size());
+        wire += "\r\n";
+    }
+    wire += "\r\n";
+    if ( !in_target ) {
+        wire += query;
+    }
+}
+
+/*************************************************************************************************/
+
+} // ns rest
+} // ns binapi
@@ -0,0 +1,361 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/signer.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/bio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+namespace {
+
+enum: std::size_t { sha256_block_size = 64 };
+
+struct md_ctx_holder {
+    md_ctx_holder()
+        :ctx{::EVP_MD_CTX_new()}
+    {
+        if ( !ctx ) {
+            throw std::runtime_error("EVP_MD_CTX_new() failed");
+        }
+    }
+    ~md_ctx_holder() {
+        ::EVP_MD_CTX_free(ctx);
+    }
+
+    md_ctx_holder(const md_ctx_holder &) = delete;
+    md_ctx_holder& operator= (const md_ctx_holder &) = delete;
+
+    EVP_MD_CTX *ctx;
+};
+
+// the working context, reused by all the signers on the thread
+EVP_MD_CTX* work_ctx() {
+    static thread_local md_ctx_holder holder;
+
+    return holder.ctx;
+}
+
+struct pkey_holder {
+    pkey_holder(const std::string &pem, const std::string &password, int type)
+        :pkey{}
+    {
+        BIO *bio = ::BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+        if ( !bio ) {
+            throw std::runtime_error("BIO_new_mem_buf() failed");
+        }
+        pkey = ::PEM_read_bio_PrivateKey(
+             bio
+            ,nullptr
+            ,nullptr
+            ,password.empty() ? nullptr : const_cast<char *>(password.c_str())
+        );
+        ::BIO_free(bio);
+        if ( !pkey ) {
+            throw std::runtime_error("can't read the PEM private key");
+        }
+        if ( ::EVP_PKEY_id(pkey) != type ) {
+            ::EVP_PKEY_free(pkey);
+            throw std::runtime_error("unexpected type of the private key");
+        }
+    }
+    ~pkey_holder() {
+        ::EVP_PKEY_free(pkey);
+    }
+
+    pkey_holder(const pkey_holder &) = delete;
+    pkey_holder& operator= (const pkey_holder &) = delete;
+
+    EVP_PKEY *pkey;
+};
+
+// the signing context initialized with the key once, to be cloned for each signature.
+// if the provider can't clone it, the working context is initialized for each signature.
+struct sign_state {
+    sign_state(const std::string &pem, const std::string &password, int type, const EVP_MD *md)
+        :m_key{pem, password, type}
+        ,m_md{md}
+        ,m_proto{}
+        ,m_cloneable{}
+    {
+        if ( !::EVP_DigestSignInit(m_proto.ctx, nullptr, m_md, nullptr, m_key.pkey) ) {
+            throw std::runtime_error("EVP_DigestSignInit() failed");
+        }
+
+        md_ctx_holder probe;
+        m_cloneable = ::EVP_MD_CTX_copy_ex(probe.ctx, m_proto.ctx) == 1;
+    }
+
+    // returns the context ready for the signing
+    EVP_MD_CTX* get() const {
+        EVP_MD_CTX *ctx = work_ctx();
+        const bool ok = m_cloneable
+            ? ::EVP_MD_CTX_copy_ex(ctx, m_proto.ctx) == 1
+            : (::EVP_MD_CTX_reset(ctx) == 1 && ::EVP_DigestSignInit(ctx, nullptr, m_md, nullptr, m_key.pkey) == 1)
+        ;
+        if ( !ok ) {
+            throw std::runtime_error("can't init the signing context");
+        }
+
+        return ctx;
+    }
+
+    std::size_t size() const { return static_cast<std::size_t>(::EVP_PKEY_size(m_key.pkey)); }
+
+    pkey_holder m_key;
+    const EVP_MD *m_md;
+    md_ctx_holder m_proto;
+    bool m_cloneable;
+};
+
+constexpr std::size_t base64_size(std::size_t size) {
+    return (size + 2) / 3 * 4;
+}
+
+std::size_t to_base64(char *dst, const std::uint8_t *src, std::size_t size) {
+    // writes the terminating null too
+    char buf[base64_size(EVP_MAX_MD_SIZE * 16) + 1];
+    assert(base64_size(size) < sizeof(buf));
+
+    const int len = ::EVP_EncodeBlock(reinterpret_cast<std::uint8_t *>(buf), src, static_cast<int>(size));
+    std::memcpy(dst, buf, static_cast<std::size_t>(len));
+
+    return static_cast<std::size_t>(len);
+}
+
+} // anon ns
+
+/*************************************************************************************************/
+
+struct hmac_sha256_signer::impl {
+    explicit impl(const std::string &key)
+        :m_inner{}
+        ,m_outer{}
+    {
+        std::uint8_t block[sha256_block_size]{};
+        if ( key.size() > sha256_block_size ) {
+            // RFC 2104: the longer keys are hashed first
+            unsigned int len{};
+            if ( !::EVP_Digest(key.data(), key.size(), block, &len, ::EVP_sha256(), nullptr) ) {
+                throw std::runtime_error("EVP_Digest() failed");
+            }
+        } else {
+            std::memcpy(block, key.data(), key.size());
+        }
+
+        init_state(m_inner.ctx, block, 0x36);
+        init_state(m_outer.ctx, block, 0x5c);
+
+        OPENSSL_cleanse(block, sizeof(block));
+    }
+
+    static void init_state(EVP_MD_CTX *ctx, const std::uint8_t *key, std::uint8_t pad) {
+        std::uint8_t block[sha256_block_size];
+        for ( std::size_t i = 0; i < sizeof(block); ++i ) {
+            block[i] = key[i] ^ pad;
+        }
+
+        bool ok = ::EVP_DigestInit_ex(ctx, ::EVP_sha256(), nullptr)
+            && ::EVP_DigestUpdate(ctx, block, sizeof(block))
+        ;
+        OPENSSL_cleanse(block, sizeof(block));
+        if ( !ok ) {
+            throw std::runtime_error("can't init the HMAC state");
+        }
+    }
+
+    std::size_t sign(char *dst, const char *data, std::size_t dlen) const {
+        static const char hex[] = "0123456789abcdef";
+
+        EVP_MD_CTX *ctx = work_ctx();
+        std::uint8_t digest[EVP_MAX_MD_SIZE];
+        unsigned int len{};
+
+        bool ok = ::EVP_MD_CTX_copy_ex(ctx, m_inner.ctx)
+            && ::EVP_DigestUpdate(ctx, data, dlen)
+            && ::EVP_DigestFinal_ex(ctx, digest, &len)
+            && ::EVP_MD_CTX_copy_ex(ctx, m_outer.ctx)
+            && ::EVP_DigestUpdate(ctx, digest, len)
+            && ::EVP_DigestFinal_ex(ctx, digest, &len)
+        ;
+        if ( !ok ) {
+            throw std::runtime_error("can't calculate the HMAC");
+        }
+        assert(len == digest_size);
+
+        for ( std::size_t i = 0; i < digest_size; ++i ) {
+            const std::uint8_t v = digest[i];
+            *dst++ = hex[(v >> 4) & 0x0F];
+            *dst++ = hex[v & 0x0F];
+        }
+
+        return hex_size;
+    }
+
+    md_ctx_holder m_inner;
+    md_ctx_holder m_outer;
+};
+
+/*************************************************************************************************/
+
+hmac_sha256_signer::hmac_sha256_signer(const std::string &key)
+    :pimpl{std::make_unique<impl>(key)}
+{}
+
+hmac_sha256_signer::~hmac_sha256_signer()
+{}
+
+std::size_t hmac_sha256_signer::sign(char *dst, const char *data, std::size_t dlen) const {
+    return pimpl->sign(dst, data, dlen);
+}
+
+/*************************************************************************************************/
+
+struct rsa_sha256_signer::impl {
+    impl(const std::string &pem, const std::string &password)
+        :m_state{pem, password, EVP_PKEY_RSA, ::EVP_sha256()}
+        ,m_size{m_state.size()}
+    {}
+
+    std::size_t sign(char *dst, const char *data, std::size_t dlen) const {
+        std::uint8_t sig[EVP_MAX_MD_SIZE * 16]; // up to RSA-8192
+        std::size_t len = sizeof(sig);
+        assert(m_size <= len);
+
+        EVP_MD_CTX *ctx = m_state.get();
+        bool ok = ::EVP_DigestSignUpdate(ctx, data, dlen)
+            && ::EVP_DigestSignFinal(ctx, sig, &len)
+        ;
+        if ( !ok ) {
+            throw std::runtime_error("can't calculate the RSA signature");
+        }
+
+        return to_base64(dst, sig, len);
+    }
+
+    sign_state m_state;
+    const std::size_t m_size;
+};
+
+/*************************************************************************************************/
+
+rsa_sha256_signer::rsa_sha256_signer(const std::string &pem, const std::string &password)
+    :pimpl{std::make_unique<impl>(pem, password)}
+{}
+
+rsa_sha256_signer::~rsa_sha256_signer()
+{}
+
+std::size_t rsa_sha256_signer::max_size() const {
+    return base64_size(pimpl->m_size);
+}
+
+std::size_t rsa_sha256_signer::sign(char *dst, const char *data, std::size_t dlen) const {
+    return pimpl->sign(dst, data, dlen);
+}
+
+/*************************************************************************************************/
+
+struct ed25519_signer::impl {
+    impl(const std::string &pem, const std::string &password)
+        // the message is signed as a whole, without the digest
+        :m_state{pem, password, EVP_PKEY_ED25519, nullptr}
+    {}
+
+    std::size_t sign(char *dst, const char *data, std::size_t dlen) const {
+        std::uint8_t sig[signature_size];
+        std::size_t len = sizeof(sig);
+
+        EVP_MD_CTX *ctx = m_state.get();
+        if ( !::EVP_DigestSign(ctx, sig, &len, reinterpret_cast<const std::uint8_t *>(data), dlen) ) {
+            throw std::runtime_error("can't calculate the Ed25519 signature");
+        }
+
+        return to_base64(dst, sig, len);
+    }
+
+    sign_state m_state;
+};
+
+/*************************************************************************************************/
+
+ed25519_signer::ed25519_signer(const std::string &pem, const std::string &password)
+    :pimpl{std::make_unique<impl>(pem, password)}
+{}
+
+ed25519_signer::~ed25519_signer()
+{}
+
+std::size_t ed25519_signer::sign(char *dst, const char *data, std::size_t dlen) const {
+    return pimpl->sign(dst, data, dlen);
+}
+
+/*************************************************************************************************/
+
+void signer::sign(std::string &dst, const char *data, std::size_t dlen) const {
+    const auto pos = dst.size();
+    dst.resize(pos + max_size());
+    const auto len = sign(&dst[pos], data, dlen);
+    dst.resize(pos + len);
+}
+
+void signer::sign_append(std::string &data, const char *sep) const {
+    const auto dlen = data.size();
+    const auto slen = std::strlen(sep);
+    data.resize(dlen + slen + max_size());
+    std::memcpy(&data[dlen], sep, slen);
+    const auto len = sign(&data[dlen + slen], data.data(), dlen);
+
+    // the '+', '/' and '=' of base64 are percent-encoded in place, from the end
+    const char *first = &data[dlen + slen];
+    const char *last = first + len;
+    const std::size_t specials = std::count_if(first, last, [](char c) { return c == '+' || c == '/' || c == '='; });
+    data.resize(dlen + slen + len + specials * 2);
+
+    char *src = &data[dlen + slen + len];
+    char *dst = &data[data.size()];
+    for ( char *begin = &data[dlen + slen]; src != begin; ) {
+        const char c = *--src;
+        switch ( c ) {
+            case '+': *--dst = 'B'; *--dst = '2'; *--dst = '%'; break;
+            case '/': *--dst = 'F'; *--dst = '2'; *--dst = '%'; break;
+            case '=': *--dst = 'D'; *--dst = '3'; *--dst = '%'; break;
+            default: *--dst = c;
+        }
+    }
+}
+
+/*************************************************************************************************/
+
+std::string read_key_file(const std::string &fname) {
+    std::ifstream file{fname, std::ios::binary};
+    if ( !file ) {
+        throw std::runtime_error("can't open the key file \"" + fname + "\"");
+    }
+
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+/*************************************************************************************************/
+
+} // ns binapi
@@ -0,0 +1,143 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/tls_context.hpp>
+
+#include <boost/asio/ssl/error.hpp>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <map>
+#include <mutex>
+#include <atomic>
+
+namespace binapi {
+
+/*************************************************************************************************/
+
+boost::asio::io_context::id tls_context::id;
+
+struct tls_context::impl {
+    impl()
+        :m_ctx{boost::asio::ssl::context::sslv23_client}
+        ,m_mutex{}
+        ,m_sessions{}
+        ,m_full_handshakes{}
+        ,m_resumed_handshakes{}
+    {
+        auto *ctx = m_ctx.native_handle();
+        SSL_CTX_set_app_data(ctx, this);
+        // the sessions are stored by us, because the client side internal store is not used by OpenSSL anyway
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT|SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, &impl::on_new_session);
+    }
+    ~impl() {
+        clear();
+    }
+
+    // with TLS1.3 the tickets arrive after the handshake, so they are taken from this callback
+    static int on_new_session(SSL *ssl, SSL_SESSION *session) {
+        auto *self = static_cast<impl *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+        const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+        if ( !self || !host ) {
+            return 0;
+        }
+
+        // a copy is stored, because OpenSSL marks the session of the connection closed
+        // without the TLS shutdown as not resumable
+        SSL_SESSION *copy = SSL_SESSION_dup(session);
+        if ( !copy ) {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock{self->m_mutex};
+        auto &ptr = self->m_sessions[host];
+        if ( ptr ) {
+            SSL_SESSION_free(ptr);
+        }
+        ptr = copy;
+
+        return 0;
+    }
+
+    boost::system::error_code prepare(SSL *ssl, const std::string &host) {
+        if ( !SSL_set_tlsext_host_name(ssl, host.c_str()) ) {
+            return boost::system::error_code{static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()};
+        }
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto it = m_sessions.find(host);
+        if ( it != m_sessions.end() ) {
+            SSL_set_session(ssl, it->second);
+        }
+
+        return boost::system::error_code{};
+    }
+
+    void handshake_completed(SSL *ssl) {
+        if ( SSL_session_reused(ssl) ) {
+            ++m_resumed_handshakes;
+        } else {
+            ++m_full_handshakes;
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for ( auto &it: m_sessions ) {
+            SSL_SESSION_free(it.second);
+        }
+        m_sessions.clear();
+    }
+
+    boost::asio::ssl::context m_ctx;
+    std::mutex m_mutex;
+    std::map<std::string, SSL_SESSION *> m_sessions;
+    std::atomic<std::size_t> m_full_handshakes;
+    std::atomic<std::size_t> m_resumed_handshakes;
+};
+
+/*************************************************************************************************/
+
+tls_context::tls_context(boost::asio::io_context &ioctx)
+    :boost::asio::io_context::service{ioctx}
+    ,pimpl{std::make_unique<impl>()}
+{}
+
+tls_context::~tls_context()
+{}
+
+boost::asio::ssl::context& tls_context::context() {
+    return pimpl->m_ctx;
+}
+
+boost::system::error_code tls_context::prepare(SSL *ssl, const std::string &host) {
+    return pimpl->prepare(ssl, host);
+}
+
+void tls_context::handshake_completed(SSL *ssl) {
+    return pimpl->handshake_completed(ssl);
+}
+
+tls_context::stat_t tls_context::get_stat() const {
+    return {pimpl->m_full_handshakes.load(), pimpl->m_resumed_handshakes.load()};
+}
+
+void tls_context::shutdown() {
+    // the SSL objects may outlive the service
+    SSL_CTX_set_app_data(pimpl->m_ctx.native_handle(), nullptr);
+    pimpl->clear();
+}
+
+/*************************************************************************************************/
+
+} // ns binapi
@@ -386,6 +386,7 @@ std::ostream& operator<<(std::ostream &os, const exchange_info_t::rate_limit_t &
     << "{"
     << "\"rateLimitType\":\"" << o.rateLimitType << "\","
     << "\"interval\":\"" << o.interval << "\","
+    << "\"intervalNum\":" << o.intervalNum << ","
     << "\"limit\":" << o.limit
     << "}";
 
@@ -611,6 +612,7 @@ exchange_info_t exchange_info_t::construct(const flatjson::fjson &json) {
         const auto it = limits.at(idx);
         __BINAPI_GET2(item, rateLimitType, it);
         __BINAPI_GET2(item, interval, it);
+        __BINAPI_GET2(item, intervalNum, it);
         __BINAPI_GET2(item, limit, it);
 
         res.rateLimits.push_back(std::move(item));
@@ -1465,6 +1467,40 @@ std::ostream &operator<<(std::ostream &os, const cancel_order_info_t &o) {
 
 /*************************************************************************************************/
 
+cancel_replace_order_info_t cancel_replace_order_info_t::construct(const flatjson::fjson &json) {
+    assert(json.is_valid());
+
+    cancel_replace_order_info_t res{};
+    __BINAPI_GET(cancelResult);
+    __BINAPI_GET(newOrderResult);
+    if ( res.cancelResult == "SUCCESS" ) {
+        res.cancelResponse = cancel_order_info_t::construct(json.at("cancelResponse"));
+    }
+    if ( res.newOrderResult == "SUCCESS" ) {
+        res.newOrderResponse = new_order_resp_type::construct(json.at("newOrderResponse"));
+    }
+
+    return res;
+}
+
+std::ostream &operator<<(std::ostream &os, const cancel_replace_order_info_t &o) {
+    os
+    << "{"
+    << "\"cancelResult\":\"" << o.cancelResult << "\","
+    << "\"newOrderResult\":\"" << o.newOrderResult << "\"";
+    if ( o.cancelResult == "SUCCESS" ) {
+        os << ",\"cancelResponse\":" << o.cancelResponse;
+    }
+    if ( o.newOrderResult == "SUCCESS" ) {
+        os << ",\"newOrderResponse\":" << o.newOrderResponse;
+    }
+    os << "}";
+
+    return os;
+}
+
+/*************************************************************************************************/
+
 cancel_all_open_orders_info_t cancel_all_open_orders_info_t::construct(const flatjson::fjson &json) {
     assert(json.is_valid());
 
@@ -15,230 +15,176 @@
 #include <binapi/fnv1a.hpp>
 #include <binapi/flatjson.hpp>
 #include <binapi/errors.hpp>
-
-#include <boost/asio/io_context.hpp>
-#include <boost/asio/connect.hpp>
-#include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/ssl/stream.hpp>
-
-#include <boost/beast/core.hpp>
-#include <boost/beast/websocket.hpp>
-#include <boost/beast/websocket/ssl.hpp>
+#include <binapi/websocket_stream.hpp>
 
 #include <boost/callable_traits.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
 
-#include <boost/intrusive/set.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cassert>
 #include <map>
 #include <set>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <cstring>
 
 // #include <iostream> // TODO: comment out
 
-#define __BINAPI_CB_ON_ERROR(cb, ec) \
-    cb(__FILE__ "(" BOOST_PP_STRINGIZE(__LINE__) ")", ec.value(), ec.message(), nullptr, 0);
-
 namespace binapi
 {
     namespace ws
     {
 
-        struct websockets;
-
-        /*************************************************************************************************/
-
-        struct websocket : std::enable_shared_from_this<websocket>
+        struct websocket_id_getter
         {
-            friend struct websockets;
-
-            explicit websocket(boost::asio::io_context &ioctx)
-                : m_ioctx{ioctx}, m_ssl{boost::asio::ssl::context::sslv23_client}, m_resolver{m_ioctx}, m_ws{m_ioctx, m_ssl}, m_buf{}, m_host{}, m_target{}, m_stop_requested{}
-            {
-            }
-            virtual ~websocket()
-            {
-            }
-
-            using holder_type = std::shared_ptr<websocket>;
-
-            template <typename CB>
-            void async_start(
-                const std::string &host, const std::string &port, const std::string &target, CB cb, holder_type holder)
-            {
-                m_host = host;
-                m_target = target;
+            using type = const void *;
+            type operator()(const websocket &sock) const { return std::addressof(sock); }
+        };
 
-                m_resolver.async_resolve(
-                    m_host, port, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type res) mutable
-                    {
-                if ( ec ) {
-                    if ( !m_stop_requested ) { __BINAPI_CB_ON_ERROR(cb, ec); }
-                } else {
-                    async_connect(std::move(res), std::move(cb), std::move(holder));
-                } });
-            }
+        namespace
+        {
 
-            void stop()
+            // the message of the combined stream is '{"stream":"<name>","data":<message>}', exactly as
+            // the exchange sends it, so it's split without the parsing
+            bool split_envelope(const char *ptr, std::size_t size, std::string_view *name, std::string_view *data)
             {
-                m_stop_requested = true;
+                static constexpr std::string_view stream_key{"{\"stream\":\""};
+                static constexpr std::string_view data_key{",\"data\":"};
 
-                if (m_ws.next_layer().next_layer().is_open())
+                const std::string_view msg{ptr, size};
+                if (msg.compare(0, stream_key.size(), stream_key) != 0)
                 {
-                    boost::system::error_code ec;
-                    m_ws.close(boost::beast::websocket::close_code::normal, ec);
+                    return false;
                 }
-            }
-
-            void async_stop()
-            {
-                m_stop_requested = true;
-                holder_type holder = shared_from_this();
 
-                if (m_ws.next_layer().next_layer().is_open())
+                const auto name_end = msg.find('"', stream_key.size());
+                if (name_end == std::string_view::npos || msg.compare(name_end + 1, data_key.size(), data_key) != 0)
                 {
-                    m_ws.async_close(
-                        boost::beast::websocket::close_code::normal, [holder = std::move(holder)](const boost::system::error_code &) {});
+                    return false;
                 }
-            }
 
-            template <typename CB>
-            void async_connect(boost::asio::ip::tcp::resolver::results_type res, CB cb, holder_type holder)
-            {
-                if (!SSL_set_tlsext_host_name(m_ws.next_layer().native_handle(), m_host.c_str()))
+                const auto data_beg = name_end + 1 + data_key.size();
+                const auto data_end = msg.find_last_of('}');
+                if (data_end == std::string_view::npos || data_end <= data_beg)
                 {
-                    auto error_code = boost::beast::error_code(
-                        static_cast<int>(::ERR_get_error()),
-                        boost::asio::error::get_ssl_category());
+                    return false;
+                }
 
-                    __BINAPI_CB_ON_ERROR(cb, error_code);
+                *name = msg.substr(stream_key.size(), name_end - stream_key.size());
+                *data = msg.substr(data_beg, data_end - data_beg);
 
-                    return;
-                }
+                return true;
+            }
 
-                boost::asio::async_connect(
-                    m_ws.next_layer().next_layer(),
-                    res.begin(),
-                    res.end(),
-                    [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec, boost::asio::ip::basic_resolver_iterator<boost::asio::ip::tcp>) mutable
-                    {
-                        if (ec)
-                        {
-                            if (!m_stop_requested)
-                            {
-                                __BINAPI_CB_ON_ERROR(cb, ec);
-                            }
-                        }
-                        else
-                        {
-                            on_connected(std::move(cb), std::move(holder));
-                        }
-                    });
+            // the only writer is the read path of the connection, so there is no need for the read-modify-write
+            void increase(std::atomic<std::uint64_t> &v, std::uint64_t n)
+            {
+                v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
             }
 
-            template <typename CB>
-            void on_connected(CB cb, holder_type holder)
+            // of the stream callback, for the statistics
+            struct stream_times
             {
-                m_ws.control_callback(
-                    [this](boost::beast::websocket::frame_type kind, boost::beast::string_view payload) mutable
-                    {
-                        (void)kind;
-                        (void)payload;
-                        // std::cout << "control_callback(" << this << "): kind=" << static_cast<int>(kind) << ", payload=" << payload.data() << std::endl;
-                        m_ws.async_pong(
-                            boost::beast::websocket::ping_data{}, [](boost::beast::error_code ec)
-                            { (void)ec; /*std::cout << "control_callback_cb(" << this << "): ec=" << ec << std::endl;*/ });
-                    });
+                std::chrono::steady_clock::duration parse;
+                std::chrono::steady_clock::duration callback;
+            };
 
-                m_ws.next_layer().async_handshake(
-                    boost::asio::ssl::stream_base::client, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec) mutable
-                    {
-                if ( ec ) {
-                    if ( !m_stop_requested ) { __BINAPI_CB_ON_ERROR(cb, ec); }
-                } else {
-                    on_async_ssl_handshake(std::move(cb), std::move(holder));
-                } });
-            }
-            template <typename CB>
-            void on_async_ssl_handshake(CB cb, holder_type holder)
+            std::chrono::steady_clock::time_point stamp(bool timed)
             {
-                m_ws.async_handshake(
-                    m_host, m_target, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec) mutable
-                    { start_read(ec, std::move(cb), std::move(holder)); });
+                return timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
             }
-            template <typename CB>
-            void start_read(boost::system::error_code ec, CB cb, holder_type holder)
-            {
-                if (ec)
-                {
-                    if (!m_stop_requested)
-                    {
-                        __BINAPI_CB_ON_ERROR(cb, ec);
-                    }
-
-                    stop();
 
-                    return;
-                }
-
-                m_ws.async_read(
-                    m_buf, [this, cb = std::move(cb), holder = std::move(holder)](boost::system::error_code ec, std::size_t rd) mutable
-                    { on_read(ec, rd, std::move(cb), std::move(holder)); });
-            }
-            template <typename CB>
-            void on_read(boost::system::error_code ec, std::size_t rd, CB cb, holder_type holder)
+            // the sums of the counters
+            struct stats_totals
             {
-                if (ec)
-                {
-                    if (!m_stop_requested)
-                    {
-                        __BINAPI_CB_ON_ERROR(cb, ec);
-                    }
+                std::uint64_t messages;
+                std::uint64_t bytes;
+                std::uint64_t parse_ns;
+                std::uint64_t callback_ns;
+                std::uint64_t reconnects;
 
-                    stop();
+                stats_totals &operator+=(const stats_totals &r)
+                {
+                    messages += r.messages;
+                    bytes += r.bytes;
+                    parse_ns += r.parse_ns;
+                    callback_ns += r.callback_ns;
+                    reconnects += r.reconnects;
 
-                    return;
+                    return *this;
                 }
+            };
 
-                auto size = m_buf.size();
-                assert(size == rd);
-
-                std::string strbuf;
-                strbuf.reserve(size);
+            // of the reporter, for the rates over the interval
+            struct stats_rates
+            {
+                std::uint64_t last_messages;
+                std::uint64_t last_bytes;
+                double peak_msg_rate;
+                double peak_bytes_rate;
+            };
 
-                for (const auto &it : m_buf.data())
+            // the counters of the connection, updated by its read path without the locks, and read by the reporter
+            struct connection_stats
+            {
+                connection_stats()
+                    : messages{}, bytes{}, parse_ns{}, callback_ns{}, reconnects{}, since{std::chrono::steady_clock::now()}, rates{}
                 {
-                    strbuf.append(static_cast<const char *>(it.data()), it.size());
                 }
-                m_buf.consume(m_buf.size());
 
-                bool ok = cb(nullptr, 0, std::string{}, strbuf.data(), strbuf.size());
-                if (!ok)
+                void on_message(std::size_t size, const stream_times &times)
                 {
-                    stop();
+                    increase(messages, 1);
+                    increase(bytes, size);
+                    increase(parse_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(times.parse).count());
+                    increase(callback_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(times.callback).count());
                 }
-                else
+
+                stats_totals totals() const
                 {
-                    start_read(boost::system::error_code{}, std::move(cb), std::move(holder));
+                    return {
+                        messages.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed), parse_ns.load(std::memory_order_relaxed), callback_ns.load(std::memory_order_relaxed), reconnects.load(std::memory_order_relaxed)};
                 }
-            }
 
-            boost::asio::io_context &m_ioctx;
-            boost::asio::ssl::context m_ssl;
-            boost::asio::ip::tcp::resolver m_resolver;
-            boost::beast::websocket::stream<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> m_ws;
-            boost::beast::multi_buffer m_buf;
-            std::string m_host;
-            std::string m_target;
-            bool m_stop_requested;
-            boost::intrusive::set_member_hook<> m_intrusive_set_hook;
-        };
+                std::atomic<std::uint64_t> messages;
+                std::atomic<std::uint64_t> bytes;
+                std::atomic<std::uint64_t> parse_ns;
+                std::atomic<std::uint64_t> callback_ns;
+                std::atomic<std::uint64_t> reconnects;
+                const std::chrono::steady_clock::time_point since;
+                stats_rates rates; // of the reporter
+            };
 
-        struct websocket_id_getter
-        {
-            using type = const void *;
-            type operator()(const websocket &sock) const { return std::addressof(sock); }
-        };
+            websockets::network_stat_t::counters_t make_counters(const stats_totals &t, double interval, double lifetime, stats_rates &rates)
+            {
+                websockets::network_stat_t::counters_t res{};
+                res.messages = t.messages;
+                res.bytes = t.bytes;
+                res.msg_rate = (t.messages - rates.last_messages) / interval;
+                res.bytes_rate = (t.bytes - rates.last_bytes) / interval;
+                res.msg_rate_avg = lifetime > 0 ? t.messages / lifetime : 0;
+                res.bytes_rate_avg = lifetime > 0 ? t.bytes / lifetime : 0;
+                rates.last_messages = t.messages;
+                rates.last_bytes = t.bytes;
+                rates.peak_msg_rate = std::max(rates.peak_msg_rate, res.msg_rate);
+                rates.peak_bytes_rate = std::max(rates.peak_bytes_rate, res.bytes_rate);
+                res.msg_rate_peak = rates.peak_msg_rate;
+                res.bytes_rate_peak = rates.peak_bytes_rate;
+                res.parse_us = t.messages ? t.parse_ns / 1000.0 / t.messages : 0;
+                res.callback_us = t.messages ? t.callback_ns / 1000.0 / t.messages : 0;
+                res.reconnects = t.reconnects;
+
+                return res;
+            }
+
+        } // anon ns
 
         /*************************************************************************************************/
         /*************************************************************************************************/
@@ -248,11 +194,16 @@ namespace binapi
         {
             impl(
                 boost::asio::io_context &ioctx, std::string host, std::string port, on_message_received_cb msg_cb, on_network_stat_cb stat_cb, std::size_t stat_interval)
-                : m_ioctx{ioctx}, m_host{std::move(host)}, m_port{std::move(port)}, m_on_message{std::move(msg_cb)}, m_on_stat{std::move(stat_cb)}, m_stat_interval{stat_interval}, m_set{}
+                : m_ioctx{ioctx}, m_host{std::move(host)}, m_port{std::move(port)}, m_on_message{std::move(msg_cb)}, m_on_stat{std::move(stat_cb)}, m_stat_interval{stat_interval}, m_set{}, m_max_combined{}, m_combined{}, m_streams{}, m_dispatching{}, m_unsubscribed{}, m_last_id{}, m_reconnect{}, m_on_gap{}, m_min_delay{}, m_max_delay{}, m_max_lifetime{}, m_rng{std::random_device{}()}, m_on_stat_ex{}, m_stats_enabled{}, m_stat_timer{m_ioctx}, m_stat_started{}, m_stat_last{}, m_dedicated_stats{}, m_retired{}, m_total_rates{}
             {
+                if (m_on_stat)
+                {
+                    start_stats();
+                }
             }
             ~impl()
             {
+                m_stat_timer.cancel();
                 unsubscribe_all();
             }
 
@@ -275,32 +226,45 @@ namespace binapi
                 return res;
             }
 
+            // the raw messages of the stream, as they are passed by the websocket
+            using stream_cb = std::function<bool(const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size, stream_times &times)>;
+
             template <typename F>
-            websockets::handle start_channel(const char *pair, const char *channel, F cb)
+            auto make_stream_cb(std::string schannel, F cb)
             {
                 using args_tuple = typename boost::callable_traits::args<F>::type;
                 using message_type = typename std::tuple_element<3, args_tuple>::type;
 
-                static const auto deleter = [this](websocket *ws)
+                // the parser's storage is reused by the messages of the stream
+                return [this, schannel = std::move(schannel), cb = std::move(cb), json = flatjson::fjson{}](const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size, stream_times &times) mutable -> bool
                 {
-                    auto it = m_set.find(ws);
-                    if (it != m_set.end())
+                    if (ec)
                     {
-                        m_set.erase(it);
-                    }
+                        try
+                        {
+                            cb(fl, ec, std::move(errmsg), message_type{});
+                        }
+                        catch (const std::exception &ex)
+                        {
+                            std::fprintf(stderr, "%s: %s\n", __MAKE_FILELINE, ex.what());
+                            std::fflush(stderr);
+                        }
 
-                    delete ws;
-                };
-                std::shared_ptr<websocket> ws{new websocket(m_ioctx), deleter};
-                std::string schannel = make_channel_name(pair, channel);
+                        return false;
+                    }
 
-                auto wscb = [this, schannel, cb = std::move(cb)](const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size) -> bool
-                {
-                    if (ec)
+                    const bool timed = m_stats_enabled;
+                    const auto parse_start = stamp(timed);
+                    json.clear();
+                    if (!json.load(ptr, size))
                     {
+                        const auto error = json.error();
+                        // the error state is sticky
+                        json = flatjson::fjson{};
+
                         try
                         {
-                            cb(fl, ec, std::move(errmsg), message_type{});
+                            return cb(__MAKE_FILELINE, error, flatjson::fj_error_string(error), message_type{});
                         }
                         catch (const std::exception &ex)
                         {
@@ -311,7 +275,8 @@ namespace binapi
                         return false;
                     }
 
-                    const flatjson::fjson json{ptr, size};
+                    times.parse = stamp(timed) - parse_start;
+
                     if (json.is_object() && binapi::rest::is_api_error(json))
                     {
                         auto error = binapi::rest::construct_error(json);
@@ -345,8 +310,15 @@ namespace binapi
 
                     try
                     {
+                        const auto construct_start = stamp(timed);
                         message_type message = message_type::construct(json);
-                        return cb(nullptr, 0, std::string{}, std::move(message));
+                        const auto callback_start = stamp(timed);
+                        times.parse += callback_start - construct_start;
+
+                        const bool ok = cb(nullptr, 0, std::string{}, std::move(message));
+                        times.callback = stamp(timed) - callback_start;
+
+                        return ok;
                     }
                     catch (const std::exception &ex)
                     {
@@ -356,22 +328,651 @@ namespace binapi
 
                     return false;
                 };
+            }
+
+            template <typename F>
+            websockets::handle start_channel(const char *pair, const char *channel, F cb)
+            {
+                std::string schannel = make_channel_name(pair, channel);
+                auto wscb = make_stream_cb(schannel, std::move(cb));
+                if (m_max_combined || m_reconnect)
+                {
+                    return add_combined_stream(std::move(schannel), std::move(wscb));
+                }
+
+                static const auto deleter = [this](websocket *ws)
+                {
+                    auto it = m_set.find(ws);
+                    if (it != m_set.end())
+                    {
+                        m_set.erase(it);
+                    }
+
+                    delete ws;
+                };
+                std::shared_ptr<websocket> ws{new websocket(m_ioctx), deleter};
+
+                auto stats = std::make_shared<connection_stats>();
+                auto dedicated_cb = [stats, wscb = std::move(wscb)](const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size) mutable -> bool
+                {
+                    stream_times times{};
+                    const bool ok = wscb(fl, ec, std::move(errmsg), ptr, size, times);
+                    if (!ec)
+                    {
+                        stats->on_message(size, times);
+                    }
+
+                    return ok;
+                };
 
                 auto *ws_ptr = ws.get();
                 ws_ptr->async_start(
-                    m_host, m_port, schannel, std::move(wscb), std::move(ws));
+                    m_host, m_port, schannel, std::move(dedicated_cb), std::move(ws));
 
                 m_set.insert(*ws_ptr);
+                m_dedicated_stats.emplace(ws_ptr, std::move(stats));
 
                 return ws_ptr;
             }
 
+            /*************************************************************************************************/
+
+            struct combined_connection;
+
+            // the stream multiplexed over the combined connection, its address is the handle
+            struct combined_stream
+            {
+                std::string name; // as in the envelope, e.g. 'btcusdt@trade'
+                stream_cb cb;
+                combined_connection *conn;
+            };
+            using combined_stream_ptr = std::unique_ptr<combined_stream>;
+
+            // the SUBSCRIBE or UNSUBSCRIBE request which is not acknowledged yet
+            struct control_request
+            {
+                bool subscribe;
+                std::vector<std::string> names;
+            };
+
+            struct combined_connection : std::enable_shared_from_this<combined_connection>
+            {
+                explicit combined_connection(boost::asio::io_context &ioctx)
+                    : ws{std::make_shared<websocket>(ioctx)}, streams{}, to_subscribe{}, to_unsubscribe{}, pending{}, timer{ioctx}, last_control{}, started{}, closed{}, flush_scheduled{}, supervisor_timer{ioctx}, live{}, attempts{}, lost_at{}, lost_ec{}, lost_errmsg{}, standby{}, standby_names{}, stats{}
+                {
+                }
+
+                std::shared_ptr<websocket> ws;
+                std::unordered_map<std::string_view, combined_stream *> streams; // the keys are the names of the streams
+                // the changes made after the connection was started, sent by the batches
+                std::vector<std::string> to_subscribe;
+                std::vector<std::string> to_unsubscribe;
+                std::unordered_map<std::size_t, control_request> pending; // by the id
+                boost::asio::steady_timer timer; // of the next batch
+                std::chrono::steady_clock::time_point last_control;
+                bool started;
+                bool closed;
+                bool flush_scheduled;
+                // the supervisor's state
+                boost::asio::steady_timer supervisor_timer; // of the next attempt, or of the planned reconnection
+                bool live; // a message was received by the current websocket
+                std::size_t attempts; // the failed ones in a row
+                std::uint64_t lost_at; // ms since epoch, 0 - it's not lost
+                int lost_ec;
+                std::string lost_errmsg;
+                // the websocket of the planned reconnection, it replaces 'ws' by its first message
+                std::shared_ptr<websocket> standby;
+                std::vector<std::string> standby_names; // the streams of its target
+                connection_stats stats; // of all the websockets of the connection
+            };
+            using combined_connection_ptr = std::shared_ptr<combined_connection>;
+
+            // the exchange drops the connection which sends more than 5 messages per second
+            static constexpr std::chrono::milliseconds control_interval{250};
+
+            websockets::handle add_combined_stream(std::string schannel, stream_cb cb)
+            {
+                // the name of the stream is the channel without the '/ws/' prefix
+                std::string name = schannel.substr(std::strlen("/ws/"));
+                combined_connection_ptr conn = acquire_combined(name);
+
+                auto *stream = new combined_stream{std::move(name), std::move(cb), conn.get()};
+                m_streams.emplace(stream, combined_stream_ptr{stream});
+                conn->streams.emplace(stream->name, stream);
+
+                if (conn->started)
+                {
+                    // the one unsubscribed by the pending batch is still subscribed
+                    if (!erase_name(conn->to_unsubscribe, stream->name))
+                    {
+                        conn->to_subscribe.push_back(stream->name);
+                    }
+                    schedule_flush(*conn);
+                }
+
+                return stream;
+            }
+            // the connection which has the room for the stream. a new one is started if there is none
+            combined_connection_ptr acquire_combined(const std::string &name)
+            {
+                // one stream per connection for the supervised ones, if it's not set
+                const std::size_t max_streams = m_max_combined ? m_max_combined : 1;
+                for (const auto &it : m_combined)
+                {
+                    if (it->streams.size() < max_streams && !it->streams.count(name))
+                    {
+                        return it;
+                    }
+                }
+
+                auto conn = std::make_shared<combined_connection>(m_ioctx);
+                m_combined.push_back(conn);
+
+                // the streams subscribed until then are packed into the target of the connection
+                boost::asio::post(
+                    m_ioctx, [this, conn]()
+                    {
+                        if (!conn->closed)
+                        {
+                            start_combined(conn);
+                        }
+                    });
+
+                return conn;
+            }
+            static bool erase_name(std::vector<std::string> &names, const std::string &name)
+            {
+                auto it = std::find(names.begin(), names.end(), name);
+                if (it == names.end())
+                {
+                    return false;
+                }
+
+                names.erase(it);
+
+                return true;
+            }
+            void start_combined(const combined_connection_ptr &conn)
+            {
+                conn->started = true;
+                conn->live = false;
+
+                start_websocket(conn, conn->ws);
+                schedule_rotation(*conn, m_max_lifetime);
+            }
+            // '/stream?streams=a/b/c' of the streams of the connection
+            static std::string make_target(const combined_connection &conn)
+            {
+                std::string target{"/stream?streams="};
+                for (const auto &it : conn.streams)
+                {
+                    if (target.back() != '=')
+                    {
+                        target += '/';
+                    }
+                    target.append(it.first.data(), it.first.size());
+                }
+
+                return target;
+            }
+            void start_websocket(const combined_connection_ptr &conn, const std::shared_ptr<websocket> &sp)
+            {
+                // the closed connection is detached from the impl, which can be destroyed already.
+                // the websocket replaced by the supervisor is not of the connection anymore
+                auto *ws = sp.get();
+                auto wscb = [this, conn, ws](const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size) -> bool
+                {
+                    if (conn->closed)
+                    {
+                        return false;
+                    }
+                    if (conn->standby.get() == ws)
+                    {
+                        return on_standby_message(*conn, fl, ec, std::move(errmsg), ptr, size);
+                    }
+
+                    return conn->ws.get() == ws && on_combined_message(*conn, fl, ec, std::move(errmsg), ptr, size);
+                };
+
+                ws->async_start(
+                    m_host, m_port, make_target(*conn), std::move(wscb), sp);
+            }
+            // the planned reconnection, after the lifetime or after the failed attempt of it
+            void schedule_rotation(combined_connection &conn, std::chrono::milliseconds delay)
+            {
+                if (!m_reconnect)
+                {
+                    return;
+                }
+
+                conn.supervisor_timer.expires_after(delay);
+                conn.supervisor_timer.async_wait(
+                    [this, holder = conn.shared_from_this()](const boost::system::error_code &ec)
+                    {
+                        if (!ec && !holder->closed)
+                        {
+                            start_standby(holder);
+                        }
+                    });
+            }
+            // make before break: the current websocket is used until the new one receives its first message
+            void start_standby(const combined_connection_ptr &conn)
+            {
+                conn->standby = std::make_shared<websocket>(m_ioctx);
+                conn->standby_names.clear();
+                for (const auto &it : conn->streams)
+                {
+                    conn->standby_names.emplace_back(it.first);
+                }
+
+                start_websocket(conn, conn->standby);
+            }
+            bool on_standby_message(combined_connection &conn, const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size)
+            {
+                if (ec)
+                {
+                    // the current one is still used, the rotation is retried later. it's stopped by itself
+                    conn.standby.reset();
+                    schedule_rotation(conn, m_max_delay);
+
+                    return false;
+                }
+
+                auto old = std::move(conn.ws);
+                conn.ws = std::move(conn.standby);
+                old->async_stop();
+                increase(conn.stats.reconnects, 1);
+
+                // the requests of the old one are not answered, and the changes made after the new one was
+                // started are sent to it
+                conn.pending.clear();
+                conn.to_subscribe.clear();
+                conn.to_unsubscribe = std::move(conn.standby_names);
+                conn.standby_names.clear();
+                for (const auto &it : conn.streams)
+                {
+                    if (!erase_name(conn.to_unsubscribe, std::string{it.first}))
+                    {
+                        conn.to_subscribe.emplace_back(it.first);
+                    }
+                }
+                if (!conn.to_subscribe.empty() || !conn.to_unsubscribe.empty())
+                {
+                    schedule_flush(conn);
+                }
+
+                schedule_rotation(conn, m_max_lifetime);
+
+                return on_combined_message(conn, fl, ec, std::move(errmsg), ptr, size);
+            }
+            // the streams stay subscribed, they are sent to the new connection
+            void reconnect_combined(combined_connection &conn, int ec, std::string errmsg)
+            {
+                if (!conn.lost_at && conn.live)
+                {
+                    conn.lost_at = now_ms();
+                    conn.lost_ec = ec;
+                    conn.lost_errmsg = std::move(errmsg);
+                }
+
+                increase(conn.stats.reconnects, 1);
+                conn.started = false;
+                conn.pending.clear();
+                conn.to_subscribe.clear();
+                conn.to_unsubscribe.clear();
+                conn.timer.cancel();
+                conn.flush_scheduled = false;
+                if (conn.standby)
+                {
+                    // the planned reconnection in progress is replaced by this one
+                    conn.standby->async_stop();
+                    conn.standby.reset();
+                }
+                conn.ws = std::make_shared<websocket>(m_ioctx);
+
+                conn.supervisor_timer.expires_after(next_delay(conn));
+                conn.supervisor_timer.async_wait(
+                    [this, holder = conn.shared_from_this()](const boost::system::error_code &ec)
+                    {
+                        if (!ec && !holder->closed)
+                        {
+                            start_combined(holder);
+                        }
+                    });
+            }
+            // of the next attempt: the full delay is doubled with each one, and the random half of it is taken off
+            std::chrono::milliseconds next_delay(combined_connection &conn)
+            {
+                const auto shift = std::min<std::size_t>(conn.attempts++, 20);
+                const std::chrono::milliseconds full = std::min<std::chrono::milliseconds>(m_min_delay * (1 << shift), m_max_delay);
+                std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter{0, full.count() / 2};
+
+                return full - std::chrono::milliseconds{jitter(m_rng)};
+            }
+            // for each stream of the connection, before the first message after the reconnection
+            void report_gap(combined_connection &conn)
+            {
+                const websockets::gap_t gap{conn.lost_at, now_ms(), conn.lost_ec, std::move(conn.lost_errmsg)};
+                conn.lost_at = 0;
+                conn.lost_ec = 0;
+                conn.lost_errmsg.clear();
+                if (!m_on_gap)
+                {
+                    return;
+                }
+
+                // the callback can unsubscribe
+                std::vector<handle> handles;
+                handles.reserve(conn.streams.size());
+                for (const auto &it : conn.streams)
+                {
+                    handles.push_back(it.second);
+                }
+                for (auto h : handles)
+                {
+                    auto it = m_streams.find(h);
+                    if (it == m_streams.end())
+                    {
+                        continue;
+                    }
+
+                    try
+                    {
+                        m_on_gap(h, it->second->name.c_str(), gap);
+                    }
+                    catch (const std::exception &ex)
+                    {
+                        std::fprintf(stderr, "%s: %s\n", __MAKE_FILELINE, ex.what());
+                        std::fflush(stderr);
+                    }
+                }
+            }
+            static std::uint64_t now_ms()
+            {
+                return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                      std::chrono::system_clock::now().time_since_epoch())
+                                                      .count());
+            }
+            bool on_combined_message(combined_connection &conn, const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size)
+            {
+                if (ec && m_reconnect && !conn.streams.empty())
+                {
+                    reconnect_combined(conn, ec, std::move(errmsg));
+
+                    return false;
+                }
+                if (ec)
+                {
+                    // the connection is lost, all of its streams are stopped
+                    auto streams = detach_streams(conn, nullptr);
+                    close_combined(conn, [](auto) {});
+                    stream_times times{};
+                    for (const auto &it : streams)
+                    {
+                        it->cb(fl, ec, errmsg, nullptr, 0, times);
+                    }
+
+                    return false;
+                }
+
+                conn.live = true;
+                conn.attempts = 0;
+                if (conn.lost_at)
+                {
+                    report_gap(conn);
+                    if (conn.closed)
+                    {
+                        return false;
+                    }
+                }
+
+                std::string_view name, data;
+                if (!split_envelope(ptr, size, &name, &data))
+                {
+                    // not the message of a stream, the reply to the request
+                    conn.stats.on_message(size, stream_times{});
+                    on_combined_reply(conn, ptr, size);
+
+                    return !conn.closed;
+                }
+
+                auto it = conn.streams.find(name);
+                if (it == conn.streams.end())
+                {
+                    // already unsubscribed
+                    conn.stats.on_message(size, stream_times{});
+
+                    return true;
+                }
+
+                // the callback can unsubscribe its own stream, it's destroyed after the return
+                combined_stream *stream = it->second;
+                stream_times times{};
+                m_dispatching = stream;
+                const bool ok = stream->cb(nullptr, 0, std::string{}, data.data(), data.size(), times);
+                m_dispatching = nullptr;
+                conn.stats.on_message(size, times);
+                if (m_unsubscribed)
+                {
+                    m_unsubscribed.reset();
+                }
+                else if (!ok)
+                {
+                    remove_stream(stream);
+                }
+
+                return !conn.closed;
+            }
+            // '{"result":null,"id":1}' or '{"error":{"code":2,"msg":"Invalid request"},"id":1}'
+            void on_combined_reply(combined_connection &conn, const char *ptr, std::size_t size)
+            {
+                const flatjson::fjson json{ptr, size};
+                if (!json.is_valid() || !json.is_object() || !json.contains("id") || !json.at("id").is_number())
+                {
+                    return;
+                }
+
+                auto it = conn.pending.find(json.at("id").to_uint64());
+                if (it == conn.pending.end())
+                {
+                    return;
+                }
+
+                control_request req = std::move(it->second);
+                conn.pending.erase(it);
+                if (!json.contains("error"))
+                {
+                    return;
+                }
+
+                auto error = binapi::rest::construct_error(json.at("error"));
+                if (!req.subscribe)
+                {
+                    std::fprintf(stderr, "%s: UNSUBSCRIBE: %s\n", __MAKE_FILELINE, error.second.c_str());
+                    std::fflush(stderr);
+
+                    return;
+                }
+
+                // the rejected streams are stopped
+                auto streams = detach_streams(conn, &req.names);
+                if (conn.streams.empty())
+                {
+                    schedule_flush(conn);
+                }
+                stream_times times{};
+                for (const auto &it : streams)
+                {
+                    it->cb(__MAKE_FILELINE, error.first, error.second, nullptr, 0, times);
+                }
+            }
+            // the streams are detached first, so their callbacks can unsubscribe. all if 'names' is null
+            std::vector<combined_stream_ptr> detach_streams(combined_connection &conn, const std::vector<std::string> *names)
+            {
+                std::vector<combined_stream_ptr> res;
+                for (auto it = conn.streams.begin(); it != conn.streams.end();)
+                {
+                    if (names && std::find(names->begin(), names->end(), it->first) == names->end())
+                    {
+                        ++it;
+                        continue;
+                    }
+
+                    auto node = m_streams.extract(it->second);
+                    res.push_back(std::move(node.mapped()));
+                    it = conn.streams.erase(it);
+                }
+
+                return res;
+            }
+            void remove_stream(combined_stream *stream)
+            {
+                auto node = m_streams.extract(stream);
+                auto &conn = *stream->conn;
+                conn.streams.erase(stream->name);
+                if (conn.started)
+                {
+                    // the one subscribed by the pending batch is not subscribed yet
+                    if (!erase_name(conn.to_subscribe, stream->name))
+                    {
+                        conn.to_unsubscribe.push_back(stream->name);
+                    }
+                    // it's closed by the batch if it's still empty, so it can be reused by the next streams
+                    schedule_flush(conn);
+                }
+                else if (conn.streams.empty())
+                {
+                    close_combined(conn, [](auto) {});
+                }
+
+                if (stream == m_dispatching)
+                {
+                    m_unsubscribed = std::move(node.mapped());
+                }
+            }
+            void schedule_flush(combined_connection &conn)
+            {
+                if (conn.flush_scheduled)
+                {
+                    return;
+                }
+
+                // the changes made until then are sent by one request
+                conn.flush_scheduled = true;
+                conn.timer.expires_at(conn.last_control + control_interval);
+                conn.timer.async_wait(
+                    [this, holder = conn.shared_from_this()](const boost::system::error_code &ec)
+                    {
+                        // is cancelled by the reconnection
+                        if (!ec && !holder->closed)
+                        {
+                            flush_combined(*holder);
+                        }
+                    });
+            }
+            void flush_combined(combined_connection &conn)
+            {
+                conn.flush_scheduled = false;
+                if (conn.streams.empty())
+                {
+                    close_combined(conn, [](auto sp)
+                                   { sp->async_stop(); });
+
+                    return;
+                }
+
+                // one request by the interval
+                if (!conn.to_unsubscribe.empty())
+                {
+                    send_control(conn, false, std::move(conn.to_unsubscribe));
+                    conn.to_unsubscribe.clear();
+                }
+                else if (!conn.to_subscribe.empty())
+                {
+                    send_control(conn, true, std::move(conn.to_subscribe));
+                    conn.to_subscribe.clear();
+                }
+                else
+                {
+                    return;
+                }
+
+                conn.last_control = std::chrono::steady_clock::now();
+                if (!conn.to_subscribe.empty())
+                {
+                    schedule_flush(conn);
+                }
+            }
+            // '{"method":"SUBSCRIBE","params":["btcusdt@trade","btcusdt@depth"],"id":1}'
+            void send_control(combined_connection &conn, bool subscribe, std::vector<std::string> names)
+            {
+                const auto id = ++m_last_id;
+
+                std::string msg{"{\"method\":\""};
+                msg += subscribe ? "SUBSCRIBE" : "UNSUBSCRIBE";
+                msg += "\",\"params\":[";
+                for (const auto &it : names)
+                {
+                    if (msg.back() != '[')
+                    {
+                        msg += ',';
+                    }
+                    msg += '"';
+                    msg += it;
+                    msg += '"';
+                }
+                msg += "],\"id\":";
+                msg += std::to_string(id);
+                msg += '}';
+
+                conn.pending.emplace(id, control_request{subscribe, std::move(names)});
+                // is sent after the handshake if it's not completed yet
+                conn.ws->async_write(std::move(msg));
+            }
+            template <typename F>
+            void close_combined(combined_connection &conn, F f)
+            {
+                conn.closed = true;
+                conn.streams.clear();
+                conn.pending.clear();
+                conn.timer.cancel();
+                conn.supervisor_timer.cancel();
+                if (conn.ws)
+                {
+                    f(conn.ws.get());
+                    conn.ws.reset();
+                }
+                if (conn.standby)
+                {
+                    f(conn.standby.get());
+                    conn.standby.reset();
+                }
+
+                retire_stats(conn.stats);
+
+                auto it = std::find_if(
+                    m_combined.begin(), m_combined.end(), [&conn](const combined_connection_ptr &p)
+                    { return p.get() == &conn; });
+                if (it != m_combined.end())
+                {
+                    // the pending handlers of the connection hold it
+                    m_combined.erase(it);
+                }
+            }
+
             template <typename F>
             void stop_channel_impl(handle h, F f)
             {
                 auto it = m_set.find(h);
                 if (it == m_set.end())
                 {
+                    auto sit = m_streams.find(h);
+                    if (sit != m_streams.end())
+                    {
+                        // the connection stays open for the other streams, see remove_stream()
+                        remove_stream(sit->second.get());
+                    }
+
                     return;
                 }
 
@@ -379,6 +980,7 @@ namespace binapi
                 f(ws);
 
                 m_set.erase(it);
+                retire_dedicated_stats(ws);
             }
 
             void stop_channel(handle h)
@@ -401,7 +1003,22 @@ namespace binapi
                     f(ws);
 
                     it = m_set.erase(it);
+                    retire_dedicated_stats(ws);
                 }
+
+                auto conns = std::move(m_combined);
+                for (const auto &it : conns)
+                {
+                    close_combined(*it, f);
+                }
+                for (auto &it : m_streams)
+                {
+                    if (it.second.get() == m_dispatching)
+                    {
+                        m_unsubscribed = std::move(it.second);
+                    }
+                }
+                m_streams.clear();
             }
             void unsubscribe_all()
             {
@@ -414,6 +1031,109 @@ namespace binapi
                                             { sp->async_stop(); });
             }
 
+            /*************************************************************************************************/
+
+            void start_stats()
+            {
+                if (m_stats_enabled || !m_stat_interval)
+                {
+                    return;
+                }
+
+                m_stats_enabled = true;
+                m_stat_started = m_stat_last = std::chrono::steady_clock::now();
+                schedule_stats();
+            }
+            void schedule_stats()
+            {
+                // the timer is cancelled by the dtor, so the handler is called with the error
+                m_stat_timer.expires_after(std::chrono::seconds{m_stat_interval});
+                m_stat_timer.async_wait(
+                    [this](const boost::system::error_code &ec)
+                    {
+                        if (!ec)
+                        {
+                            report_stats();
+                            schedule_stats();
+                        }
+                    });
+            }
+            void report_stats()
+            {
+                const auto now = std::chrono::steady_clock::now();
+                const double interval = std::max(std::chrono::duration<double>(now - m_stat_last).count(), 1e-9);
+                m_stat_last = now;
+
+                websockets::network_stat_t res{};
+                stats_totals total = m_retired;
+                std::size_t streams{};
+                std::size_t queue_depth{};
+                auto add = [&](connection_stats &stats, const std::string &target, std::size_t nstreams, std::size_t queued)
+                {
+                    const auto t = stats.totals();
+                    auto c = make_counters(t, interval, std::chrono::duration<double>(now - stats.since).count(), stats.rates);
+                    c.target = target;
+                    c.streams = nstreams;
+                    c.queue_depth = queued;
+                    res.connections.push_back(std::move(c));
+
+                    total += t;
+                    streams += nstreams;
+                    queue_depth += queued;
+                };
+
+                for (auto &it : m_set)
+                {
+                    auto sit = m_dedicated_stats.find(&it);
+                    if (sit != m_dedicated_stats.end())
+                    {
+                        add(*sit->second, it.m_target, 1, it.m_write_queue.size());
+                    }
+                }
+                for (const auto &it : m_combined)
+                {
+                    // the target is set when it's started
+                    const std::string target = it->started ? it->ws->m_target : std::string{};
+                    add(it->stats, target, it->streams.size(), it->started ? it->ws->m_write_queue.size() : 0);
+                }
+
+                res.total = make_counters(total, interval, std::chrono::duration<double>(now - m_stat_started).count(), m_total_rates);
+                res.total.streams = streams;
+                res.total.queue_depth = queue_depth;
+
+                try
+                {
+                    if (m_on_stat)
+                    {
+                        m_on_stat(
+                            static_cast<std::size_t>(res.total.msg_rate * interval + 0.5), static_cast<std::size_t>(res.total.msg_rate_avg), static_cast<std::size_t>(res.total.bytes_rate * interval + 0.5), static_cast<std::size_t>(res.total.bytes_rate_avg));
+                    }
+                    if (m_on_stat_ex)
+                    {
+                        m_on_stat_ex(res);
+                    }
+                }
+                catch (const std::exception &ex)
+                {
+                    std::fprintf(stderr, "%s: %s\n", __MAKE_FILELINE, ex.what());
+                    std::fflush(stderr);
+                }
+            }
+            // the counters of the closed connection are kept in the total
+            void retire_stats(const connection_stats &stats)
+            {
+                m_retired += stats.totals();
+            }
+            void retire_dedicated_stats(websocket *ws)
+            {
+                auto it = m_dedicated_stats.find(ws);
+                if (it != m_dedicated_stats.end())
+                {
+                    retire_stats(*it->second);
+                    m_dedicated_stats.erase(it);
+                }
+            }
+
             boost::asio::io_context &m_ioctx;
             std::string m_host;
             std::string m_port;
@@ -423,6 +1143,26 @@ namespace binapi
             boost::intrusive::set<
                 websocket, boost::intrusive::key_of_value<websocket_id_getter>, boost::intrusive::member_hook<websocket, boost::intrusive::set_member_hook<>, &websocket::m_intrusive_set_hook>>
                 m_set;
+            std::size_t m_max_combined; // streams per connection, 0 - not combined
+            std::vector<combined_connection_ptr> m_combined;
+            std::unordered_map<handle, combined_stream_ptr> m_streams; // of the combined connections
+            combined_stream *m_dispatching; // whose callback is being called
+            combined_stream_ptr m_unsubscribed; // by its own callback
+            std::size_t m_last_id; // of the SUBSCRIBE/UNSUBSCRIBE requests
+            bool m_reconnect;
+            on_gap_cb m_on_gap;
+            std::chrono::milliseconds m_min_delay;
+            std::chrono::milliseconds m_max_delay;
+            std::chrono::seconds m_max_lifetime;
+            std::mt19937 m_rng; // of the jitter
+            on_network_stat_ex_cb m_on_stat_ex;
+            bool m_stats_enabled; // the times of the stream callbacks are measured
+            boost::asio::steady_timer m_stat_timer;
+            std::chrono::steady_clock::time_point m_stat_started;
+            std::chrono::steady_clock::time_point m_stat_last;
+            std::unordered_map<handle, std::shared_ptr<connection_stats>> m_dedicated_stats; // by the handle
+            stats_totals m_retired; // of the closed connections
+            stats_rates m_total_rates;
         };
 
         /*************************************************************************************************/
@@ -438,6 +1178,28 @@ namespace binapi
         {
         }
 
+        void websockets::set_combined_streams(std::size_t max_streams)
+        {
+            pimpl->m_max_combined = max_streams;
+        }
+
+        void websockets::set_network_stat_cb(on_network_stat_ex_cb cb)
+        {
+            pimpl->m_on_stat_ex = std::move(cb);
+            pimpl->start_stats();
+        }
+
+        void websockets::set_reconnect(on_gap_cb gap_cb, std::size_t min_delay_ms, std::size_t max_delay_ms, std::size_t max_lifetime_s)
+        {
+            assert(min_delay_ms > 0 && min_delay_ms <= max_delay_ms);
+
+            pimpl->m_reconnect = true;
+            pimpl->m_on_gap = std::move(gap_cb);
+            pimpl->m_min_delay = std::chrono::milliseconds{min_delay_ms};
+            pimpl->m_max_delay = std::chrono::milliseconds{max_delay_ms};
+            pimpl->m_max_lifetime = std::chrono::seconds{max_lifetime_s};
+        }
+
         /*************************************************************************************************/
 
         websockets::handle websockets::part_depth(const char *pair, e_levels level, e_freq freq, on_part_depths_received_cb cb)
@@ -0,0 +1,446 @@
+
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#include <binapi/wsapi.hpp>
+#include <binapi/clock_sync.hpp>
+#include <binapi/websocket_stream.hpp>
+#include <binapi/request.hpp>
+#include <binapi/signer.hpp>
+#include <binapi/errors.hpp>
+#include <binapi/flatjson.hpp>
+#include <binapi/message.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace binapi {
+namespace wsapi {
+
+/*************************************************************************************************/
+
+namespace {
+
+std::uint64_t get_current_ms_epoch() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count());
+}
+
+void append_json_string(std::string &dst, const char *str) {
+    dst += '"';
+    for ( ; *str; ++str ) {
+        if ( *str == '"' || *str == '\\' ) {
+            dst += '\\';
+        }
+        dst += *str;
+    }
+    dst += '"';
+}
+
+// the requests are signed by it when they are sent, so it's checked by the constructor
+std::shared_ptr<const signer> not_null_signer(std::shared_ptr<const signer> signer) {
+    if ( !signer ) {
+        throw std::invalid_argument("the signer is null");
+    }
+
+    return signer;
+}
+
+} // anon ns
+
+/*************************************************************************************************/
+
+struct client::impl {
+    // 'res' is the 'result' member of the response. on error it's the 'data' member of the error,
+    // with the partial result (e.g. of the failed cancel-replace), or null
+    using pending_cb = std::function<void(const char *fl, int ec, std::string errmsg, const flatjson::fjson *res)>;
+
+    impl(
+         boost::asio::io_context &ioctx
+        ,std::string host
+        ,std::string port
+        ,std::string pk
+        ,std::shared_ptr<const signer> signer
+        ,std::size_t recv_window
+        ,std::string target
+    )
+        :m_ioctx{ioctx}
+        ,m_host{std::move(host)}
+        ,m_port{std::move(port)}
+        ,m_pk{std::move(pk)}
+        ,m_signer{not_null_signer(std::move(signer))}
+        ,m_recv_window{recv_window}
+        ,m_target{std::move(target)}
+        ,m_clock{}
+        ,m_ws{}
+        ,m_last_id{}
+        ,m_pending{}
+        ,m_params{}
+        ,m_payload{}
+        ,m_alive{std::make_shared<bool>(true)}
+    {
+        connect();
+    }
+    ~impl() {
+        // the pending read completes after the impl is gone, so the close is async, and the
+        // callback finds the impl is gone by the 'm_alive'
+        if ( m_ws ) {
+            m_ws->async_stop();
+        }
+    }
+
+    void connect() {
+        m_ws = std::make_shared<ws::websocket>(m_ioctx);
+        auto *ws = m_ws.get();
+        ws->async_start(
+             m_host
+            ,m_port
+            ,m_target
+            ,[this, ws, alive=std::weak_ptr<bool>{m_alive}]
+             (const char *fl, int ec, std::string errmsg, const char *ptr, std::size_t size) {
+                if ( alive.expired() ) {
+                    return false;
+                }
+                if ( ec ) {
+                    on_disconnected(ws, fl, ec, std::move(errmsg));
+
+                    return false;
+                }
+
+                on_message(ptr, size);
+
+                return true;
+             }
+            ,m_ws
+        );
+    }
+
+    template<typename R, typename CB>
+    static pending_cb make_pending(CB cb) {
+        return [cb=std::move(cb)](const char *fl, int ec, std::string errmsg, const flatjson::fjson *res) {
+            try {
+                if ( !res ) {
+                    cb(fl, ec, std::move(errmsg), R{});
+
+                    return;
+                }
+
+                R v{};
+                try {
+                    v = R::construct(*res);
+                } catch (const std::exception &ex) {
+                    if ( ec ) {
+                        // the partial result could not be parsed, the error is more important
+                        cb(fl, ec, std::move(errmsg), R{});
+                    } else {
+                        cb(__MAKE_FILELINE, static_cast<int>(rest::e_error::UNEXPECTED_RESP), ex.what(), R{});
+                    }
+
+                    return;
+                }
+                if ( ec ) {
+                    cb(fl, ec, std::move(errmsg), std::move(v));
+
+                    return;
+                }
+
+                cb(nullptr, 0, std::string{}, std::move(v));
+            } catch (const std::exception &ex) {
+                std::fprintf(stderr, "%s: %s\n", __MAKE_FILELINE, ex.what());
+                std::fflush(stderr);
+            }
+        };
+    }
+
+    // all the requests are signed: the params, with the 'apiKey', 'recvWindow' and 'timestamp',
+    // are sorted by the name, and the 'key=value&...' of them is signed.
+    template<typename R, typename CB>
+    request_id send(const char *method, rest::query_params params, CB cb) {
+        const request_id id = ++m_last_id;
+        const std::uint64_t timestamp = m_clock ? m_clock->now_ms() : get_current_ms_epoch();
+
+        m_params.assign(params.begin(), params.end());
+        m_params.emplace_back("apiKey", m_pk.c_str());
+        m_params.emplace_back("recvWindow", m_recv_window);
+        m_params.emplace_back("timestamp", timestamp);
+        std::sort(
+             m_params.begin()
+            ,m_params.end()
+            ,[](const rest::query_param &l, const rest::query_param &r)
+             { return std::strcmp(l.key, r.key) < 0; }
+        );
+
+        m_payload.clear();
+        rest::request_builder::append_query(m_payload, m_params.data(), m_params.data() + m_params.size());
+
+        std::string frame;
+        frame.reserve(m_payload.size() + 128);
+        frame += "{\"id\":";
+        rest::request_builder::append_number(frame, id);
+        frame += ",\"method\":\"";
+        frame += method;
+        frame += "\",\"params\":{";
+        for ( const auto &it: m_params ) {
+            if ( !it.is_valid() ) {
+                continue;
+            }
+
+            frame += '"';
+            frame += it.key;
+            frame += "\":";
+            if ( it.kind == rest::query_param::kind_type::string ) {
+                append_json_string(frame, it.str);
+            } else {
+                rest::request_builder::append_number(frame, it.num);
+            }
+            frame += ',';
+        }
+        frame += "\"signature\":\"";
+        m_signer->sign(frame, m_payload.data(), m_payload.size());
+        frame += "\"}}";
+
+        if ( !m_ws ) {
+            connect();
+        }
+        m_pending.emplace(id, make_pending<R>(std::move(cb)));
+        m_ws->async_write(std::move(frame));
+
+        return id;
+    }
+
+    void on_message(const char *ptr, std::size_t size) {
+        const flatjson::fjson json{ptr, size};
+        if ( json.error() != flatjson::FJ_EC_OK || !json.is_object() || !json.contains("id") ) {
+            return;
+        }
+
+        const auto idj = json.at("id");
+        if ( !idj.is_number() ) {
+            // the malformed request, which can't be matched
+            return;
+        }
+
+        auto it = m_pending.find(idj.to_uint64());
+        if ( it == m_pending.end() ) {
+            return;
+        }
+
+        pending_cb cb = std::move(it->second);
+        m_pending.erase(it);
+
+        const int status = json.contains("status") ? json.at("status").to_int() : 0;
+        if ( status == 200 && json.contains("result") ) {
+            const auto res = json.at("result");
+            cb(nullptr, 0, std::string{}, &res);
+        } else if ( json.contains("error") ) {
+            const auto errorj = json.at("error");
+            auto error = rest::construct_error(errorj);
+            if ( errorj.contains("data") ) {
+                const auto data = errorj.at("data");
+                cb(__MAKE_FILELINE, error.first, std::move(error.second), &data);
+            } else {
+                cb(__MAKE_FILELINE, error.first, std::move(error.second), nullptr);
+            }
+        } else {
+            cb(__MAKE_FILELINE, static_cast<int>(rest::e_error::UNEXPECTED_RESP), "unexpected response", nullptr);
+        }
+    }
+
+    void on_disconnected(ws::websocket *ws, const char *fl, int ec, std::string errmsg) {
+        if ( m_ws.get() != ws ) {
+            return;
+        }
+
+        m_ws.reset();
+
+        // the responses for the requests sent over the lost session will never arrive
+        auto pending = std::move(m_pending);
+        m_pending.clear();
+        for ( auto &it: pending ) {
+            it.second(fl, ec, errmsg, nullptr);
+        }
+    }
+
+    boost::asio::io_context &m_ioctx;
+    const std::string m_host;
+    const std::string m_port;
+    const std::string m_pk;
+    const std::shared_ptr<const signer> m_signer;
+    const std::size_t m_recv_window;
+    const std::string m_target;
+    const clock_sync *m_clock;
+    std::shared_ptr<ws::websocket> m_ws;
+    request_id m_last_id;
+    std::unordered_map<request_id, pending_cb> m_pending;
+    std::vector<rest::query_param> m_params; // the scratch buffers
+    std::string m_payload;
+    std::shared_ptr<bool> m_alive; // is not shared with anyone, only observed by the callbacks
+};
+
+/*************************************************************************************************/
+
+client::client(
+     boost::asio::io_context &ioctx
+    ,std::string host
+    ,std::string port
+    ,std::string pk
+    ,std::string sk
+    ,std::size_t recv_window
+    ,std::string target
+)
+    :pimpl{std::make_unique<impl>(
+         ioctx
+        ,std::move(host)
+        ,std::move(port)
+        ,std::move(pk)
+        ,std::make_shared<const hmac_sha256_signer>(sk)
+        ,recv_window
+        ,std::move(target)
+    )}
+{}
+
+client::client(
+     boost::asio::io_context &ioctx
+    ,std::string host
+    ,std::string port
+    ,std::string pk
+    ,std::shared_ptr<const signer> signer
+    ,std::size_t recv_window
+    ,std::string target
+)
+    :pimpl{std::make_unique<impl>(
+         ioctx
+        ,std::move(host)
+        ,std::move(port)
+        ,std::move(pk)
+        ,std::move(signer)
+        ,recv_window
+        ,std::move(target)
+    )}
+{}
+
+client::~client()
+{}
+
+void client::set_clock_sync(const clock_sync *clock) {
+    pimpl->m_clock = clock;
+}
+
+std::size_t client::pending() const {
+    return pimpl->m_pending.size();
+}
+
+/*************************************************************************************************/
+
+client::request_id client::new_order(
+     const char *symbol
+    ,const e_side side
+    ,const e_type type
+    ,const e_time time
+    ,const e_trade_resp_type resp
+    ,const char *amount
+    ,const char *price
+    ,const char *client_order_id
+    ,const char *stop_price
+    ,const char *iceberg_amount
+    ,new_order_cb cb
+) {
+    const char *time_str = type == e_type::market
+        ? nullptr
+        : e_time_to_string(time)
+    ;
+
+    const rest::query_params params = {
+         {"symbol", symbol}
+        ,{"side", e_side_to_string(side)}
+        ,{"type", e_type_to_string(type)}
+        ,{"timeInForce", time_str}
+        ,{"quantity", amount}
+        ,{"price", price}
+        ,{"newClientOrderId", client_order_id}
+        ,{"stopPrice", stop_price}
+        ,{"icebergQty", iceberg_amount}
+        ,{"newOrderRespType", e_trade_resp_type_to_string(resp)}
+    };
+
+    return pimpl->send<rest::new_order_resp_type>("order.place", params, std::move(cb));
+}
+
+/*************************************************************************************************/
+
+client::request_id client::cancel_order(
+     const char *symbol
+    ,std::size_t order_id
+    ,const char *client_order_id
+    ,const char *new_client_order_id
+    ,cancel_order_cb cb
+) {
+    const rest::query_params params = {
+         {"symbol", symbol}
+        ,{"orderId", order_id}
+        ,{"origClientOrderId", client_order_id}
+        ,{"newClientOrderId", new_client_order_id}
+    };
+
+    return pimpl->send<rest::cancel_order_info_t>("order.cancel", params, std::move(cb));
+}
+
+/*************************************************************************************************/
+
+client::request_id client::cancel_replace_order(
+     const char *symbol
+    ,const e_cancel_replace_mode mode
+    ,std::size_t cancel_order_id
+    ,const char *cancel_client_order_id
+    ,const e_side side
+    ,const e_type type
+    ,const e_time time
+    ,const e_trade_resp_type resp
+    ,const char *amount
+    ,const char *price
+    ,const char *client_order_id
+    ,const char *stop_price
+    ,const char *iceberg_amount
+    ,cancel_replace_order_cb cb
+) {
+    const char *time_str = type == e_type::market
+        ? nullptr
+        : e_time_to_string(time)
+    ;
+
+    const rest::query_params params = {
+         {"symbol", symbol}
+        ,{"cancelReplaceMode", e_cancel_replace_mode_to_string(mode)}
+        ,{"cancelOrderId", cancel_order_id}
+        ,{"cancelOrigClientOrderId", cancel_client_order_id}
+        ,{"side", e_side_to_string(side)}
+        ,{"type", e_type_to_string(type)}
+        ,{"timeInForce", time_str}
+        ,{"quantity", amount}
+        ,{"price", price}
+        ,{"newClientOrderId", client_order_id}
+        ,{"stopPrice", stop_price}
+        ,{"icebergQty", iceberg_amount}
+        ,{"newOrderRespType", e_trade_resp_type_to_string(resp)}
+    };
+
+    return pimpl->send<rest::cancel_replace_order_info_t>("order.cancelReplace", params, std::move(cb));
+}
+
+/*************************************************************************************************/
+
+} // ns wsapi
+} // ns binapi
@@ -101,9 +101,74 @@ int main(int argc, char *argv[])
     //     return EXIT_FAILURE;
     // }
     // std::cout << "order: " << order_res.v << std::endl;
+    // the orders left by the previous run
+    auto cres = api.cancel_all_open_orders(symbol.c_str());
+    if (!cres && cres.ec != -2011) // -2011: there are no open orders
+    {
+        std::cerr << "cancel_all_open_orders error: " << cres.errmsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the resting order of each side, which is moved by one cancel-replace request
+    struct quote_t
+    {
+        binapi::e_side side;
+        std::size_t order_id;
+        bool in_flight;
+    };
+    quote_t bid_quote{binapi::e_side::buy, 0, false};
+    quote_t ask_quote{binapi::e_side::sell, 0, false};
+
+    // the async requests, so the other subscriptions are not stalled by the order entry
+    auto requote = [&api, &symbol](quote_t &quote, const std::string &price)
+    {
+        if (quote.in_flight)
+        {
+            return; // the next book change requotes it
+        }
+        quote.in_flight = true;
+
+        if (quote.order_id == 0)
+        {
+            api.new_order(symbol.c_str(), quote.side, binapi::e_type::limit,
+                          binapi::e_time::GTC, binapi::e_trade_resp_type::RESULT, "100", price.c_str(),
+                          nullptr, nullptr, nullptr,
+                          [&quote](binapi::rest::api::result<binapi::rest::new_order_resp_type> res)
+                          {
+                              quote.in_flight = false;
+                              if (!res)
+                              {
+                                  std::cerr << "new_order error: " << res.errmsg << std::endl;
+                                  return;
+                              }
+                              quote.order_id = res.v.get_order_id();
+                              std::cout << "new order: " << res.v << std::endl;
+                          });
+            return;
+        }
+
+        // ALLOW_FAILURE: the new order is placed even if the old one is already filled
+        api.cancel_replace_order(symbol.c_str(), binapi::e_cancel_replace_mode::ALLOW_FAILURE, quote.order_id, nullptr,
+                                 quote.side, binapi::e_type::limit, binapi::e_time::GTC,
+                                 binapi::e_trade_resp_type::RESULT, "100", price.c_str(), nullptr, nullptr, nullptr,
+                                 [&quote](binapi::rest::api::result<binapi::rest::cancel_replace_order_info_t> res)
+                                 {
+                                     quote.in_flight = false;
+                                     quote.order_id = res.v.newOrderResult == "SUCCESS"
+                                         ? res.v.newOrderResponse.get_order_id()
+                                         : 0;
+                                     if (!res)
+                                     {
+                                         std::cerr << "cancel_replace_order error: " << res.errmsg << ", " << res.v << std::endl;
+                                         return;
+                                     }
+                                     std::cout << "requote: " << res.v << std::endl;
+                                 });
+    };
+
     binapi::double_type bid = 0, ask = 0;
     ws.book(symbol.c_str(),
-            [&api, &symbol, &bid, &ask](const char *fl, int ec, std::string emsg, auto book)
+            [&requote, &bid_quote, &ask_quote, &bid, &ask](const char *fl, int ec, std::string emsg, auto book)
             {
                 if (ec)
                 {
@@ -112,16 +177,15 @@ int main(int argc, char *argv[])
                 }
                 // std::cout << "book type: " << demangle(typeid(book).name()) << std::endl;
                 binapi::ws::book_ticker_t book_ticker = std::move(book);
-                if (bid != book_ticker.b || ask != book_ticker.a)
+                if (bid != book_ticker.b)
                 {
-                    api.cancel_all_open_orders(symbol.c_str());
                     bid = std::move(book_ticker.b);
+                    requote(bid_quote, bid.str());
+                }
+                if (ask != book_ticker.a)
+                {
                     ask = std::move(book_ticker.a);
-                    api.new_order(symbol, binapi::e_side::buy, binapi::e_type::limit,
-                                  binapi::e_time::GTC, binapi::e_trade_resp_type::RESULT, "100", bid.str(), "", "", "");
-                    api.new_order(symbol, binapi::e_side::sell, binapi::e_type::limit,
-                                  binapi::e_time::GTC, binapi::e_trade_resp_type::RESULT, "100", ask.str(), "", "", "");
-                    std::cout << "new orders" << std::endl;
+                    requote(ask_quote, ask.str());
                 }
                 std::cout << "book: " << book << std::endl;
                 return true;
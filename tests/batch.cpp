@@ -0,0 +1,96 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the batch of the async requests waits for all of them, however long they wait for the room
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/batch.hpp>
+#include <binapi/errors.hpp>
+
+#include <chrono>
+
+/*************************************************************************************************/
+
+static test::mock_http_server* make_server(std::size_t ms) {
+    return new test::mock_http_server{[ms](std::size_t, const auto &, auto &) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+        return true;
+    }};
+}
+
+/*************************************************************************************************/
+
+static void no_default_deadline() {
+    TEST_CASE("the batch requests are not failed by the default deadline");
+
+    auto *server = make_server(100);
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_default_deadline(150);
+    // so the last ones wait in the queue longer than the deadline
+    api.set_max_inflight_requests(1);
+
+    binapi::rest::batch<binapi::rest::ping_t> batch{api};
+    for ( auto i = 0; i < 4; ++i ) {
+        batch.add([](binapi::rest::api &api, auto cb) { return api.ping(std::move(cb)); });
+    }
+    auto results = batch.join();
+
+    TEST_CHECK(results.size() == 4);
+    for ( const auto &it: results ) {
+        TEST_CHECK(it);
+    }
+    TEST_CHECK(server->requests() == 4);
+
+    // the same requests out of the batch are failed by it
+    int ec[4]{-1, -1, -1, -1};
+    for ( auto &it: ec ) {
+        api.ping([&it](const char *, int e, std::string, binapi::rest::ping_t) {
+            it = e;
+            return true;
+        });
+    }
+    ioctx.restart();
+    ioctx.run();
+    TEST_CHECK(ec[0] == 0);
+    TEST_CHECK(ec[3] == static_cast<int>(binapi::rest::e_error::TIMEOUT));
+}
+
+static void stream_in_order_of_completion() {
+    TEST_CASE("stream() passes each result with the index of its add()");
+
+    auto *server = make_server(0);
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    binapi::rest::batch<binapi::rest::ping_t> batch{api};
+    for ( auto i = 0; i < 3; ++i ) {
+        batch.add([](binapi::rest::api &api, auto cb) { return api.ping(std::move(cb)); });
+    }
+
+    bool seen[3]{};
+    batch.stream([&](std::size_t idx, binapi::rest::api::result<binapi::rest::ping_t> &res) {
+        TEST_CHECK(idx < 3 && !seen[idx]);
+        TEST_CHECK(res);
+        seen[idx] = true;
+    });
+    TEST_CHECK(seen[0] && seen[1] && seen[2]);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    no_default_deadline();
+    stream_in_order_of_completion();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the samples of the server clock are stamped on the wire, so the time the requests wait for
+// the rate limiter doesn't make the estimate worse
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/clock_sync.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+/*************************************************************************************************/
+
+// the server clock is a minute ahead of the local one
+static constexpr std::int64_t server_ahead = 60000;
+
+static std::uint64_t system_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+// '/api/v3/time' replies with the server time
+static test::mock_http_server* make_server() {
+    return new test::mock_http_server{[](std::size_t, const auto &req, auto &resp) {
+        if ( req.target() == "/api/v3/time" ) {
+            resp.body() = "{\"serverTime\":" + std::to_string(system_ms() + server_ahead) + "}";
+        }
+        return true;
+    }};
+}
+
+static void check_estimate(const binapi::clock_sync &clock) {
+    TEST_CHECK(clock.synced());
+    // the request is not delayed by the server, so the round trip is short
+    TEST_CHECK(clock.uncertainty() < std::chrono::milliseconds{50});
+    TEST_CHECK(clock.offset_ms() > server_ahead - 50 && clock.offset_ms() < server_ahead + 50);
+}
+
+/*************************************************************************************************/
+
+static void half_ms_of_truncation() {
+    TEST_CASE("the truncated server time is taken in the middle of its ms");
+
+    binapi::clock_sync clock;
+    // the server time of the sample is 1000.5 ms, so 0.6 ms later it's past 1001 ms
+    const auto at = std::chrono::steady_clock::now() - std::chrono::microseconds{600};
+    clock.add_sample(at, at, 1000);
+    TEST_CHECK(clock.synced());
+    TEST_CHECK(clock.uncertainty() == std::chrono::microseconds{0});
+    TEST_CHECK(clock.now_ms() == 1001);
+}
+
+static void sync_sample_after_limiter() {
+    TEST_CASE("the sync sample doesn't count the wait for the rate limiter");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_rate_limits({{"REQUEST_WEIGHT", "SECOND", 1, 1}});
+
+    // the second one waits for the start of the next second, the sample below for the whole of it
+    TEST_CHECK(api.ping());
+    TEST_CHECK(api.ping());
+    const auto start = std::chrono::steady_clock::now();
+    api.sync_clock(1);
+    TEST_CHECK(std::chrono::steady_clock::now() - start > std::chrono::milliseconds{200});
+
+    check_estimate(api.get_clock_sync());
+}
+
+static void async_sample_after_limiter() {
+    TEST_CASE("the async sample doesn't count the wait in the queue");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_rate_limits({{"REQUEST_WEIGHT", "SECOND", 1, 1}});
+
+    // the first sample waits in the queue for the whole next second
+    TEST_CHECK(api.ping());
+    TEST_CHECK(api.ping());
+    const auto start = std::chrono::steady_clock::now();
+    api.set_clock_sync_interval(60);
+    while ( !api.get_clock_sync().synced() ) {
+        ioctx.run_one();
+    }
+    TEST_CHECK(std::chrono::steady_clock::now() - start > std::chrono::milliseconds{200});
+    api.set_clock_sync_interval(0);
+    ioctx.run();
+
+    check_estimate(api.get_clock_sync());
+}
+
+/*************************************************************************************************/
+
+int main() {
+    half_ms_of_truncation();
+    sync_sample_after_limiter();
+    async_sample_after_limiter();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the endpoints with the asio completion tokens: the handler, use_future and use_awaitable.
+// the test is built as C++20 for the coroutines
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/errors.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include <string>
+#include <thread>
+
+/*************************************************************************************************/
+
+// the new orders must have the symbol and the price they were made with
+static test::mock_http_server* make_server() {
+    return new test::mock_http_server{[](std::size_t, const auto &req, auto &resp) {
+        if ( req.target().starts_with("/api/v3/order") ) {
+            const auto &body = req.body();
+            TEST_CHECK(body.find("symbol=BTCUSDT&") != std::string::npos);
+            TEST_CHECK(body.find("price=20000.500000000000&") != std::string::npos);
+            resp.body() = "{\"symbol\":\"BTCUSDT\",\"orderId\":7,\"clientOrderId\":\"c\",\"transactTime\":1}";
+        }
+        return true;
+    }};
+}
+
+using binapi::rest::api;
+
+/*************************************************************************************************/
+
+static void handler_token() {
+    TEST_CASE("the handler 'void(api::result<R>)'");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    bool called{};
+    api.ping([&](api::result<binapi::rest::ping_t> res) {
+        TEST_CHECK(res);
+        TEST_CHECK(res.handle != 0);
+        called = true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(called);
+}
+
+static void future_token() {
+    TEST_CASE("use_future, with the io_context run by the other thread");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    auto work = boost::asio::make_work_guard(ioctx);
+    std::thread thread{[&ioctx]() { ioctx.run(); }};
+
+    {
+        api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+        auto res = api.ping(boost::asio::use_future).get();
+        TEST_CHECK(res);
+
+        // the request which is not queued is completed too
+        api.set_rate_limits({{"REQUEST_WEIGHT", "MINUTE", 1, 1}});
+        api.set_rate_limit_policy(binapi::rest::rate_limiter::e_policy::reject);
+        res = api.ping(boost::asio::use_future).get();
+        TEST_CHECK(!res);
+        TEST_CHECK(res.ec == static_cast<int>(binapi::rest::e_error::TOO_MANY_REQUESTS));
+
+        // the api is destroyed on the io_context thread, after its last completion
+        boost::asio::post(ioctx, boost::asio::use_future([]{})).get();
+    }
+
+    work.reset();
+    thread.join();
+}
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+
+static boost::asio::awaitable<void> place_order(api &api, bool &placed) {
+    auto pong = co_await api.ping(boost::asio::use_awaitable);
+    TEST_CHECK(pong);
+
+    // the request is issued when the operation is awaited, after the strings are destroyed
+    auto op = api.new_order(
+         std::string{"BTCUSDT"}.c_str()
+        ,binapi::e_side::buy
+        ,binapi::e_type::limit
+        ,binapi::e_time::GTC
+        ,binapi::e_trade_resp_type::ACK
+        ,std::string{"1"}.c_str()
+        ,std::string{"20000.500000000000"}.c_str()
+        ,nullptr
+        ,nullptr
+        ,nullptr
+        ,boost::asio::use_awaitable
+    );
+    auto res = co_await std::move(op);
+    TEST_CHECK(res);
+    TEST_CHECK(res.v.get_response_ack().orderId == 7);
+    placed = true;
+}
+
+static void awaitable_token() {
+    TEST_CASE("use_awaitable, the string arguments are copied by the operation");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    bool placed{};
+    boost::asio::co_spawn(ioctx, place_order(api, placed), boost::asio::detached);
+    ioctx.run();
+
+    TEST_CHECK(placed);
+}
+
+#endif // BOOST_ASIO_HAS_CO_AWAIT
+
+/*************************************************************************************************/
+
+int main() {
+    handler_token();
+    future_token();
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+    awaitable_token();
+#endif
+
+    return EXIT_SUCCESS;
+}
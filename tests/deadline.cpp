@@ -0,0 +1,162 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the deadlines and the cancellation of the async requests, in flight and in the queue
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/errors.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+
+/*************************************************************************************************/
+
+// the pings are stalled by the server for 'ms', the server_time() requests are not
+static test::mock_http_server* make_server(std::size_t ms) {
+    return new test::mock_http_server{[ms](std::size_t, const auto &req, auto &resp) {
+        if ( req.target() == "/api/v3/ping" ) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+        } else {
+            resp.body() = "{\"serverTime\":1}";
+        }
+        return true;
+    }};
+}
+
+static const int timeout_ec = static_cast<int>(binapi::rest::e_error::TIMEOUT);
+static const int aborted_ec = boost::asio::error::operation_aborted;
+
+/*************************************************************************************************/
+
+static void inflight_deadline() {
+    TEST_CASE("the stalled request fails with TIMEOUT when its deadline expires");
+
+    auto *server = make_server(1000);
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    int ec = -1;
+    const auto start = std::chrono::steady_clock::now();
+    api.with_deadline(100).ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec = e;
+        return true;
+    });
+    // the next request is not affected by the one-shot deadline, and is not stalled
+    int ec2 = -1;
+    api.server_time([&](const char *, int e, std::string, binapi::rest::server_time_t) {
+        ec2 = e;
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(ec == timeout_ec);
+    TEST_CHECK(ec2 == 0);
+    TEST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds{900});
+}
+
+static void queued_deadline() {
+    TEST_CASE("the deadline counts the time in the queue");
+
+    auto *server = make_server(500);
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_max_inflight_requests(1);
+
+    int ec[2]{-1, -1};
+    api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec[0] = e;
+        return true;
+    });
+    api.with_deadline(100).server_time([&](const char *, int e, std::string, binapi::rest::server_time_t) {
+        ec[1] = e;
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(ec[0] == 0);
+    TEST_CHECK(ec[1] == timeout_ec);
+    // the queued one was never sent
+    TEST_CHECK(server->requests() == 1);
+}
+
+static void default_deadline() {
+    TEST_CASE("the default deadline, and zero for no deadline");
+
+    auto *server = make_server(300);
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_default_deadline(100);
+
+    int ec[2]{-1, -1};
+    api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec[0] = e;
+        return true;
+    });
+    ioctx.run();
+    TEST_CHECK(ec[0] == timeout_ec);
+
+    ioctx.restart();
+    api.set_default_deadline(0);
+    api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec[1] = e;
+        return true;
+    });
+    ioctx.run();
+    TEST_CHECK(ec[1] == 0);
+}
+
+static void cancel_inflight_and_queued() {
+    TEST_CASE("cancel() of the in-flight and of the queued request");
+
+    auto *server = make_server(1000);
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_max_inflight_requests(1);
+
+    int ec[2]{-1, -1};
+    auto r0 = api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec[0] = e;
+        return true;
+    });
+    auto r1 = api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec[1] = e;
+        return true;
+    });
+    TEST_CHECK(r0.handle != 0 && r1.handle != 0 && r0.handle != r1.handle);
+
+    const auto start = std::chrono::steady_clock::now();
+    boost::asio::steady_timer timer{ioctx, std::chrono::milliseconds{100}};
+    timer.async_wait([&](const boost::system::error_code &) {
+        TEST_CHECK(api.cancel(r1.handle));
+        TEST_CHECK(api.cancel(r0.handle));
+        // already completed
+        TEST_CHECK(!api.cancel(r0.handle));
+    });
+    ioctx.run();
+
+    TEST_CHECK(ec[0] == aborted_ec);
+    TEST_CHECK(ec[1] == aborted_ec);
+    TEST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds{900});
+    TEST_CHECK(!api.cancel(r1.handle));
+}
+
+/*************************************************************************************************/
+
+int main() {
+    inflight_deadline();
+    queued_deadline();
+    default_deadline();
+    cancel_inflight_and_queued();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the sync requests in the dedicated io thread mode: passed to the io_context thread while it's
+// run, and made in place when it's not
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <chrono>
+#include <thread>
+
+/*************************************************************************************************/
+
+static test::mock_http_server* make_server() {
+    return new test::mock_http_server{[](std::size_t, const auto &, auto &) { return true; }};
+}
+
+/*************************************************************************************************/
+
+static void passed_to_io_thread() {
+    TEST_CASE("the sync request is made by the running io_context thread");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    auto work = boost::asio::make_work_guard(ioctx);
+    std::thread thread{[&ioctx]() { ioctx.run(); }};
+
+    {
+        binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+        api.set_dedicated_io_thread(true);
+
+        auto res = api.ping();
+        TEST_CHECK(res);
+        TEST_CHECK(server->requests() == 1);
+
+        boost::asio::post(ioctx, boost::asio::use_future([]{})).get();
+    }
+
+    work.reset();
+    thread.join();
+}
+
+static void made_in_place() {
+    TEST_CASE("the sync request is made in place when the io_context is not run");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_dedicated_io_thread(true);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto res = api.ping();
+    TEST_CHECK(res);
+    TEST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds{1});
+    TEST_CHECK(server->requests() == 1);
+
+    // the retracted request is not sent when the io_context is run later
+    ioctx.run();
+    TEST_CHECK(server->requests() == 1);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    passed_to_io_thread();
+    made_in_place();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the client side governor of the rate limits, alone and in the requests path
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/errors.hpp>
+#include <binapi/rate_limiter.hpp>
+
+#include <chrono>
+#include <memory>
+
+using binapi::rest::rate_limiter;
+
+/*************************************************************************************************/
+
+static std::size_t used_of(const rate_limiter &limiter, const char *type) {
+    for ( const auto &it: limiter.headroom() ) {
+        if ( it.type == type ) {
+            return it.used;
+        }
+    }
+
+    return ~std::size_t{};
+}
+
+// the windows are aligned to the epoch, as the server does
+static std::uint64_t second_of_epoch() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+/*************************************************************************************************/
+
+static void limiter_accounts_and_waits() {
+    TEST_CASE("limiter: the request that doesn't fit waits for the next window");
+
+    rate_limiter limiter;
+    limiter.set_limits({{"REQUEST_WEIGHT", "MINUTE", 1, 10}});
+
+    TEST_CHECK(limiter.acquire({6, 0}) == std::chrono::steady_clock::duration::zero());
+    TEST_CHECK(used_of(limiter, "REQUEST_WEIGHT") == 6);
+
+    bool orders_limit = true;
+    const auto wait = limiter.acquire({6, 0}, &orders_limit);
+    TEST_CHECK(wait > std::chrono::steady_clock::duration::zero());
+    TEST_CHECK(wait <= std::chrono::seconds{60});
+    TEST_CHECK(!orders_limit);
+    // nothing is accounted for the request that waits
+    TEST_CHECK(used_of(limiter, "REQUEST_WEIGHT") == 6);
+}
+
+static void limiter_orders_limit() {
+    TEST_CASE("limiter: the breach of the ORDERS limit is reported");
+
+    rate_limiter limiter;
+    limiter.set_limits({
+         {"REQUEST_WEIGHT", "MINUTE", 1, 6000}
+        ,{"ORDERS", "SECOND", 10, 1}
+    });
+
+    TEST_CHECK(limiter.acquire({1, 1}) == std::chrono::steady_clock::duration::zero());
+
+    bool orders_limit = false;
+    TEST_CHECK(limiter.acquire({1, 1}, &orders_limit) > std::chrono::steady_clock::duration::zero());
+    TEST_CHECK(orders_limit);
+    // the request which is not an order is not limited by them
+    TEST_CHECK(limiter.acquire({1, 0}) == std::chrono::steady_clock::duration::zero());
+}
+
+static void limiter_headers() {
+    TEST_CASE("limiter: the usage is corrected by the response headers");
+
+    rate_limiter limiter;
+    limiter.set_limits({{"REQUEST_WEIGHT", "MINUTE", 1, 10}});
+
+    limiter.on_header("X-MBX-USED-WEIGHT-1M", "9");
+    TEST_CHECK(used_of(limiter, "REQUEST_WEIGHT") == 9);
+    TEST_CHECK(limiter.acquire({2, 0}) > std::chrono::steady_clock::duration::zero());
+
+    // the other windows and headers are ignored
+    limiter.on_header("X-MBX-USED-WEIGHT-1S", "1");
+    limiter.on_header("Content-Length", "2");
+    TEST_CHECK(used_of(limiter, "REQUEST_WEIGHT") == 9);
+}
+
+static void limiter_ban() {
+    TEST_CASE("limiter: nothing is sent until the Retry-After expires");
+
+    rate_limiter limiter;
+    limiter.on_ban(std::chrono::seconds{2});
+
+    TEST_CHECK(limiter.acquire({1, 0}) > std::chrono::seconds{1});
+}
+
+/*************************************************************************************************/
+
+static void api_async_delay() {
+    TEST_CASE("api: the async request is delayed to the next window");
+
+    auto *server = new test::mock_http_server{[](std::size_t, const auto &, auto &) { return true; }};
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_rate_limits({{"REQUEST_WEIGHT", "SECOND", 1, 2}});
+
+    // the windows are aligned to the epoch, the first two may complete in the next one already
+    const auto issued = second_of_epoch();
+    std::uint64_t completed[3]{};
+    for ( auto &it: completed ) {
+        api.ping([&it](const char *, int ec, std::string, binapi::rest::ping_t) {
+            TEST_CHECK(ec == 0);
+            it = second_of_epoch();
+            return true;
+        });
+    }
+    ioctx.run();
+
+    TEST_CHECK(completed[0] && completed[1] && completed[2]);
+    TEST_CHECK(completed[2] > issued);
+    TEST_CHECK(server->requests() == 3);
+}
+
+static void api_async_reject() {
+    TEST_CASE("api: the async request is rejected by the 'reject' policy");
+
+    auto *server = new test::mock_http_server{[](std::size_t, const auto &, auto &) { return true; }};
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_rate_limits({{"REQUEST_WEIGHT", "MINUTE", 1, 2}});
+    api.set_rate_limit_policy(rate_limiter::e_policy::reject);
+
+    int ec[3]{-1, -1, -1};
+    for ( auto &it: ec ) {
+        api.ping([&it](const char *, int e, std::string, binapi::rest::ping_t) {
+            it = e;
+            return true;
+        });
+    }
+    ioctx.run();
+
+    TEST_CHECK(ec[0] == 0);
+    TEST_CHECK(ec[1] == 0);
+    TEST_CHECK(ec[2] == static_cast<int>(binapi::rest::e_error::TOO_MANY_REQUESTS));
+    TEST_CHECK(server->requests() == 2);
+}
+
+static void api_sync_on_io_thread() {
+    TEST_CASE("api: the sync request on the io_context thread is rejected instead of the delay");
+
+    auto *server = new test::mock_http_server{[](std::size_t, const auto &, auto &) { return true; }};
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+    api.set_rate_limits({{"REQUEST_WEIGHT", "MINUTE", 1, 1}});
+
+    bool called{};
+    api.ping([&](const char *, int ec, std::string, binapi::rest::ping_t) {
+        TEST_CHECK(ec == 0);
+
+        const auto start = std::chrono::steady_clock::now();
+        auto res = api.ping();
+        TEST_CHECK(!res);
+        TEST_CHECK(res.ec == static_cast<int>(binapi::rest::e_error::TOO_MANY_REQUESTS));
+        TEST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds{1});
+        called = true;
+
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(called);
+    TEST_CHECK(server->requests() == 1);
+}
+
+static void api_destroyed_while_waiting() {
+    TEST_CASE("api: destroyed while the request waits for the limit");
+
+    auto *server = new test::mock_http_server{[](std::size_t, const auto &, auto &) { return true; }};
+    boost::asio::io_context ioctx;
+    auto api = std::make_unique<binapi::rest::api>(ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000);
+    api->set_rate_limits({{"REQUEST_WEIGHT", "MINUTE", 1, 1}});
+
+    bool waiting_called{};
+    api->ping([&](const char *, int ec, std::string, binapi::rest::ping_t) {
+        TEST_CHECK(ec == 0);
+        // the second one waits for the limit timer
+        boost::asio::post(ioctx, [&]() { api.reset(); });
+        return true;
+    });
+    api->ping([&](const char *, int, std::string, binapi::rest::ping_t) {
+        waiting_called = true;
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(!api);
+    TEST_CHECK(!waiting_called);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    limiter_accounts_and_waits();
+    limiter_orders_limit();
+    limiter_headers();
+    limiter_ban();
+
+    api_async_delay();
+    api_async_reject();
+    api_sync_on_io_thread();
+    api_destroyed_while_waiting();
+
+    return EXIT_SUCCESS;
+}
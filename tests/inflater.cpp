@@ -0,0 +1,113 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the compressed responses, and the limit of their decoded size
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/inflater.hpp>
+
+#include <zlib.h>
+
+#include <string>
+
+/*************************************************************************************************/
+
+static std::string gzip(const std::string &src) {
+    z_stream zs{};
+    TEST_CHECK(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+    std::string dst(deflateBound(&zs, src.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src.data()));
+    zs.avail_in = static_cast<uInt>(src.size());
+    zs.next_out = reinterpret_cast<Bytef *>(&dst[0]);
+    zs.avail_out = static_cast<uInt>(dst.size());
+    TEST_CHECK(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    dst.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    return dst;
+}
+
+// the JSON string of 'size' spaces, it's compressed to the few KB
+static std::string large_json(std::size_t size) {
+    return "{\"a\":\"" + std::string(size, ' ') + "\"}";
+}
+
+/*************************************************************************************************/
+
+static void decoder_limit() {
+    TEST_CASE("the decoder doesn't write over the limit");
+
+    const auto src = large_json(1024 * 1024);
+    const auto encoded = gzip(src);
+
+    binapi::rest::inflater decoder;
+    boost::beast::flat_buffer dst;
+    decoder.reset(binapi::rest::inflater::e_encoding::gzip);
+    auto ec = decoder.write(encoded.data(), encoded.size(), dst, 64 * 1024);
+    TEST_CHECK(ec == boost::beast::http::error::body_limit);
+    TEST_CHECK(dst.size() <= 64 * 1024);
+
+    dst.clear();
+    decoder.reset(binapi::rest::inflater::e_encoding::gzip);
+    ec = decoder.write(encoded.data(), encoded.size(), dst, 2 * 1024 * 1024);
+    TEST_CHECK(!ec);
+    TEST_CHECK(decoder.finished());
+    TEST_CHECK(dst.size() == src.size());
+}
+
+static void api_limit() {
+    TEST_CASE("the response decoded over the body limit fails the request");
+
+    // '/api/v3/ping' is over the limit, '/api/v3/time' is under it
+    const auto bomb = gzip(large_json(16 * 1024 * 1024));
+    const auto time = gzip("{\"serverTime\":1}");
+    auto *server = new test::mock_http_server{[&bomb, &time](std::size_t, const auto &req, auto &resp) {
+        resp.set(boost::beast::http::field::content_encoding, "gzip");
+        resp.body() = req.target() == "/api/v3/ping" ? bomb : time;
+        return true;
+    }};
+    TEST_CHECK(bomb.size() < binapi::rest::inflating_body::default_limit);
+
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    TEST_CHECK(!api.ping());
+    auto res = api.server_time();
+    TEST_CHECK(res);
+    TEST_CHECK(res.v.serverTime == 1);
+
+    int ec{};
+    api.ping([&ec](const char *, int e, std::string, binapi::rest::ping_t) {
+        ec = e;
+        return true;
+    });
+    std::size_t server_time{};
+    api.server_time([&server_time](const char *, int e, std::string, binapi::rest::server_time_t res) {
+        TEST_CHECK(e == 0);
+        server_time = res.serverTime;
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(ec == static_cast<int>(boost::beast::http::error::body_limit));
+    TEST_CHECK(server_time == 1);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    decoder_limit();
+    api_limit();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the endpoints of the latency stats are found by the address of the target, and by its value
+
+#include "test.hpp"
+
+#include <binapi/latency_stats.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using binapi::rest::latency_stats;
+using boost::beast::http::verb;
+
+/*************************************************************************************************/
+
+static void by_address_and_value() {
+    TEST_CASE("the same target is the same endpoint, whatever its address");
+
+    latency_stats stats;
+    auto *ep = stats.get(verb::get, "/api/v3/ping");
+    TEST_CHECK(ep == stats.get(verb::get, "/api/v3/ping"));
+
+    const std::string copy = "/api/v3/ping";
+    TEST_CHECK(ep == stats.get(verb::get, copy.c_str()));
+    TEST_CHECK(ep != stats.get(verb::post, "/api/v3/ping"));
+    TEST_CHECK(stats.snapshot().size() == 2);
+}
+
+static void more_than_index() {
+    TEST_CASE("the targets which don't fit the index are found by the value");
+
+    latency_stats stats;
+    std::vector<std::string> targets;
+    for ( auto i = 0; i < 300; ++i ) {
+        targets.push_back("/api/v3/t" + std::to_string(i));
+    }
+
+    std::vector<latency_stats::endpoint *> eps;
+    for ( const auto &it: targets ) {
+        eps.push_back(stats.get(verb::get, it.c_str()));
+    }
+    for ( std::size_t i = 0; i < targets.size(); ++i ) {
+        TEST_CHECK(stats.get(verb::get, targets[i].c_str()) == eps[i]);
+        TEST_CHECK(eps[i]->m_target == targets[i]);
+    }
+    TEST_CHECK(stats.snapshot().size() == targets.size());
+}
+
+static void concurrent() {
+    TEST_CASE("the concurrent lookups of the new targets");
+
+    static const char *targets[] = {"/api/v3/a", "/api/v3/b", "/api/v3/c", "/api/v3/d"};
+
+    latency_stats stats;
+    latency_stats::endpoint *found[4][4]{};
+    std::vector<std::thread> threads;
+    for ( auto t = 0; t < 4; ++t ) {
+        threads.emplace_back([&stats, &found, t]() {
+            for ( auto n = 0; n < 1000; ++n ) {
+                for ( auto i = 0; i < 4; ++i ) {
+                    found[t][i] = stats.get(verb::get, targets[i]);
+                    found[t][i]->record(latency_stats::e_stage::total, std::chrono::microseconds{1});
+                }
+            }
+        });
+    }
+    for ( auto &it: threads ) {
+        it.join();
+    }
+
+    for ( auto i = 0; i < 4; ++i ) {
+        for ( auto t = 1; t < 4; ++t ) {
+            TEST_CHECK(found[t][i] == found[0][i]);
+        }
+    }
+    const auto snapshot = stats.snapshot();
+    TEST_CHECK(snapshot.size() == 4);
+    for ( const auto &it: snapshot ) {
+        TEST_CHECK(it.stage(latency_stats::e_stage::total).count == 4000);
+    }
+}
+
+/*************************************************************************************************/
+
+int main() {
+    by_address_and_value();
+    more_than_index();
+    concurrent();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the MPSC queue of the submissions of the thread-safe mode: the order, and the concurrent producers.
+// the stress is meant to be run with the thread sanitizer too, see BINAPI_TESTS_TSAN
+
+#include "test.hpp"
+
+#include <binapi/mpsc_queue.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*************************************************************************************************/
+
+struct item: binapi::mpsc_queue_hook {
+    std::size_t producer = 0;
+    std::size_t seq = 0;
+};
+
+/*************************************************************************************************/
+
+static void single_thread() {
+    TEST_CASE("the elements are popped in the order of the pushes");
+
+    binapi::mpsc_queue<item> queue;
+    TEST_CHECK(queue.empty());
+    TEST_CHECK(!queue.pop());
+
+    item items[3];
+    for ( auto &it: items ) {
+        queue.push(&it);
+    }
+    TEST_CHECK(!queue.empty());
+    for ( auto &it: items ) {
+        TEST_CHECK(queue.pop() == &it);
+    }
+    TEST_CHECK(queue.empty());
+    TEST_CHECK(!queue.pop());
+
+    // the last one is popped when the stub is pushed behind it, so the queue is reused after
+    queue.push(&items[0]);
+    TEST_CHECK(queue.pop() == &items[0]);
+    queue.push(&items[1]);
+    queue.push(&items[2]);
+    TEST_CHECK(queue.pop() == &items[1]);
+    TEST_CHECK(queue.pop() == &items[2]);
+    TEST_CHECK(queue.empty());
+}
+
+static void concurrent_producers() {
+    TEST_CASE("the concurrent producers, each element is popped once, in the order of its producer");
+
+    enum: std::size_t { producers = 4, per_producer = 100000 };
+
+    std::vector<item> items(producers * per_producer);
+    binapi::mpsc_queue<item> queue;
+    std::atomic<bool> go{};
+
+    std::vector<std::thread> threads;
+    for ( std::size_t p = 0; p < producers; ++p ) {
+        threads.emplace_back([&, p]() {
+            while ( !go.load(std::memory_order_acquire) )
+            {}
+            for ( std::size_t i = 0; i < per_producer; ++i ) {
+                auto &it = items[p * per_producer + i];
+                it.producer = p;
+                it.seq = i;
+                queue.push(&it);
+            }
+        });
+    }
+
+    std::vector<std::size_t> next(producers);
+    std::size_t popped = 0;
+    go.store(true, std::memory_order_release);
+    // the pop can miss the element whose push is in progress, so it's retried until all are seen
+    while ( popped < producers * per_producer ) {
+        item *it = queue.pop();
+        if ( !it ) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        TEST_CHECK(it->seq == next[it->producer]);
+        ++next[it->producer];
+        ++popped;
+    }
+    for ( auto &it: threads ) {
+        it.join();
+    }
+
+    TEST_CHECK(!queue.pop());
+    TEST_CHECK(queue.empty());
+    for ( auto it: next ) {
+        TEST_CHECK(it == per_producer);
+    }
+}
+
+/*************************************************************************************************/
+
+int main() {
+    single_thread();
+    concurrent_producers();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the requests made by the callback of the async request, while its response is being processed
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/batch.hpp>
+
+/*************************************************************************************************/
+
+// each response has the number of its request
+static test::mock_http_server* make_server() {
+    return new test::mock_http_server{[](std::size_t n, const auto &, auto &resp) {
+        resp.body() = "{\"serverTime\":" + std::to_string(n + 1) + "}";
+        return true;
+    }};
+}
+
+/*************************************************************************************************/
+
+static void nested_sync_and_async() {
+    TEST_CASE("the sync and the async requests of the callback");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    std::size_t outer{}, sync{}, async{};
+    api.server_time([&](const char *, int ec, std::string, binapi::rest::server_time_t res) {
+        TEST_CHECK(ec == 0);
+        outer = res.serverTime;
+
+        auto r = api.server_time();
+        TEST_CHECK(r);
+        sync = r.v.serverTime;
+
+        api.server_time([&](const char *, int ec, std::string, binapi::rest::server_time_t res) {
+            TEST_CHECK(ec == 0);
+            async = res.serverTime;
+            return true;
+        });
+        // the result of the outer one is not changed by them
+        TEST_CHECK(res.serverTime == outer);
+
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(outer == 1);
+    TEST_CHECK(sync == 2);
+    TEST_CHECK(async == 3);
+    TEST_CHECK(server->requests() == 3);
+}
+
+static void nested_batch() {
+    TEST_CASE("the batch of the callback, with the io_context run by the other thread");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    // the batch is run by the other io_context, it can't run the one of the callback
+    boost::asio::io_context batch_ioctx;
+    binapi::rest::api batch_api{batch_ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    std::size_t outer{};
+    std::size_t sum{};
+    api.server_time([&](const char *, int ec, std::string, binapi::rest::server_time_t res) {
+        TEST_CHECK(ec == 0);
+        outer = res.serverTime;
+
+        binapi::rest::batch<binapi::rest::server_time_t> batch{batch_api};
+        for ( auto i = 0; i < 3; ++i ) {
+            batch.add([](binapi::rest::api &api, auto cb) { return api.server_time(std::move(cb)); });
+        }
+        for ( const auto &it: batch.join() ) {
+            TEST_CHECK(it);
+            sum += it.v.serverTime;
+        }
+        TEST_CHECK(res.serverTime == outer);
+
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(outer == 1);
+    TEST_CHECK(sum == 2 + 3 + 4);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    nested_sync_and_async();
+    nested_batch();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the queued async requests are sent in the order of priority; the market data requests
+// can't take all the connections
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+/*************************************************************************************************/
+
+// the targets in the order they are received. each request is stalled for 'ms'
+struct recording_server {
+    explicit recording_server(std::size_t ms)
+        :server{[this, ms](std::size_t, const auto &req, auto &resp) {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                targets.emplace_back(req.target());
+                max_concurrent = std::max(max_concurrent, ++concurrent);
+            }
+            if ( req.target() == "/api/v3/time" ) {
+                resp.body() = "{\"serverTime\":1}";
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+            std::lock_guard<std::mutex> lock{mutex};
+            --concurrent;
+            return true;
+        }}
+        ,concurrent{}
+        ,max_concurrent{}
+    {}
+
+    std::vector<std::string> received() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return targets;
+    }
+
+    test::mock_http_server server;
+    std::mutex mutex;
+    std::vector<std::string> targets;
+    std::size_t concurrent;
+    std::size_t max_concurrent;
+};
+
+static bool ping_cb(const char *, int ec, std::string, binapi::rest::ping_t) {
+    TEST_CHECK(ec == 0);
+    return true;
+}
+static bool time_cb(const char *, int ec, std::string, binapi::rest::server_time_t) {
+    TEST_CHECK(ec == 0);
+    return true;
+}
+
+/*************************************************************************************************/
+
+static void higher_priority_first() {
+    TEST_CASE("the queued request of the higher priority is sent first");
+
+    auto *server = new recording_server{50};
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->server.port(), "pk", "sk", 5000};
+    api.set_max_inflight_requests(1);
+
+    // the first one takes the only connection, the rest are queued
+    api.ping(ping_cb);
+    api.ping(ping_cb);
+    api.ping(ping_cb);
+    api.with_priority(binapi::rest::api::e_priority::order_entry).server_time(time_cb);
+    // the one-shot priority is not applied to the next request
+    api.server_time(time_cb);
+    ioctx.run();
+
+    const std::vector<std::string> expected{
+         "/api/v3/ping"
+        ,"/api/v3/time"
+        ,"/api/v3/ping"
+        ,"/api/v3/ping"
+        ,"/api/v3/time"
+    };
+    TEST_CHECK(server->received() == expected);
+}
+
+static void bulk_requests_limited() {
+    TEST_CASE("the in-flight market data requests are limited");
+
+    auto *server = new recording_server{100};
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->server.port(), "pk", "sk", 5000};
+    api.set_max_inflight_requests(4);
+    api.set_max_inflight_bulk_requests(2);
+
+    for ( auto i = 0; i < 6; ++i ) {
+        api.ping(ping_cb);
+    }
+    ioctx.run();
+
+    TEST_CHECK(server->received().size() == 6);
+    TEST_CHECK(server->max_concurrent == 2);
+}
+
+static void bulk_limit_leaves_room() {
+    TEST_CASE("the account request is sent while the market data ones wait for the room");
+
+    auto *server = new recording_server{100};
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->server.port(), "pk", "sk", 5000};
+    api.set_max_inflight_requests(2);
+    api.set_max_inflight_bulk_requests(1);
+
+    api.ping(ping_cb);
+    api.ping(ping_cb);
+    api.with_priority(binapi::rest::api::e_priority::account).server_time(time_cb);
+    ioctx.run();
+
+    // the first two are sent concurrently, so their order is not known
+    auto received = server->received();
+    TEST_CHECK(received.size() == 3);
+    TEST_CHECK(received.back() == "/api/v3/ping");
+    TEST_CHECK(server->max_concurrent == 2);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    higher_priority_first();
+    bulk_requests_limited();
+    bulk_limit_leaves_room();
+
+    return EXIT_SUCCESS;
+}
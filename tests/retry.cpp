@@ -0,0 +1,131 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the request failed over the reused keep-alive connection is sent again only when the server
+// can't have processed it
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+
+/*************************************************************************************************/
+
+// the first request opens the connection, the second one is read by the server
+// over the same connection, which is closed then without the response
+static test::mock_http_server* make_server() {
+    return new test::mock_http_server{[](std::size_t n, const auto &, auto &) { return n != 1; }};
+}
+
+static binapi::rest::api::result<binapi::rest::new_order_resp_type>
+new_order(binapi::rest::api &api, binapi::rest::api::new_order_cb cb = {}) {
+    return api.new_order(
+         "BTCUSDT"
+        ,binapi::e_side::buy
+        ,binapi::e_type::limit
+        ,binapi::e_time::GTC
+        ,binapi::e_trade_resp_type::ACK
+        ,"1"
+        ,"1"
+        ,nullptr
+        ,nullptr
+        ,nullptr
+        ,std::move(cb)
+    );
+}
+
+/*************************************************************************************************/
+
+static void sync_get_is_retried() {
+    TEST_CASE("sync: GET without the response is sent again");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    TEST_CHECK(api.ping());
+    TEST_CHECK(api.ping());
+    TEST_CHECK(server->requests() == 3);
+    TEST_CHECK(server->connections() == 2);
+}
+
+static void sync_post_is_not_retried() {
+    TEST_CASE("sync: POST without the response is not sent again");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    TEST_CHECK(api.ping());
+    TEST_CHECK(!new_order(api));
+    TEST_CHECK(server->requests() == 2);
+    TEST_CHECK(server->connections() == 1);
+}
+
+static void async_get_is_retried() {
+    TEST_CASE("async: GET without the response is sent again");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    int ec = -1;
+    api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        TEST_CHECK(e == 0);
+        // the connection is released after the callback
+        boost::asio::post(ioctx, [&]() {
+            api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+                ec = e;
+                return true;
+            });
+        });
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(ec == 0);
+    TEST_CHECK(server->requests() == 3);
+    TEST_CHECK(server->connections() == 2);
+}
+
+static void async_post_is_not_retried() {
+    TEST_CASE("async: POST without the response is not sent again");
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    int ec = -1;
+    api.ping([&](const char *, int e, std::string, binapi::rest::ping_t) {
+        TEST_CHECK(e == 0);
+        boost::asio::post(ioctx, [&]() {
+            new_order(api, [&](const char *, int e, std::string, binapi::rest::new_order_resp_type) {
+                ec = e;
+                return true;
+            });
+        });
+        return true;
+    });
+    ioctx.run();
+
+    TEST_CHECK(ec != 0);
+    TEST_CHECK(server->requests() == 2);
+    TEST_CHECK(server->connections() == 1);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    sync_get_is_retried();
+    sync_post_is_not_retried();
+    async_get_is_retried();
+    async_post_is_not_retried();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the signature of the HMAC signer, and the clients which are made without the signer
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/wsapi.hpp>
+#include <binapi/signer.hpp>
+
+#include <stdexcept>
+
+/*************************************************************************************************/
+
+static void hmac_signature() {
+    TEST_CASE("the HMAC-SHA256 signature of the example of the API docs");
+
+    const binapi::hmac_sha256_signer signer{"NhqPtmdSJYdKjVHjA7PZj4Mge3R5YNiP1e3UZjInClVN65XAbvqqM6A7H5fATj0j"};
+    const std::string query = "symbol=LTCBTC&side=BUY&type=LIMIT&timeInForce=GTC&quantity=1&price=0.1"
+        "&recvWindow=5000&timestamp=1499827319559";
+
+    std::string signature;
+    signer.sign(signature, query.data(), query.size());
+    TEST_CHECK(signature == "c8db56825ae71d6d79447849e617115f4a920fa2acdcab2b053c4b2838bd6b71");
+}
+
+static void null_signer() {
+    TEST_CASE("the clients are not made without the signer");
+
+    boost::asio::io_context ioctx;
+    bool thrown{};
+    try {
+        binapi::rest::api api{ioctx, "127.0.0.1", "443", "pk", std::shared_ptr<const binapi::signer>{}, 5000};
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    TEST_CHECK(thrown);
+
+    thrown = false;
+    try {
+        binapi::wsapi::client client{ioctx, "127.0.0.1", "443", "pk", std::shared_ptr<const binapi::signer>{}, 5000};
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    TEST_CHECK(thrown);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    hmac_signature();
+    null_signer();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the supervisor of the stream connections: the planned replacement is made before the old one is
+// closed, and the lost one is reconnected with the gap reported
+
+#include "test.hpp"
+
+#include <binapi/websocket.hpp>
+#include <binapi/types.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+/*************************************************************************************************/
+
+// the sessions in the order of their connections
+struct sessions {
+    std::shared_ptr<test::ws_session> at(std::size_t i) {
+        std::lock_guard<std::mutex> lock{mutex};
+        return i < list.size() ? list[i] : nullptr;
+    }
+    std::size_t size() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return list.size();
+    }
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<test::ws_session>> list;
+};
+
+static test::mock_ws_server* make_server(sessions &s) {
+    return new test::mock_ws_server{[&s](const auto &session, const std::string *msg) {
+        if ( !msg ) {
+            std::lock_guard<std::mutex> lock{s.mutex};
+            s.list.push_back(session);
+        }
+    }};
+}
+
+// the update id is the number of the session * 1000 + the number of the message
+static std::string make_book(std::size_t session, std::size_t seq) {
+    return "{\"stream\":\"btcusdt@bookTicker\",\"data\":{\"u\":" + std::to_string(session * 1000 + seq)
+        + ",\"s\":\"BTCUSDT\",\"b\":\"1\",\"B\":\"1\",\"a\":\"2\",\"A\":\"1\"}}";
+}
+
+// the io_context is run until 'pred' is true, the callback of the timer is called every 10ms
+template<typename Pred, typename F>
+static bool run_until(boost::asio::io_context &ioctx, std::chrono::milliseconds timeout, Pred pred, F on_tick) {
+    const auto stop = std::chrono::steady_clock::now() + timeout;
+    boost::asio::steady_timer timer{ioctx};
+    std::function<void()> tick = [&]() {
+        timer.expires_after(std::chrono::milliseconds{10});
+        timer.async_wait([&](const boost::system::error_code &ec) {
+            if ( !ec ) {
+                on_tick();
+                tick();
+            }
+        });
+    };
+    tick();
+    while ( !pred() && std::chrono::steady_clock::now() < stop ) {
+        ioctx.run_one_for(std::chrono::milliseconds{10});
+    }
+    timer.cancel();
+    ioctx.poll();
+
+    return pred();
+}
+
+/*************************************************************************************************/
+
+static void planned_replacement() {
+    TEST_CASE("the lifetime is expired, the new connection replaces the old one by its first message");
+
+    sessions s;
+    auto *server = make_server(s);
+    boost::asio::io_context ioctx;
+    binapi::ws::websockets ws{ioctx, "127.0.0.1", server->port()};
+
+    std::size_t gaps{};
+    ws.set_reconnect([&gaps](binapi::ws::websockets::handle, const char *, const auto &) { ++gaps; }, 10, 100, 1);
+
+    std::vector<std::size_t> received;
+    std::size_t during_connect{}; // the messages of the old one, received when the new one is connected
+    ws.book("BTCUSDT", [&](const char *, int ec, std::string, binapi::ws::book_ticker_t msg) {
+        TEST_CHECK(ec == 0);
+        received.push_back(msg.u);
+        if ( msg.u < 1000 && s.size() == 2 ) {
+            ++during_connect;
+        }
+        return true;
+    });
+
+    // the new session is silent for 200ms after its connect
+    std::size_t seq[2]{};
+    std::size_t silent{20};
+    auto send = [&]() {
+        if ( auto old = s.at(0) ) {
+            old->send(make_book(0, ++seq[0]));
+        }
+        if ( auto fresh = s.at(1) ) {
+            if ( !silent || !--silent ) {
+                fresh->send(make_book(1, ++seq[1]));
+            }
+        }
+    };
+    const bool replaced = run_until(
+         ioctx
+        ,std::chrono::seconds{5}
+        ,[&]() { return !received.empty() && received.back() > 1005 && s.at(0)->closed(); }
+        ,send
+    );
+
+    TEST_CHECK(replaced);
+    TEST_CHECK(s.size() == 2);
+    TEST_CHECK(s.at(1)->target() == "/stream?streams=btcusdt@bookTicker");
+    TEST_CHECK(gaps == 0);
+    TEST_CHECK(during_connect > 0);
+    // the messages of the old one are not dispatched after the first one of the new one
+    const auto first_new = std::find_if(received.begin(), received.end(), [](std::size_t u) { return u > 1000; });
+    TEST_CHECK(first_new != received.end());
+    TEST_CHECK(std::all_of(first_new, received.end(), [](std::size_t u) { return u > 1000; }));
+    TEST_CHECK(*first_new == 1001);
+}
+
+static void lost_connection() {
+    TEST_CASE("the lost connection is reconnected, the gap is reported before its first message");
+
+    sessions s;
+    auto *server = make_server(s);
+    boost::asio::io_context ioctx;
+    binapi::ws::websockets ws{ioctx, "127.0.0.1", server->port()};
+
+    std::vector<binapi::ws::websockets::gap_t> gaps;
+    std::vector<std::size_t> received;
+    ws.set_reconnect([&](binapi::ws::websockets::handle, const char *stream, const auto &gap) {
+        TEST_CHECK(std::string{stream} == "btcusdt@bookTicker");
+        // before the first message of the new connection
+        TEST_CHECK(received.empty() || received.back() < 1000);
+        gaps.push_back(gap);
+    }, 10, 100);
+
+    ws.book("BTCUSDT", [&](const char *, int ec, std::string, binapi::ws::book_ticker_t msg) {
+        TEST_CHECK(ec == 0);
+        received.push_back(msg.u);
+        return true;
+    });
+
+    std::size_t seq[2]{};
+    bool dropped{};
+    auto send = [&]() {
+        if ( auto old = s.at(0) ) {
+            if ( seq[0] < 3 ) {
+                old->send(make_book(0, ++seq[0]));
+            } else if ( !dropped && received.size() == 3 ) {
+                dropped = true;
+                old->drop();
+            }
+        }
+        if ( auto fresh = s.at(1) ) {
+            fresh->send(make_book(1, ++seq[1]));
+        }
+    };
+    const bool reconnected = run_until(
+         ioctx
+        ,std::chrono::seconds{5}
+        ,[&]() { return !received.empty() && received.back() > 1000; }
+        ,send
+    );
+
+    TEST_CHECK(reconnected);
+    TEST_CHECK(s.size() == 2);
+    TEST_CHECK(gaps.size() == 1);
+    TEST_CHECK(gaps[0].ec != 0);
+    TEST_CHECK(gaps[0].from != 0 && gaps[0].from <= gaps[0].to);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    planned_replacement();
+    lost_connection();
+
+    return EXIT_SUCCESS;
+}
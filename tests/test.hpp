@@ -0,0 +1,303 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+#ifndef __binapi__tests__test_hpp
+#define __binapi__tests__test_hpp
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+/*************************************************************************************************/
+// the failed check terminates the test, ctest reports its output
+
+#define TEST_CHECK(...) \
+    do { \
+        if ( !(__VA_ARGS__) ) { \
+            std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #__VA_ARGS__); \
+            std::exit(EXIT_FAILURE); \
+        } \
+    } while (0)
+
+#define TEST_CASE(name) \
+    std::fprintf(stdout, "%s\n", name), std::fflush(stdout)
+
+namespace test {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+
+/*************************************************************************************************/
+
+// the self-signed certificate, the client does not verify it
+inline void use_self_signed_cert(asio::ssl::context &ctx) {
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    X509_sign(x509, pkey, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), x509);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), pkey);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+}
+
+/*************************************************************************************************/
+// the local TLS server of the REST requests. each request is passed to the handler, which fills
+// the response. the connections are served by the detached threads, so the server is never destroyed
+
+struct mock_http_server {
+    using ssl_stream = asio::ssl::stream<asio::ip::tcp::socket>;
+    using request_type = beast::http::request<beast::http::string_body>;
+    using response_type = beast::http::response<beast::http::string_body>;
+    // 'n' is the number of the request, counted from zero over all the connections.
+    // returns false to close the connection without the response
+    using handler_type = std::function<bool(std::size_t n, const request_type &req, response_type &resp)>;
+
+    explicit mock_http_server(handler_type handler)
+        :m_handler{std::move(handler)}
+        ,m_ioctx{}
+        ,m_ssl{asio::ssl::context::tls_server}
+        ,m_acceptor{m_ioctx, {asio::ip::address_v4::loopback(), 0}}
+        ,m_requests{}
+        ,m_connections{}
+    {
+        use_self_signed_cert(m_ssl);
+
+        std::thread([this]{ accept(); }).detach();
+    }
+
+    std::string port() const { return std::to_string(m_acceptor.local_endpoint().port()); }
+    std::size_t requests() const { return m_requests; }
+    std::size_t connections() const { return m_connections; }
+
+private:
+    void accept() {
+        for ( ;; ) {
+            asio::ip::tcp::socket sock{m_ioctx};
+            m_acceptor.accept(sock);
+            sock.set_option(asio::ip::tcp::no_delay{true});
+            ++m_connections;
+            std::thread([this](asio::ip::tcp::socket s){ serve(std::move(s)); }, std::move(sock)).detach();
+        }
+    }
+
+    void serve(asio::ip::tcp::socket sock) {
+        ssl_stream stream{std::move(sock), m_ssl};
+        boost::system::error_code ec;
+        stream.handshake(asio::ssl::stream_base::server, ec);
+
+        beast::flat_buffer buf;
+        while ( !ec ) {
+            request_type req;
+            beast::http::read(stream, buf, req, ec);
+            if ( ec ) {
+                break;
+            }
+
+            response_type resp{beast::http::status::ok, 11};
+            resp.set(beast::http::field::content_type, "application/json");
+            resp.body() = "{}";
+            resp.keep_alive(true);
+            if ( !m_handler(m_requests++, req, resp) ) {
+                break;
+            }
+
+            resp.prepare_payload();
+            beast::http::write(stream, resp, ec);
+        }
+
+        stream.next_layer().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        stream.next_layer().close(ec);
+    }
+
+    handler_type m_handler;
+    asio::io_context m_ioctx;
+    asio::ssl::context m_ssl;
+    asio::ip::tcp::acceptor m_acceptor;
+    std::atomic<std::size_t> m_requests;
+    std::atomic<std::size_t> m_connections;
+};
+
+/*************************************************************************************************/
+// the local TLS websocket server. each connection is served by the detached thread with its own
+// io_context, which reads the client all the time, so the close of the client is answered.
+// the frames are sent by the session from any thread.
+
+struct ws_session: std::enable_shared_from_this<ws_session> {
+    using ws_stream = beast::websocket::stream<asio::ssl::stream<asio::ip::tcp::socket>>;
+
+    ws_session(asio::ip::tcp::socket sock, asio::ssl::context &ssl)
+        :m_ioctx{}
+        ,m_ws{asio::ip::tcp::socket{m_ioctx}, ssl}
+        ,m_target{}
+        ,m_queue{}
+        ,m_closed{}
+    {
+        // the socket is moved to the io_context of the session
+        m_ws.next_layer().next_layer().assign(asio::ip::tcp::v4(), sock.release());
+    }
+
+    // the target of the handshake request, e.g. "/stream?streams=..."
+    const std::string& target() const { return m_target; }
+    // the client has closed the connection, or it's lost
+    bool closed() const { return m_closed; }
+
+    void send(std::string msg) {
+        asio::post(m_ioctx, [self=shared_from_this(), msg=std::move(msg)]() mutable {
+            self->m_queue.push_back(std::move(msg));
+            if ( self->m_queue.size() == 1 ) {
+                self->write();
+            }
+        });
+    }
+    // the connection is lost, without the close handshake
+    void drop() {
+        asio::post(m_ioctx, [self=shared_from_this()]() {
+            boost::system::error_code ec;
+            self->m_ws.next_layer().next_layer().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+            self->m_ws.next_layer().next_layer().close(ec);
+        });
+    }
+
+private:
+    friend struct mock_ws_server;
+
+    template<typename F>
+    void run(F on_message) {
+        boost::system::error_code ec;
+        m_ws.next_layer().handshake(asio::ssl::stream_base::server, ec);
+        beast::flat_buffer buf;
+        beast::http::request<beast::http::string_body> req;
+        if ( !ec ) {
+            beast::http::read(m_ws.next_layer(), buf, req, ec);
+        }
+        if ( !ec ) {
+            m_target = std::string{req.target()};
+            m_ws.accept(req, ec);
+        }
+        if ( ec ) {
+            return;
+        }
+
+        on_message(nullptr);
+        read(std::move(on_message));
+        m_ioctx.run();
+    }
+    template<typename F>
+    void read(F on_message) {
+        m_ws.async_read(m_buf, [self=shared_from_this(), on_message=std::move(on_message)]
+            (const boost::system::error_code &ec, std::size_t) mutable
+        {
+            if ( ec ) {
+                self->m_closed = true;
+                return;
+            }
+
+            const std::string msg = beast::buffers_to_string(self->m_buf.data());
+            self->m_buf.consume(self->m_buf.size());
+            on_message(&msg);
+            self->read(std::move(on_message));
+        });
+    }
+    void write() {
+        m_ws.text(true);
+        m_ws.async_write(asio::buffer(m_queue.front()), [self=shared_from_this()]
+            (const boost::system::error_code &ec, std::size_t)
+        {
+            if ( ec ) {
+                self->m_queue.clear();
+                return;
+            }
+
+            self->m_queue.pop_front();
+            if ( !self->m_queue.empty() ) {
+                self->write();
+            }
+        });
+    }
+
+    asio::io_context m_ioctx;
+    ws_stream m_ws;
+    beast::flat_buffer m_buf;
+    std::string m_target;
+    std::deque<std::string> m_queue;
+    std::atomic<bool> m_closed;
+};
+
+struct mock_ws_server {
+    // 'msg' is null when the session is connected
+    using handler_type = std::function<void(const std::shared_ptr<ws_session> &session, const std::string *msg)>;
+
+    explicit mock_ws_server(handler_type handler)
+        :m_handler{std::move(handler)}
+        ,m_ioctx{}
+        ,m_ssl{asio::ssl::context::tls_server}
+        ,m_acceptor{m_ioctx, {asio::ip::address_v4::loopback(), 0}}
+        ,m_connections{}
+    {
+        use_self_signed_cert(m_ssl);
+
+        std::thread([this]{ accept(); }).detach();
+    }
+
+    std::string port() const { return std::to_string(m_acceptor.local_endpoint().port()); }
+    std::size_t connections() const { return m_connections; }
+
+private:
+    void accept() {
+        for ( ;; ) {
+            asio::ip::tcp::socket sock{m_ioctx};
+            m_acceptor.accept(sock);
+            sock.set_option(asio::ip::tcp::no_delay{true});
+            ++m_connections;
+            auto session = std::make_shared<ws_session>(std::move(sock), m_ssl);
+            std::thread([this, session]() {
+                session->run([this, session=session.get()](const std::string *msg) {
+                    m_handler(session->shared_from_this(), msg);
+                });
+            }).detach();
+        }
+    }
+
+    handler_type m_handler;
+    asio::io_context m_ioctx;
+    asio::ssl::context m_ssl;
+    asio::ip::tcp::acceptor m_acceptor;
+    std::atomic<std::size_t> m_connections;
+};
+
+} // ns test
+
+#endif // __binapi__tests__test_hpp
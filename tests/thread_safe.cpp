@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the async requests of the thread-safe mode, from the concurrent threads, with the io_context
+// run by the few threads too
+
+#include "test.hpp"
+
+#include <binapi/api.hpp>
+#include <binapi/errors.hpp>
+
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*************************************************************************************************/
+
+// '/api/v3/time' is stalled
+static test::mock_http_server* make_server() {
+    return new test::mock_http_server{[](std::size_t, const auto &req, auto &) {
+        if ( req.target() == "/api/v3/time" ) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{200});
+        }
+        return true;
+    }};
+}
+
+/*************************************************************************************************/
+
+static void concurrent_submitters() {
+    TEST_CASE("the requests of the concurrent threads, the one-shot options are per thread");
+
+    enum: std::size_t { submitters = 4, per_submitter = 200 };
+
+    auto *server = make_server();
+    boost::asio::io_context ioctx;
+    auto work = boost::asio::make_work_guard(ioctx);
+    std::vector<std::thread> io_threads;
+    for ( auto i = 0; i < 2; ++i ) {
+        io_threads.emplace_back([&ioctx]() { ioctx.run(); });
+    }
+
+    {
+        binapi::rest::api api{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+        api.set_thread_safe(true);
+
+        std::atomic<std::size_t> ok{};
+        std::atomic<std::size_t> failed{};
+        std::atomic<int> timeout_ec{-1};
+        std::vector<std::thread> threads;
+        for ( std::size_t t = 0; t < submitters; ++t ) {
+            threads.emplace_back([&, t]() {
+                // the deadline of this thread is not taken by the requests of the others
+                if ( t == 0 ) {
+                    api.with_deadline(1).server_time([&](const char *, int ec, std::string, binapi::rest::server_time_t) {
+                        timeout_ec = ec;
+                        return true;
+                    });
+                }
+                for ( std::size_t i = 0; i < per_submitter; ++i ) {
+                    api.with_priority(binapi::rest::api::e_priority::market_data).ping(
+                        [&](const char *, int ec, std::string, binapi::rest::ping_t) {
+                            ++(ec ? failed : ok);
+                            return true;
+                        }
+                    );
+                }
+            });
+        }
+        for ( auto &it: threads ) {
+            it.join();
+        }
+
+        while ( ok + failed < submitters * per_submitter || timeout_ec == -1 ) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        TEST_CHECK(ok == submitters * per_submitter);
+        TEST_CHECK(timeout_ec == static_cast<int>(binapi::rest::e_error::TIMEOUT));
+
+        // the api is destroyed when nothing of it is run by the io_context threads
+        ioctx.stop();
+        for ( auto &it: io_threads ) {
+            it.join();
+        }
+    }
+}
+
+/*************************************************************************************************/
+
+int main() {
+    concurrent_submitters();
+
+    return EXIT_SUCCESS;
+}
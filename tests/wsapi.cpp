@@ -0,0 +1,120 @@
+// ----------------------------------------------------------------------------
+//                              Apache License
+//                        Version 2.0, January 2004
+//                     http://www.apache.org/licenses/
+//
+// This file is part of binapi(https://github.com/niXman/binapi) project.
+//
+// Copyright (c) 2019-2021 niXman (github dot nixman dog pm.me). All rights reserved.
+// ----------------------------------------------------------------------------
+
+// the order entry over the websocket API session, and the client destroyed while it's read
+
+#include "test.hpp"
+
+#include <binapi/wsapi.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <memory>
+
+/*************************************************************************************************/
+
+// {"id":N,...} -> {"id":N,"status":200,"result":{...}}
+static std::string make_reply(const std::string &req) {
+    const auto beg = req.find("\"id\":") + 5;
+    const auto end = req.find(',', beg);
+
+    std::string resp = "{\"id\":";
+    resp.append(req, beg, end - beg);
+    resp += ",\"status\":200,\"result\":";
+    resp += "{\"symbol\":\"BTCUSDT\",\"orderId\":7,\"clientOrderId\":\"c\",\"transactTime\":1}";
+    resp += '}';
+
+    return resp;
+}
+
+static binapi::wsapi::client::request_id
+new_order(binapi::wsapi::client &client, binapi::wsapi::client::new_order_cb cb) {
+    return client.new_order(
+         "BTCUSDT"
+        ,binapi::e_side::buy
+        ,binapi::e_type::limit
+        ,binapi::e_time::GTC
+        ,binapi::e_trade_resp_type::ACK
+        ,"1"
+        ,"1"
+        ,nullptr
+        ,nullptr
+        ,nullptr
+        ,std::move(cb)
+    );
+}
+
+/*************************************************************************************************/
+
+static void request_response() {
+    TEST_CASE("the response is passed to the callback of its request");
+
+    auto *server = new test::mock_ws_server{[](const auto &session, const std::string *msg) {
+        if ( msg ) {
+            session->send(make_reply(*msg));
+        }
+    }};
+    boost::asio::io_context ioctx;
+    binapi::wsapi::client client{ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000};
+
+    std::size_t order_id{};
+    new_order(client, [&](const char *, int ec, std::string, binapi::rest::new_order_resp_type res) {
+        TEST_CHECK(ec == 0);
+        order_id = res.get_response_ack().orderId;
+        TEST_CHECK(client.pending() == 0);
+        return true;
+    });
+    TEST_CHECK(client.pending() == 1);
+
+    // the io_context is run until the response
+    while ( !order_id ) {
+        ioctx.run_one();
+    }
+    TEST_CHECK(order_id == 7);
+}
+
+static void destroyed_while_reading() {
+    TEST_CASE("the client is destroyed while the read is pending, the response arrives after");
+
+    auto *server = new test::mock_ws_server{[](const auto &session, const std::string *msg) {
+        if ( msg ) {
+            std::thread([session, reply=make_reply(*msg)]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+                session->send(reply);
+            }).detach();
+        }
+    }};
+    boost::asio::io_context ioctx;
+    auto client = std::make_unique<binapi::wsapi::client>(ioctx, "127.0.0.1", server->port(), "pk", "sk", 5000);
+
+    bool called{};
+    new_order(*client, [&](const char *, int, std::string, binapi::rest::new_order_resp_type) {
+        called = true;
+        return true;
+    });
+
+    boost::asio::steady_timer timer{ioctx, std::chrono::milliseconds{50}};
+    timer.async_wait([&](const boost::system::error_code &) { client.reset(); });
+    // completed by the close handshake
+    ioctx.run();
+
+    TEST_CHECK(!client);
+    TEST_CHECK(!called);
+}
+
+/*************************************************************************************************/
+
+int main() {
+    request_response();
+    destroyed_while_reading();
+
+    return EXIT_SUCCESS;
+}